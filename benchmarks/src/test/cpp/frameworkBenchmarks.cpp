@@ -0,0 +1,292 @@
+/**
+ *  Benchmarks of the unit test framework itself.
+ *
+ *  These measure the cost of each matcher in a passing and a failing
+ *  assertion, of the runner per test, of registering and starting up
+ *  suites of 10k and 100k tests, of selecting tests by name and by
+ *  --filter, and of formatting the TAP output.
+ *
+ *  The runner, startup and selection benchmarks re-run this program as
+ *  a synthetic suite: when UNITTEST_SYNTHETIC_TESTS=N is in its
+ *  environment, it registers N trivial tests (synthetic000000, ...),
+ *  given no time limit unless UNITTEST_SYNTHETIC_TIMED is also set.
+ */
+
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "unittest.h"
+#include "unittestBenchmarks.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace CppUnitLite;
+
+
+/* ********************************************************
+ * Assertions
+ * ********************************************************/
+
+/**
+ * Declares benchAssert<label>Pass and benchAssert<label>Fail, timing
+ * assertThat(value, matcher) with a matcher that holds and with one
+ * that does not. A failed assertion throws, so the cost of a failure
+ * includes building its explanation, throwing and catching.
+ */
+#define AssertionBenchmarks(label, value, passing, failing) \
+	UnitBenchmark(benchAssert ## label ## Pass) \
+	{ \
+		while (benchmark.keepRunning()) { \
+			assertThat (value, passing); \
+		} \
+	} \
+	UnitBenchmark(benchAssert ## label ## Fail) \
+	{ \
+		while (benchmark.keepRunning()) { \
+			try { \
+				assertThat (value, failing); \
+			} catch (UnitTest::UnitTestFailure& failure) { \
+				doNotOptimize (failure); \
+			} \
+		} \
+	}
+
+int anInt = 42;
+double aDouble = 3.14159;
+string aString = "the quick brown fox jumps over the lazy dog";
+const char* aNullPointer = nullptr;
+vector<int> aVector {2, 3, 5, 7, 11, 13, 17, 19, 23, 29};
+vector<int> anotherVector {2, 3, 5, 7, 11, 13, 17, 19, 23, 31};
+map<int, int> aMap {{1, 1}, {2, 4}, {3, 9}, {4, 16}};
+vector<double> someDoubles (1000, 1.0);
+vector<double> otherDoubles (1000, 1.5);
+
+AssertionBenchmarks(IsEqualTo, anInt, isEqualTo(42), isEqualTo(43))
+AssertionBenchmarks(IsNotEqualTo, anInt, isNotEqualTo(43), isNotEqualTo(42))
+AssertionBenchmarks(IsApproximately, aDouble, isApproximately(3.14, 0.01),
+		isApproximately(2.72, 0.01))
+AssertionBenchmarks(IsLessThan, anInt, isLessThan(100), isLessThan(10))
+AssertionBenchmarks(IsOneOf, anInt, isOneOf(1, 2, 42), isOneOf(1, 2, 3))
+AssertionBenchmarks(StringEqualTo, aString, isEqualTo(aString), isEqualTo("a dog"))
+AssertionBenchmarks(StringContains, aString, contains("lazy"), contains("cat"))
+AssertionBenchmarks(BeginsWith, aString, beginsWith("the"), beginsWith("a"))
+AssertionBenchmarks(EndsWith, aString, endsWith("dog"), endsWith("cat"))
+AssertionBenchmarks(IsNull, aNullPointer, isNull(), isNotNull())
+AssertionBenchmarks(ContainerContains, aVector, contains(23), contains(24))
+AssertionBenchmarks(HasItems, aVector, hasItems(3, 23), hasItems(3, 24))
+AssertionBenchmarks(HasEntry, aMap, hasEntry(3, 9), hasEntry(3, 10))
+AssertionBenchmarks(ElementsEqual, aVector, elementsEqual(aVector),
+		elementsEqual(anotherVector))
+AssertionBenchmarks(AllApproximately, someDoubles, allApproximately(someDoubles, 1.0e-9),
+		allApproximately(otherDoubles, 1.0e-9))
+AssertionBenchmarks(AllOf, anInt, allOf(isGreaterThan(10), isLessThan(100)),
+		allOf(isGreaterThan(10), isLessThan(20)))
+AssertionBenchmarks(AnyOf, anInt, anyOf(isLessThan(10), isGreaterThan(20)),
+		anyOf(isLessThan(10), isGreaterThan(50)))
+AssertionBenchmarks(Negated, anInt, !(isEqualTo(43)), !(isEqualTo(42)))
+
+UnitBenchmark(benchAssertTruePass)
+{
+	while (benchmark.keepRunning()) {
+		assertTrue (anInt > 0);
+	}
+}
+
+UnitBenchmark(benchAssertTrueFail)
+{
+	while (benchmark.keepRunning()) {
+		try {
+			assertTrue (anInt < 0);
+		} catch (UnitTest::UnitTestFailure& failure) {
+			doNotOptimize (failure);
+		}
+	}
+}
+
+
+/* ********************************************************
+ * Output
+ * ********************************************************/
+
+UnitBenchmark(benchMsgComment)
+{
+	string commentary;
+	for (int i = 0; i < 100; ++i)
+		commentary += "line " + to_string(i) + " of the commentary\n";
+	benchmark.setBytesPerIteration (commentary.size());
+	while (benchmark.keepRunning()) {
+		string out = UnitTest::msgComment(commentary);
+		doNotOptimize (out);
+	}
+}
+
+UnitBenchmark(benchMsgFailed)
+{
+	string diagnostics = "assertThat(x, isEqualTo(y))\n"
+			"\tExpected: 42\n\tObserved: 43\n";
+	UnitTest::TestTiming timing (1.5, 1.25);
+	benchmark.setBytesPerIteration (diagnostics.size());
+	while (benchmark.keepRunning()) {
+		string out = UnitTest::msgFailed(17, "testSomething", diagnostics, timing);
+		doNotOptimize (out);
+	}
+}
+
+
+/* ********************************************************
+ * Synthetic suites
+ * ********************************************************/
+
+namespace {
+
+void syntheticTest()
+{
+	assertTrue (anInt > 0);
+}
+
+// Registers the synthetic suite asked for by the environment.
+struct SyntheticSuite {
+	deque<string> names;
+	deque<UnitTest::Registration> registrations;
+
+	SyntheticSuite()
+	{
+		const char* count = getenv("UNITTEST_SYNTHETIC_TESTS");
+		if (count == nullptr)
+			return;
+		int limit = (getenv("UNITTEST_SYNTHETIC_TIMED") != nullptr)
+				? DEFAULT_UNIT_TEST_TIME_LIMIT : -1;
+		long n = atol(count);
+		for (long i = 0; i < n; ++i)
+		{
+			string digits = to_string(i);
+			names.push_back("synthetic" + string(6 - min<size_t>(6, digits.size()), '0')
+					+ digits);
+			registrations.emplace_back(names.back().c_str(), limit, &syntheticTest);
+		}
+	}
+};
+
+SyntheticSuite syntheticSuite;
+
+#if defined(__linux__)
+
+// Runs this program as a synthetic suite of numTests tests, with the
+// given arguments and its output discarded, and returns its exit status.
+int runSynthetic (long numTests, bool timed, const vector<string>& args)
+{
+	vector<string> environment;
+	for (char** e = environ; *e != nullptr; ++e)
+		if (string(*e).compare(0, 19, "UNITTEST_SYNTHETIC_") != 0)
+			environment.push_back(*e);
+	environment.push_back("UNITTEST_SYNTHETIC_TESTS=" + to_string(numTests));
+	if (timed)
+		environment.push_back("UNITTEST_SYNTHETIC_TIMED=1");
+
+	vector<string> arguments {"/proc/self/exe", "--results-cache=", "--slowest=0"};
+	arguments.insert(arguments.end(), args.begin(), args.end());
+
+	vector<char*> argv;
+	for (string& arg: arguments)
+		argv.push_back(&arg[0]);
+	argv.push_back(nullptr);
+	vector<char*> envp;
+	for (string& var: environment)
+		envp.push_back(&var[0]);
+	envp.push_back(nullptr);
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+	posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+	pid_t child;
+	int status = -1;
+	if (posix_spawn(&child, argv[0], &actions, nullptr, argv.data(), envp.data()) == 0)
+		waitpid(child, &status, 0);
+	posix_spawn_file_actions_destroy(&actions);
+	return status;
+}
+
+// Times the synthetic suite, reporting the tests per second.
+void benchSynthetic (Benchmark& benchmark, long numTests, bool timed,
+		const vector<string>& args)
+{
+	benchmark.setItemsPerIteration (numTests);
+	while (benchmark.keepRunning()) {
+		int status = runSynthetic(numTests, timed, args);
+		if (status != 0)
+			throw UnitTest::UnitTestFailure("synthetic suite exited with status "
+					+ to_string(status), __FILE__, __LINE__);
+	}
+}
+
+#endif
+
+}
+
+#if defined(__linux__)
+
+// Lists the synthetic tests without running them, so that only the
+// registration, sorting and selection are timed. (A name that matched
+// none of them would have all of them run instead.)
+const vector<string> listAll {"--list"};
+
+// All of the synthetic tests, by a glob.
+const vector<string> runAll {"--filter=synthetic*"};
+
+UnitBenchmarkTimed(benchStartupEmpty, 60000L)
+{
+	benchSynthetic (benchmark, 0, false, listAll);
+}
+
+UnitBenchmarkTimed(benchStartup10k, 60000L)
+{
+	benchSynthetic (benchmark, 10000, false, listAll);
+}
+
+UnitBenchmarkTimed(benchStartup100k, 60000L)
+{
+	benchSynthetic (benchmark, 100000, false, listAll);
+}
+
+UnitBenchmarkTimed(benchRunUntimed10k, 60000L)
+{
+	benchSynthetic (benchmark, 10000, false, runAll);
+}
+
+UnitBenchmarkTimed(benchRunTimed10k, 60000L)
+{
+	benchSynthetic (benchmark, 10000, true, runAll);
+}
+
+UnitBenchmarkTimed(benchSelectBySubstring100k, 60000L)
+{
+	benchSynthetic (benchmark, 100000, false, {"--list", "synthetic0", "7"});
+}
+
+UnitBenchmarkTimed(benchSelectByGlob100k, 60000L)
+{
+	benchSynthetic (benchmark, 100000, false, {"--list", "--filter=synthetic*7?"});
+}
+
+UnitBenchmarkTimed(benchSelectByRegex100k, 60000L)
+{
+	benchSynthetic (benchmark, 100000, false, {"--list", "--filter=/synthetic.*7.$/"});
+}
+
+UnitBenchmarkTimed(benchSelectExcluding100k, 60000L)
+{
+	benchSynthetic (benchmark, 100000, false,
+			{"--list", "--filter=synthetic*", "--filter=-*7?"});
+}
+
+#endif
@@ -1,24 +1,65 @@
 #include <algorithm>
+#include <deque>
 #include <iostream>
 #include <iomanip>
 #include <set>
 #include <sstream>
+#include <unordered_map>
 #include <fstream>
+#include <functional>
+#include <map>
 
 #include <chrono>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <memory>
 
 #include <regex>
 #include <iterator>
+#include <limits>
+#include <type_traits>
+
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 #include <signal.h>
 #include <setjmp.h>
 #include <cstdlib>
+#include <ctime>
 
 #include <unistd.h>
+#include <fcntl.h>
+#ifndef __MINGW32__
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
+#if defined(__linux__)
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <link.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
 
 #include "unittest.h"
+#include "unittestBenchmarks.h"
+#include "unittestData.h"
+#include "unittestReporters.h"
 
 
 #ifdef __MINGW32__
@@ -33,16 +74,120 @@
 
 using namespace CppUnitLite;
 
-std::map<std::string, UnitTest::BoundedTest> *UnitTest::tests = nullptr;
-
-long UnitTest::numSuccesses = 0L;
-long UnitTest::numFailures = 0L;
-long UnitTest::numErrors = 0L;
-std::string UnitTest::currentTest;
-bool UnitTest::expectToFail = false;
+/**
+ * The state of the test run, and the functions that drive it.
+ */
+struct UnitTest::Runner {
+	static std::atomic<long> numSuccesses;
+	static std::atomic<long> numFailures;
+	static std::atomic<long> numErrors;
+	static std::atomic<long> numSkipped;
+
+	static std::vector<std::string> failedTests;
+
+	/**
+	 * Internal container for test functions and their associated time limits.
+	 */
+	struct BoundedTest {
+		int timeLimit;
+		TestFunction unitTest;
+		std::string abbreviation; // camelCase initials, e.g. "tI" for testIncrement
+		bool concurrent;
+		bool benchmark;
+		TestFunction fixture;
+		bool data;
+
+		BoundedTest(): timeLimit(0), unitTest(0), concurrent(false), benchmark(false),
+				fixture(nullptr), data(false) {}
+		BoundedTest (int time, TestFunction f, std::string abbrev, bool concurrentSafe,
+				bool isBenchmark, TestFunction prepare = nullptr, bool dataDriven = false)
+			: timeLimit(time), unitTest(f), abbreviation(abbrev),
+			  concurrent(concurrentSafe), benchmark(isBenchmark), fixture(prepare),
+			  data(dataDriven) {}
+	};
+	static std::map<std::string, BoundedTest> *tests;
+	static void indexTests();
+	static std::map<std::string, TestTiming> testTimings;
+	static unsigned numSlowestReported;
+	static bool listOnly;
+	static unsigned benchmarkRepetitions;
+	static double benchmarkMinMS;
+	static std::map<std::string, BenchmarkStatistics> benchmarkResults;
+	static std::string baselinesPath;
+	static std::string machineTag;
+	static bool updateBaselines;
+	static std::map<std::string, BenchmarkStatistics> baselines;
+	static bool failOnLeaks;
+	static unsigned maxFailedExpectations;
+	static long failFastLimit;
+	static std::atomic<bool> stopRequested;
+
+	static std::recursive_mutex& fixtureMutex ();
+	static void prepareFixtures (const std::vector<std::string>& testNames);
+	static void destroyFixtures ();
+
+	static BenchmarkStatistics measureBenchmark (
+			const Callable<void(Benchmark&)>& body, bool looped);
+	static void reportAllocations (TestContext& context, std::string& details);
+	static void reportRegions (TestContext& context, std::string& details);
+
+	static void runTests (int nTests, char** testNames, char* programName);
+	static void report ();
+
+	static void runTest(unsigned testNumber, std::string testName, TestFunction u, long timeLimitInMS);
+	static int runTestTimed(unsigned testNumber, std::string testName, TestFunction u,
+			long timeLimitInMS, std::string& msg, TestTiming& timing);
+	static void recordResult(unsigned testNumber, std::string testName, int testResult,
+			const std::string& testExplanation, const TestTiming& timing);
+	static int runTestGuarded(unsigned testNumber, std::string testName, TestFunction u,
+			std::string& msg, TestTiming& timing,
+			std::shared_ptr<TestContext> context = nullptr);
+	static void runTestsInWorkers(const std::vector<std::string>& testOrder,
+			unsigned numJobs, const std::map<std::string, long>* timings,
+			unsigned numFirst);
+	static void runTestsInThreads(const std::vector<std::string>& testOrder,
+			unsigned numThreads);
+	static int timedOut(unsigned testNumber, const std::string& testName,
+			long timeLimit, TestContext& context, std::string& msg, TestTiming& timing);
+	static int workerEnded(unsigned testNumber, const std::string& testName,
+			bool killed, bool expectingFailure, int status, double elapsedMS,
+			std::string& msg, TestTiming& timing);
+	static void runWorker(const std::vector<std::string>& testOrder,
+			const std::function<bool(unsigned&)>& claimTest, int resultFd, bool passOutput);
+
+	static std::string extractLocation (const std::string& msg);
+	static bool detectDebugger();
+
+	static std::vector<std::shared_ptr<Reporter>> reporters;
+	static void startReporters (unsigned numTests);
+	static void reportDiagnostic (const std::string& text);
+};
+
+// Constant-initialized, so it is ready before any Registration is constructed.
+const UnitTest::Registration* UnitTest::registrations = nullptr;
+std::map<std::string, UnitTest::Runner::BoundedTest> *UnitTest::Runner::tests = nullptr;
+
+std::atomic<long> UnitTest::Runner::numSuccesses(0L);
+std::atomic<long> UnitTest::Runner::numFailures(0L);
+std::atomic<long> UnitTest::Runner::numErrors(0L);
+std::atomic<long> UnitTest::Runner::numSkipped(0L);
 bool UnitTest::diagnosticMessagesBeforeResults = true;
-std::vector<std::string> UnitTest::callLog;
-std::vector<std::string> UnitTest::failedTests;
+std::vector<std::string> UnitTest::Runner::failedTests;
+std::map<std::string, UnitTest::TestTiming> UnitTest::Runner::testTimings;
+bool UnitTest::Runner::listOnly = false;
+unsigned UnitTest::Runner::numSlowestReported = 5;
+unsigned UnitTest::Runner::benchmarkRepetitions = 20;
+double UnitTest::Runner::benchmarkMinMS = 10.0;
+std::map<std::string, BenchmarkStatistics> UnitTest::Runner::benchmarkResults;
+std::string UnitTest::Runner::baselinesPath = "unittest-baselines.txt";
+std::string UnitTest::Runner::machineTag;
+bool UnitTest::Runner::updateBaselines = false;
+std::map<std::string, BenchmarkStatistics> UnitTest::Runner::baselines;
+bool UnitTest::Runner::failOnLeaks = false;
+unsigned UnitTest::Runner::maxFailedExpectations = 100;
+long UnitTest::Runner::failFastLimit = 0L;
+std::atomic<bool> UnitTest::Runner::stopRequested(false);
+std::vector<std::shared_ptr<Reporter>> UnitTest::Runner::reporters;
 
 #ifdef __amd64__
   #define breakDebugger { asm volatile ("int $3"); }
@@ -52,25 +197,591 @@ std::vector<std::string> UnitTest::failedTests;
   #define breakDebugger { }
 #endif
 
-template <>
-std::string CppUnitLite::getStringRepr(std::string t)
+namespace {
+// Each thread's reusable representation buffer
+thread_local std::ostringstream* sharedReprStream = nullptr;
+thread_local bool sharedReprStreamInUse = false;
+}
+
+CppUnitLite::ReprBuffer::ReprBuffer ()
+{
+	// A representation can be requested while another is being built
+	// (by an operator<<, say), in which case this one gets a stream of
+	// its own.
+	shared = !sharedReprStreamInUse;
+	if (shared) {
+		if (sharedReprStream == nullptr) {
+			const UncountedAllocations uncounted; // kept for the thread
+			sharedReprStream = new std::ostringstream();
+		}
+		out = sharedReprStream;
+		out->str(std::string());
+		out->clear();
+		out->flags(std::ios_base::skipws | std::ios_base::dec);
+		out->precision(6);
+		out->width(0);
+		out->fill(' ');
+		sharedReprStreamInUse = true;
+	} else {
+		out = new std::ostringstream();
+	}
+}
+
+CppUnitLite::ReprBuffer::~ReprBuffer ()
+{
+	if (shared)
+		sharedReprStreamInUse = false;
+	else
+		delete out;
+}
+
+void CppUnitLite::writeRepr(std::ostream& out, const std::string& t)
+{
+	out << '"' << t << '"';
+}
+
+void CppUnitLite::writeRepr(std::ostream& out, const char* t)
+{
+	out << '"' << t << '"';
+}
+
+void CppUnitLite::writeRepr(std::ostream& out, char t)
+{
+	out << '\'' << t << '\'';
+}
+
+void CppUnitLite::writeRepr(std::ostream& out, bool b)
+{
+	out << ((b) ? "true" : "false");
+}
+
+
+namespace {
+
+/**
+ * Heap use charged to a test, or to one assertion within it. Only the
+ * test's own thread makes the charges, but the live blocks may be freed
+ * by any thread.
+ */
+struct AllocationCounts {
+	const unsigned long serial;    // marks the blocks charged to these counts
+	AllocationCounts* const outer; // also charged, if any
+	long long allocations = 0;
+	long long bytes = 0;
+	long long peakLiveBytes = 0;
+	std::atomic<long long> liveAllocations;
+	std::atomic<long long> liveBytes;
+
+	explicit AllocationCounts (AllocationCounts* enclosing = nullptr);
+	~AllocationCounts ();
+	AllocationCounts (const AllocationCounts&) = delete;
+	AllocationCounts& operator= (const AllocationCounts&) = delete;
+};
+
+// Set by the replacement operator new, if it is linked in.
+bool allocationCountingEnabled = false;
+
+// The counts charged by this thread's allocations, if any.
+thread_local AllocationCounts* countingAllocations = nullptr;
+
+std::atomic<unsigned long> lastAllocationSerial (0);
+
+// The outermost counts still in existence, by serial, for the blocks
+// freed on threads other than the one that allocated them.
+std::mutex allocationRegistryMutex;
+std::unordered_map<unsigned long, AllocationCounts*>* allocationRegistry = nullptr;
+
+AllocationCounts::AllocationCounts (AllocationCounts* enclosing)
+: serial(++lastAllocationSerial), outer(enclosing), liveAllocations(0), liveBytes(0)
+{
+	if (outer == nullptr) {
+		AllocationCounts* previous = countingAllocations;
+		countingAllocations = nullptr;
+		{
+			std::lock_guard<std::mutex> l(allocationRegistryMutex);
+			if (allocationRegistry == nullptr)
+				allocationRegistry = new std::unordered_map<unsigned long, AllocationCounts*>();
+			(*allocationRegistry)[serial] = this;
+		}
+		countingAllocations = previous;
+	}
+}
+
+AllocationCounts::~AllocationCounts ()
+{
+	if (outer == nullptr) {
+		std::lock_guard<std::mutex> l(allocationRegistryMutex);
+		allocationRegistry->erase(serial);
+	}
+}
+
+// Precedes each block handed out by countedAllocate.
+struct alignas(std::max_align_t) AllocationHeader {
+	std::size_t size;
+	unsigned long serial; // of the counts with the block's live bytes, or 0
+};
+
+/**
+ * Charges this thread's allocations to some counts until destroyed.
+ */
+class AllocationScope {
+	AllocationCounts* previous;
+public:
+	explicit AllocationScope (AllocationCounts* counts)
+	: previous(countingAllocations)
+	{
+		countingAllocations = counts;
+	}
+
+	~AllocationScope ()
+	{
+		countingAllocations = previous;
+	}
+};
+
+}
+
+bool CppUnitLite::enableAllocationCounting ()
+{
+	allocationCountingEnabled = true;
+	return true;
+}
+
+UncountedAllocations::UncountedAllocations ()
+: previous(countingAllocations)
+{
+	countingAllocations = nullptr;
+}
+
+UncountedAllocations::~UncountedAllocations ()
+{
+	countingAllocations = static_cast<AllocationCounts*>(previous);
+}
+
+void* CppUnitLite::countedAllocate (std::size_t size, bool throwing)
+{
+	void* block;
+	while ((block = std::malloc(sizeof(AllocationHeader) + size)) == nullptr) {
+		std::new_handler handler = std::get_new_handler();
+		if (handler == nullptr) {
+			if (throwing)
+				throw std::bad_alloc();
+			return nullptr;
+		}
+		if (throwing) {
+			handler();
+		} else {
+			try {
+				handler();
+			} catch (std::bad_alloc&) {
+				return nullptr;
+			}
+		}
+	}
+	AllocationHeader* header = static_cast<AllocationHeader*>(block);
+	header->size = size;
+	header->serial = 0;
+	for (AllocationCounts* c = countingAllocations; c != nullptr; c = c->outer) {
+		++c->allocations;
+		c->bytes += size;
+		if (c->outer == nullptr) {
+			// The outermost counts keep track of what is still live.
+			header->serial = c->serial;
+			++c->liveAllocations;
+			c->peakLiveBytes = std::max(c->peakLiveBytes, c->liveBytes += size);
+		}
+	}
+	return header + 1;
+}
+
+void CppUnitLite::countedFree (void* p) noexcept
+{
+	if (p == nullptr)
+		return;
+	AllocationHeader* header = static_cast<AllocationHeader*>(p) - 1;
+	if (header->serial != 0) {
+		AllocationCounts* owner = countingAllocations;
+		while (owner != nullptr && owner->serial != header->serial)
+			owner = owner->outer;
+		if (owner != nullptr) {
+			--owner->liveAllocations;
+			owner->liveBytes -= header->size;
+		} else {
+			std::lock_guard<std::mutex> l(allocationRegistryMutex);
+			auto pos = allocationRegistry->find(header->serial);
+			if (pos != allocationRegistry->end()) {
+				--pos->second->liveAllocations;
+				pos->second->liveBytes -= header->size;
+			}
+		}
+	}
+	std::free(header);
+}
+
+
+namespace {
+
+// Set by --counters.
+bool countHardwareEvents = false;
+
+// The counts of all of the tests, for the summary.
+UnitTest::HardwareCounters counterTotals;
+
+#if defined(__linux__)
+
+/**
+ * A group of hardware event counters for the calling thread, opened on
+ * its first use and counting from then on. Any event that the machine
+ * or the kernel will not count is left out of the group, and if none
+ * can be counted, nothing is reported.
+ */
+class HardwareCounterGroup {
+	static const int numEvents = 4;
+	int fds[numEvents];
+	int position[numEvents]; // of each event in a read of the group, or -1
+	int leader = -1;
+	int members = 0;
+
+public:
+	HardwareCounterGroup ()
+	{
+		const std::uint64_t events[numEvents] = {PERF_COUNT_HW_CPU_CYCLES,
+				PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+				PERF_COUNT_HW_BRANCH_MISSES};
+		for (int i = 0; i < numEvents; ++i) {
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = events[i];
+			// User space only, as allowed by the default perf_event_paranoid.
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+					| PERF_FORMAT_TOTAL_TIME_RUNNING;
+			fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+			position[i] = -1;
+			if (fds[i] >= 0) {
+				if (leader < 0)
+					leader = fds[i];
+				position[i] = members++;
+			}
+		}
+	}
+
+	~HardwareCounterGroup ()
+	{
+		for (int i = 0; i < numEvents; ++i)
+			if (fds[i] >= 0)
+				::close(fds[i]);
+	}
+
+	HardwareCounterGroup (const HardwareCounterGroup&) = delete;
+	HardwareCounterGroup& operator= (const HardwareCounterGroup&) = delete;
+
+	/**
+	 * @return the counts so far, scaled up for any time that the
+	 *         kernel spent counting other events in their place
+	 */
+	UnitTest::HardwareCounters read () const
+	{
+		UnitTest::HardwareCounters counts;
+		std::uint64_t data[3 + numEvents]; // number, time enabled, time running, values
+		if (leader < 0
+				|| ::read(leader, data, sizeof(data)) < (ssize_t)((3 + members) * sizeof(data[0]))
+				|| data[2] == 0)
+			return counts;
+		double scale = (double)data[1] / data[2];
+		long long* fields[numEvents] = {&counts.cycles, &counts.instructions,
+				&counts.cacheMisses, &counts.branchMisses};
+		for (int i = 0; i < numEvents; ++i)
+			if (position[i] >= 0)
+				*fields[i] = (long long)(data[3 + position[i]] * scale + 0.5);
+		return counts;
+	}
+};
+
+thread_local std::unique_ptr<HardwareCounterGroup> threadCounters;
+
+#endif
+
+// The counts of the calling thread's hardware events so far, if they
+// are being counted.
+UnitTest::HardwareCounters readHardwareCounters ()
+{
+#if defined(__linux__)
+	if (countHardwareEvents) {
+		if (threadCounters == nullptr) {
+			const UncountedAllocations uncounted; // kept for the thread
+			threadCounters.reset(new HardwareCounterGroup());
+		}
+		return threadCounters->read();
+	}
+#endif
+	return UnitTest::HardwareCounters();
+}
+
+UnitTest::HardwareCounters countersBetween (const UnitTest::HardwareCounters& start,
+		const UnitTest::HardwareCounters& end)
+{
+	UnitTest::HardwareCounters counts;
+	if (start.cycles >= 0 && end.cycles >= 0)
+		counts.cycles = end.cycles - start.cycles;
+	if (start.instructions >= 0 && end.instructions >= 0)
+		counts.instructions = end.instructions - start.instructions;
+	if (start.cacheMisses >= 0 && end.cacheMisses >= 0)
+		counts.cacheMisses = end.cacheMisses - start.cacheMisses;
+	if (start.branchMisses >= 0 && end.branchMisses >= 0)
+		counts.branchMisses = end.branchMisses - start.branchMisses;
+	return counts;
+}
+
+void addCounters (UnitTest::HardwareCounters& total, const UnitTest::HardwareCounters& more)
+{
+	long long* totals[] = {&total.cycles, &total.instructions, &total.cacheMisses,
+			&total.branchMisses};
+	const long long values[] = {more.cycles, more.instructions, more.cacheMisses,
+			more.branchMisses};
+	for (int i = 0; i < 4; ++i)
+		if (values[i] >= 0)
+			*totals[i] = std::max(0LL, *totals[i]) + values[i];
+}
+
+// The counters measured, as YAML lines each preceded by a newline and indent.
+void writeCounters (std::ostream& out, const UnitTest::HardwareCounters& counts,
+		const std::string& indent)
+{
+	if (counts.cycles >= 0)
+		out << '\n' << indent << "cycles: " << counts.cycles;
+	if (counts.instructions >= 0)
+		out << '\n' << indent << "instructions: " << counts.instructions;
+	if (counts.cycles > 0 && counts.instructions >= 0)
+		out << '\n' << indent << "instructions_per_cycle: " << std::fixed
+			<< std::setprecision(3) << (double)counts.instructions / counts.cycles;
+	if (counts.cacheMisses >= 0)
+		out << '\n' << indent << "cache_misses: " << counts.cacheMisses;
+	if (counts.branchMisses >= 0)
+		out << '\n' << indent << "branch_misses: " << counts.branchMisses;
+}
+
+}
+
+
+namespace {
+struct StackSamples;
+}
+
+class UnitTest::TestContext {
+public:
+	const std::string name;
+	std::thread::id owner; // the thread running the test itself
+	std::atomic<bool> expectToFail;
+
+	explicit TestContext (const std::string& testName)
+	: name(testName), owner(std::this_thread::get_id()), expectToFail(false),
+	  failed(false), numFailedExpectations(0) {}
+
+	// Keep the first failure raised on another thread.
+	void recordFailure (const std::string& explanation)
+	{
+		std::lock_guard<std::mutex> l(m);
+		if (!failed.load())
+		{
+			failure = explanation;
+			failed = true;
+		}
+	}
+
+	// @return true, and the explanation, if another thread failed.
+	bool failedElsewhere (std::string& explanation)
+	{
+		if (!failed.load())
+			return false;
+		std::lock_guard<std::mutex> l(m);
+		explanation = failure;
+		return true;
+	}
+
+	// Keep a failed expectation.
+	// @return the number of the test's expectations that have failed
+	unsigned recordExpectation (const std::string& explanation)
+	{
+		std::lock_guard<std::mutex> l(m);
+		failedExpectations += explanation;
+		return ++numFailedExpectations;
+	}
+
+	// @return the explanations of the failed expectations, or "" if none
+	std::string expectationFailures ()
+	{
+		if (numFailedExpectations.load() == 0)
+			return "";
+		std::lock_guard<std::mutex> l(m);
+		return failedExpectations;
+	}
+
+	unsigned numExpectationsFailed () const
+	{
+		return numFailedExpectations.load();
+	}
+
+	CallLog callLog;
+	std::string subtests; // TAP subtest lines, to precede the result
+	std::string details; // further lines for the YAML block of the result
+	AllocationCounts allocations;
+
+	// The stacks sampled from the test, if it is being profiled.
+	void profileInto (const std::shared_ptr<StackSamples>& stacks)
+	{
+		std::lock_guard<std::mutex> l(m);
+		samples = stacks;
+	}
+
+	std::shared_ptr<StackSamples> profile ()
+	{
+		std::lock_guard<std::mutex> l(m);
+		return samples;
+	}
+
+	// The totals of the regions measured, in the order first measured.
+	struct Region {
+		std::string label;
+		unsigned calls;
+		UnitTest::TestTiming total;
+	};
+
+	void addRegion (const std::string& label, const UnitTest::TestTiming& timing)
+	{
+		const UncountedAllocations uncounted;
+		std::lock_guard<std::mutex> l(m);
+		Region* region = nullptr;
+		for (Region& r: regions)
+			if (r.label == label)
+				region = &r;
+		if (region == nullptr) {
+			regions.push_back(Region{label, 0, UnitTest::TestTiming(0.0, 0.0)});
+			region = &regions.back();
+		}
+		++region->calls;
+		region->total.wallMS += timing.wallMS;
+		region->total.cpuMS += timing.cpuMS;
+		addCounters(region->total.counters, timing.counters);
+	}
+
+	std::vector<Region> measuredRegions ()
+	{
+		std::lock_guard<std::mutex> l(m);
+		return regions;
+	}
+
+private:
+	std::mutex m;
+	std::atomic<bool> failed;
+	std::string failure;
+	std::atomic<unsigned> numFailedExpectations;
+	std::string failedExpectations;
+	std::vector<Region> regions;
+	std::shared_ptr<StackSamples> samples;
+};
+
+namespace {
+
+// The context adopted by this thread, if any.
+thread_local std::shared_ptr<UnitTest::TestContext> adoptedContext;
+
+// The contexts of the tests now running, for threads that have not
+// adopted one. With one test running, such a thread is taken to be
+// working for it. With several (UnitTestConcurrent) it cannot be told
+// which, so it is given unownedContext, whose failures fail them all.
+std::mutex activeContextMutex;
+std::vector<std::shared_ptr<UnitTest::TestContext>> activeContexts;
+std::shared_ptr<UnitTest::TestContext> outsideContext;
+std::shared_ptr<UnitTest::TestContext> unownedContext;
+
+void activateContext (const std::shared_ptr<UnitTest::TestContext>& context)
+{
+	const UncountedAllocations uncounted;
+	std::lock_guard<std::mutex> l(activeContextMutex);
+	activeContexts.push_back(context);
+}
+
+void deactivateContext (const std::shared_ptr<UnitTest::TestContext>& context)
+{
+	std::lock_guard<std::mutex> l(activeContextMutex);
+	auto pos = std::find(activeContexts.begin(), activeContexts.end(), context);
+	if (pos != activeContexts.end())
+		activeContexts.erase(pos);
+}
+
+// Lists a test as running for as long as it runs.
+struct ActiveContextScope {
+	std::shared_ptr<UnitTest::TestContext> context;
+
+	explicit ActiveContextScope (const std::shared_ptr<UnitTest::TestContext>& c)
+	: context(c)
+	{
+		activateContext(context);
+	}
+
+	~ActiveContextScope ()
+	{
+		deactivateContext(context);
+	}
+};
+
+// A failure on a thread that adopted no context while several tests
+// were running fails each of them, rather than whichever started last.
+void failRunningTests (const std::string& explanation)
+{
+	std::vector<std::shared_ptr<UnitTest::TestContext>> running;
+	{
+		std::lock_guard<std::mutex> l(activeContextMutex);
+		running = activeContexts;
+	}
+	std::string text = "# A thread that adopted no test's context (see UnitTest::propagate)"
+			" failed while " + std::to_string(running.size()) + " tests were running:\n"
+			+ explanation;
+	for (const std::shared_ptr<UnitTest::TestContext>& context: running)
+		context->recordFailure(text);
+}
+
+}
+
+std::shared_ptr<UnitTest::TestContext> UnitTest::currentContext()
 {
-	return std::string("\"") + t + '"';
+	if (adoptedContext != nullptr)
+		return adoptedContext;
+	const UncountedAllocations uncounted;
+	std::lock_guard<std::mutex> l(activeContextMutex);
+	if (activeContexts.size() == 1)
+		return activeContexts.front();
+	if (activeContexts.empty()) {
+		if (outsideContext == nullptr)
+			outsideContext = std::make_shared<TestContext>(""); // outside of any test
+		return outsideContext;
+	}
+	if (unownedContext == nullptr) {
+		unownedContext = std::make_shared<TestContext>("");
+		unownedContext->owner = std::thread::id(); // no thread's own
+	}
+	return unownedContext;
 }
-template <>
-std::string CppUnitLite::getStringRepr(const char t[])
+
+UnitTest::ContextScope::ContextScope (const std::shared_ptr<TestContext>& context)
+: previous(adoptedContext)
 {
-	return CppUnitLite::getStringRepr(std::string(t));
+	adoptedContext = context;
 }
-template <>
-std::string CppUnitLite::getStringRepr(char t)
+
+UnitTest::ContextScope::~ContextScope ()
 {
-	return std::string("'") + t + "'";
+	adoptedContext = previous;
 }
-template <>
-std::string CppUnitLite::getStringRepr(bool b)
+
+void UnitTest::failInContext (const std::shared_ptr<TestContext>& context,
+		const std::string& explanation)
 {
-	return (b) ? "true" : "false";
+	context->recordFailure(explanation);
 }
 
 
@@ -78,10 +789,11 @@ UnitTest::UnitTestFailure::UnitTestFailure (
 		const char* conditionStr,
 		const char* fileName, int lineNumber)
 {
-	if (!UnitTest::expectToFail) {
+	std::shared_ptr<TestContext> context = currentContext();
+	if (!context->expectToFail.load()) {
 		std::ostringstream out;
 		out << "Failed assertion " << conditionStr
-				<< " in " << currentTest
+				<< " in " << context->name
 				<< " at " << fileName << ", line "
 				<< lineNumber << "\n";
 		explanation = out.str();
@@ -94,7 +806,7 @@ UnitTest::UnitTestFailure::UnitTestFailure (
 		const std::string& conditionStr,
 		const char* fileName, int lineNumber)
 {
-	if (!UnitTest::expectToFail) {
+	if (!currentContext()->expectToFail.load()) {
 		std::ostringstream out;
 		out << fileName << ":" << lineNumber
 				<< ": \t" << conditionStr << "\n";
@@ -110,34 +822,67 @@ const char* UnitTest::UnitTestFailure::what() const noexcept {
 
 
 AssertionResult::AssertionResult (bool theResult, std::string pexplain, std::string fexplain)
- : result(theResult), passExplanation(pexplain), failExplanation(fexplain)
+ : result(theResult),
+   explainer([pexplain, fexplain] (bool passed) { return (passed) ? pexplain : fexplain; }),
+   inverted(false)
+{}
+
+AssertionResult::AssertionResult (bool theResult, const char* pexplain, const char* fexplain)
+ : result(theResult),
+   explainer([pexplain, fexplain] (bool passed) {
+	  const char* explanation = (passed) ? pexplain : fexplain;
+	  return std::string((explanation != nullptr) ? explanation : "");
+   }),
+   inverted(false)
+{}
+
+AssertionResult::AssertionResult (bool theResult, Explainer explain)
+ : result(theResult), explainer(std::move(explain)), inverted(false)
 {}
 
+std::string AssertionResult::passExplanation() const
+{
+	return (explainer) ? explainer(!inverted) : std::string();
+}
+
+std::string AssertionResult::failExplanation() const
+{
+	return (explainer) ? explainer(inverted) : std::string();
+}
+
+AssertionResult AssertionResult::negated() const
+{
+	AssertionResult opposite (*this);
+	opposite.result = !result;
+	opposite.inverted = !inverted;
+	return opposite;
+}
+
 
 #ifdef __MINGW32__
 
-bool UnitTest::debuggerIsRunning()
+bool UnitTest::Runner::detectDebugger()
 {
 	return IsDebuggerPresent();
 }
 #elif __CYGWIN__
 
-bool UnitTest::debuggerIsRunning()
+bool UnitTest::Runner::detectDebugger()
 {
 	bool debuggerDetected = IsDebuggerPresent();
     if (debuggerDetected)
     {
-   	 UnitTest::msg("# Debugger detected -- test time limits will be ignored.\n");
+   	 reportDiagnostic("# Debugger detected -- test time limits will be ignored.\n");
     }
     return debuggerDetected;
 }
 
 #else
-bool UnitTest::debuggerIsRunning()
+bool UnitTest::Runner::detectDebugger()
 {
 	using namespace std;
 
-     static bool debuggerDetected = false;
+     bool debuggerDetected = false;
      const string traceField = "tracerpid";
 
      int pid = ::getpid();
@@ -166,393 +911,4132 @@ bool UnitTest::debuggerIsRunning()
      }
      if (debuggerDetected)
      {
-    	 UnitTest::msg("# Debugger detected -- test time limits will be ignored.\n");
+    	 reportDiagnostic("# Debugger detected -- test time limits will be ignored.\n");
      }
      return debuggerDetected;
 }
 #endif
 
+// The debugger is probed only once, the first time this is called.
+bool UnitTest::debuggerIsRunning()
+{
+	static const bool debuggerDetected = Runner::detectDebugger();
+	return debuggerDetected;
+}
+
 
-void UnitTest::checkTest (AssertionResult assertionResult, std::string conditionStr,
+// The exception to be thrown, or the failure recorded, by a failed
+// assertion or expectation.
+UnitTest::UnitTestFailure UnitTest::failureOf (const AssertionResult& assertionResult,
+		const std::string& conditionStr,
 		const char* fileName, int lineNumber)
 {
-	if (!assertionResult.result)
+	std::string failExplanation = assertionResult.failExplanation();
+	if (debuggerIsRunning())
 	{
-		if (debuggerIsRunning())
-		{
-			std::string explanation = "Failed assertion: " + conditionStr
-					+ "\n" + assertionResult.failExplanation;
-			breakDebugger;
-			// A unit test has failed.
-			// Examine explanation and your call stack for information
-			explanation = explanation + " ";
-		}
-		if (assertionResult.failExplanation.size() > 0)
-		{
-			conditionStr += "\n\t" + assertionResult.failExplanation;
-		}
-		throw UnitTestFailure(conditionStr, fileName, lineNumber);
+		std::string explanation = "Failed assertion: " + conditionStr
+				+ "\n" + failExplanation;
+		breakDebugger;
+		// A unit test has failed.
+		// Examine explanation and your call stack for information
+		explanation = explanation + " ";
 	}
+	return (failExplanation.size() > 0)
+			? UnitTestFailure(conditionStr + "\n\t" + failExplanation,
+				fileName, lineNumber)
+			: UnitTestFailure(conditionStr, fileName, lineNumber);
 }
 
+void UnitTest::assertionFailed (const AssertionResult& assertionResult,
+		const std::string& conditionStr,
+		const char* fileName, int lineNumber)
+{
+	const UncountedAllocations uncounted;
+	UnitTestFailure failure = failureOf(assertionResult, conditionStr, fileName, lineNumber);
+	// The test's own thread will report this when it catches it. Any
+	// other thread could not, so it is passed back to the test.
+	std::shared_ptr<TestContext> context = currentContext();
+	if (context->owner == std::thread::id()) // unownedContext
+		failRunningTests(failure.what());
+	else if (context->owner != std::this_thread::get_id())
+		context->recordFailure(failure.what());
+	throw failure;
+}
 
+void UnitTest::expectationFailed (const AssertionResult& assertionResult,
+		const std::string& conditionStr,
+		const char* fileName, int lineNumber)
+{
+	const UncountedAllocations uncounted;
+	std::shared_ptr<TestContext> context = currentContext();
+	if (context->owner == std::thread::id()) { // unownedContext
+		failRunningTests(failureOf(assertionResult, conditionStr, fileName, lineNumber).what());
+		return;
+	}
+	unsigned numFailed = context->recordExpectation(
+			failureOf(assertionResult, conditionStr, fileName, lineNumber).what());
+	if (numFailed < Runner::maxFailedExpectations)
+		return;
+	UnitTestFailure failure ("stopped after " + std::to_string(numFailed)
+			+ " failed expectations", fileName, lineNumber);
+	if (context->owner != std::this_thread::get_id())
+		context->recordFailure(failure.what());
+	throw failure;
+}
 
 
-//void UnitTest::checkTest (bool condition, const string& conditionStr,
-//		const char* fileName, int lineNumber)
-//{
-//	checkTest(AssertionResult(condition), conditionStr.c_str(), fileName, lineNumber);
-//}
+namespace {
 
+// Set by --rows and --data-parts.
+unsigned long dataFirstRow = 1;
+unsigned long dataLastRow = std::numeric_limits<unsigned long>::max();
+unsigned dataParts = 1;
 
+// Set by --property-cases and --seed.
+unsigned long propertyCases = 100;
+std::uint64_t propertySeed = 0;
+bool propertySeedGiven = false;
 
-// Print a simple summary report
-void UnitTest::report ()
+/**
+ * Which of the --data-parts of a data-driven test or property is being
+ * run, from the test's name: test[kofN].
+ *
+ * @param part set to k-1, or 0 if the test is not split
+ * @param parts set to N, or 1 if the test is not split
+ */
+void testPart (const std::string& testName, unsigned long& part, unsigned long& parts)
 {
-	UnitTest::msgSummary();
+	part = 0;
+	parts = 1;
+	std::string::size_type open = testName.rfind('[');
+	unsigned long k, n;
+	if (open != std::string::npos
+			&& std::sscanf(testName.c_str() + open, "[%luof%lu]", &k, &n) == 2
+			&& k >= 1 && k <= n)
+	{
+		part = k - 1;
+		parts = n;
+	}
 }
 
+}
 
-// Register a new UnitTest
-int UnitTest::registerUT (std::string functName, int timeLimit, TestFunction funct)
+namespace {
+
+/**
+ * Scan the CSV field at pos, leaving pos at the start of the next.
+ * A field is quoted only if it starts with a quote.
+ *
+ * @param start, stop set to the field's text, without its quotes
+ * @return true if the field ended its row
+ */
+bool scanCsvField (const char*& pos, const char* end, const char*& start, const char*& stop)
 {
-	if (tests == nullptr)
-	{
-		tests = new std::map<std::string, UnitTest::BoundedTest>();
+	start = pos;
+	if (pos < end && *pos == '"') {
+		start = ++pos;
+		while (pos < end && !(*pos == '"' && (pos + 1 == end || pos[1] != '"')))
+			pos += (*pos == '"') ? 2 : 1;
+		stop = std::min(pos, end);
+		while (pos < end && *pos != ',' && *pos != '\n')
+			++pos; // the closing quote, and anything up to the next field
+	} else {
+		while (pos < end && *pos != ',' && *pos != '\n')
+			++pos;
+		stop = pos;
+		if (stop > start && stop[-1] == '\r')
+			--stop;
 	}
-	if (tests->count(functName) > 0) {
-		std::cerr << "**Error: duplicate unit test named " << functName << std::endl;
+	return pos >= end || *pos++ == '\n';
+}
+
+}
+
+const CsvRow* DataRows<CsvRow>::read (const char*& pos, const char* end, CsvRow& row)
+{
+	if (pos >= end)
+		return nullptr;
+	row.fields.clear();
+	for (;;) {
+		const char* start;
+		const char* stop;
+		bool rowEnded = scanCsvField(pos, end, start, stop);
+		row.fields.push_back(TextLine(start, stop - start));
+		if (rowEnded)
+			return &row;
 	}
-	(*tests)[functName] = BoundedTest(timeLimit, funct);
-	return 0;
 }
 
-jmp_buf unitTestSignalEnv;
-int unitTestLastSignal = 0;
+bool DataRows<CsvRow>::skip (const char*& pos, const char* end)
+{
+	if (pos >= end)
+		return false;
+	const char* start;
+	const char* stop;
+	while (!scanCsvField(pos, end, start, stop))
+		;
+	return true;
+}
+
+DataTestRun::DataTestRun (const char* path, const char* file, int line)
+: data(""), size(0), mapped(false), fileName(file), lineNumber(line),
+  firstRow(dataFirstRow), lastRow(dataLastRow), part(0), parts(1), row(0),
+  numRun(0), numFailed(0), expectationsBefore(0)
+{
+	testPart(UnitTest::currentContext()->name, part, parts);
 
-void unitTestSignalHandler(int sig) {
-	unitTestLastSignal = sig;
-	longjmp (unitTestSignalEnv, sig);
+	bool readable = false;
+#ifndef __MINGW32__
+	int fd = ::open(path, O_RDONLY);
+	struct stat info;
+	if (fd >= 0 && ::fstat(fd, &info) == 0) {
+		size = info.st_size;
+		void* start = (size > 0)
+				? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+		if (start != MAP_FAILED) {
+			::madvise(start, size, MADV_SEQUENTIAL);
+			data = (const char*)start;
+			mapped = true;
+		}
+		readable = mapped || size == 0;
+	}
+	if (fd >= 0)
+		::close(fd);
+#endif
+	if (!readable) {
+		std::ifstream in (path, std::ios::binary);
+		if (in.is_open() == false)
+			throw UnitTest::UnitTestFailure(std::string("cannot read data file ") + path,
+					fileName, lineNumber);
+		contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		data = contents.data();
+		size = contents.size();
+	}
 }
 
-int UnitTest::runTestGuarded (unsigned testNumber, std::string testName, TestFunction u,
-		std::string& testExplanation)
+DataTestRun::~DataTestRun ()
 {
-	currentTest = testName;
-	expectToFail = false;
-	try {
-		signal(SIGFPE, &unitTestSignalHandler);
-		signal(SIGSEGV, &unitTestSignalHandler);
-		if (setjmp(unitTestSignalEnv)) {
-			// Runtime error was caught
-			std::ostringstream out;
-			out << "# runtime error " << unitTestLastSignal;
-			if (!expectToFail) {
-				testExplanation =  UnitTest::msgFailed(testNumber, testName, out.str(), 0);
-				return -1;
-			} else {
+#ifndef __MINGW32__
+	if (mapped)
+		::munmap((void*)data, size);
+#endif
+}
+
+void DataTestRun::start (unsigned long rowNumber)
+{
+	row = rowNumber;
+	++numRun;
+	expectationsBefore = UnitTest::currentContext()->numExpectationsFailed();
+}
+
+void DataTestRun::passed ()
+{
+	if (UnitTest::currentContext()->numExpectationsFailed() > expectationsBefore)
+		failed("failed expectations, listed with the test's result");
+	else
+		results += "    ok " + std::to_string(numRun) + " - row " + std::to_string(row) + "\n";
+}
+
+void DataTestRun::failed (const std::string& explanation)
+{
+	++numFailed;
+	results += "    not ok " + std::to_string(numRun) + " - row " + std::to_string(row) + "\n";
+	std::string text = explanation;
+	while (!text.empty() && text.back() == '\n')
+		text.pop_back();
+	std::istringstream lines (UnitTest::msgComment(text));
+	std::string line;
+	while (std::getline(lines, line))
+		results += "    " + line + "\n";
+}
+
+void DataTestRun::finish ()
+{
+	std::shared_ptr<UnitTest::TestContext> context = UnitTest::currentContext();
+	const UncountedAllocations uncounted; // kept after the test
+	context->subtests = "# Subtest: " + context->name + "\n" + results
+			+ "    1.." + std::to_string(numRun) + "\n";
+	if (numFailed > 0)
+		throw UnitTest::UnitTestFailure(std::to_string(numFailed) + " of "
+				+ std::to_string(numRun) + " rows failed", fileName, lineNumber);
+}
+
+
+PropertyRun::PropertyRun (const char* file, int line)
+: fileName(file), lineNumber(line), seed(propertySeed), numCases(propertyCases),
+  caseNumber(0)
+{
+	testPart(UnitTest::currentContext()->name, part, parts);
+	caseNumber = part;
+}
+
+bool PropertyRun::next (Random& random, unsigned& size)
+{
+	if (caseNumber >= numCases)
+		return false;
+	// Mixed, so that nearby seeds and cases give unrelated values.
+	random = Random(Random(seed ^ (0x632be59bd9b4e019ULL * (caseNumber + 1))).next());
+	size = (numCases > 1) ? 1 + (unsigned)(caseNumber * 99 / (numCases - 1)) : 100;
+	caseNumber += parts;
+	return true;
+}
+
+void PropertyRun::falsified (const std::string& values, const std::string& explanation,
+		unsigned numShrinks)
+{
+	std::string text = explanation;
+	while (!text.empty() && text.back() == '\n')
+		text.pop_back();
+	throw UnitTest::UnitTestFailure("property failed with seed " + std::to_string(seed)
+			+ " on set " + std::to_string(caseNumber - parts + 1) + " of "
+			+ std::to_string(numCases) + ", shrunk " + std::to_string(numShrinks)
+			+ " times to" + values + "\n" + text, fileName, lineNumber);
+}
+
+
+
+namespace {
+
+// Where this thread's output goes instead, while it runs a test on the
+// thread pool.
+thread_local std::string* capturedOutput = nullptr;
+
+/**
+ * The destination of all TAP output, installed as std::cout's buffer so
+ * that the output of the tests themselves stays in order with the
+ * results.
+ *
+ * Output is collected in a large buffer and written in batches: when the
+ * buffer fills, when the stream is flushed, or when output has been held
+ * for more than a fraction of a second. flush() uses only write(), so
+ * that it can also be called from a signal handler to save the buffered
+ * results before a crash ends the process.
+ */
+class OutputSink: public std::streambuf {
+	static const std::size_t capacity = 64 * 1024;
+	char buffer[capacity];
+	volatile std::size_t length = 0;
+	int fd = STDOUT_FILENO;
+	std::mutex m;
+	std::chrono::steady_clock::time_point lastFlush = std::chrono::steady_clock::now();
+
+	void append (const char* data, std::size_t n)
+	{
+		if (capturedOutput != nullptr) {
+			const UncountedAllocations uncounted;
+			capturedOutput->append(data, n);
+			return;
+		}
+		std::lock_guard<std::mutex> l(m);
+		while (n > 0) {
+			if (length == capacity)
+				flush();
+			std::size_t chunk = std::min(n, capacity - length);
+			std::memcpy(buffer + length, data, chunk);
+			length = length + chunk;
+			data += chunk;
+			n -= chunk;
+		}
+	}
+
+protected:
+	int overflow (int c) override
+	{
+		if (c != traits_type::eof()) {
+			char ch = (char)c;
+			append(&ch, 1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	std::streamsize xsputn (const char* data, std::streamsize n) override
+	{
+		append(data, n);
+		return n;
+	}
+
+	int sync () override
+	{
+		if (capturedOutput != nullptr)
+			return 0;
+		std::lock_guard<std::mutex> l(m);
+		return flush() ? 0 : -1;
+	}
+
+public:
+	/**
+	 * Write out everything buffered so far. Async-signal-safe.
+	 */
+	bool flush ()
+	{
+		std::size_t written = 0;
+		bool ok = true;
+		while (written < length) {
+			ssize_t n = ::write(fd, buffer + written, length - written);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0) {
+				ok = false;
+				break;
+			}
+			written += n;
+		}
+		length = 0;
+		lastFlush = std::chrono::steady_clock::now();
+		return ok;
+	}
+
+	/**
+	 * Flush if output has been waiting for a while, so that someone
+	 * watching a slow test run still sees its progress. Called as each
+	 * result is written, as each test starts, and while a timed test
+	 * runs.
+	 */
+	void flushIfStale ()
+	{
+		using namespace std::chrono;
+		std::lock_guard<std::mutex> l(m);
+		if (steady_clock::now() - lastFlush > milliseconds(250))
+			flush();
+	}
+
+	/**
+	 * Send all subsequent output to a different file descriptor.
+	 */
+	void redirect (int newFD)
+	{
+		std::lock_guard<std::mutex> l(m);
+		flush();
+		fd = newFD;
+	}
+};
+
+// Never deleted, so that it outlives anything written during exit.
+OutputSink* outputSink = nullptr;
+std::streambuf* originalCoutBuffer = nullptr;
+
+void flushOutputAtExit ()
+{
+	outputSink->flush();
+	std::cout.rdbuf(originalCoutBuffer);
+}
+
+void flushOutputOnSignal (int sig)
+{
+	outputSink->flush();
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+// Signals after which the buffered output is flushed before the
+// process dies.
+const int fatalSignals[] = {
+		SIGABRT, SIGSEGV, SIGFPE, SIGILL, SIGINT, SIGTERM,
+#ifdef SIGBUS
+		SIGBUS,
+#endif
+};
+
+// Route std::cout through the output sink.
+void installOutputSink ()
+{
+	if (outputSink != nullptr)
+		return;
+	std::cout.flush();
+	outputSink = new OutputSink();
+	originalCoutBuffer = std::cout.rdbuf(outputSink);
+	std::atexit(&flushOutputAtExit);
+	for (int sig: fatalSignals) {
+		// Leave alone any handler that the program installed itself.
+		void (*previous)(int) = signal(sig, &flushOutputOnSignal);
+		if (previous != SIG_DFL)
+			signal(sig, previous);
+	}
+}
+
+// When the current run of the tests started.
+std::chrono::steady_clock::time_point runStarted;
+
+// Set when a test is left running past its time limit, which may
+// still be using the fixtures.
+std::atomic<bool> testsAbandoned (false);
+
+}
+
+long UnitTest::getNumTests()     {return Runner::numSuccesses + Runner::numFailures;}
+long UnitTest::getNumFailures()  {return Runner::numFailures;}
+long UnitTest::getNumErrors()    {return Runner::numErrors;}
+long UnitTest::getNumSuccesses() {return Runner::numSuccesses;}
+
+void UnitTest::runTests (int nTests, char** testNames, char* programName)
+{
+	Runner::runTests(nTests, testNames, programName);
+}
+
+void UnitTest::report ()
+{
+	Runner::report();
+}
+
+
+// Print a simple summary report
+void UnitTest::Runner::report ()
+{
+	if (listOnly)
+		return;
+	std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now() - runStarted;
+	RunSummary totals = {numSuccesses, numFailures, numErrors, numSkipped, elapsed.count()};
+	if (reporters.empty())
+		addReporter(std::make_shared<TapReporter>());
+	for (const std::shared_ptr<Reporter>& reporter: reporters)
+		reporter->summary(totals);
+	if (testsAbandoned) {
+		// A test is still running, on a thread that cannot be stopped,
+		// so the process must not go on to destroy what it may be using.
+		std::cout.flush();
+		std::fflush(nullptr);
+		::_exit(0);
+	}
+}
+
+void UnitTest::addReporter (std::shared_ptr<Reporter> reporter)
+{
+	Runner::reporters.push_back(reporter);
+}
+
+void UnitTest::Runner::startReporters (unsigned numTests)
+{
+	for (const std::shared_ptr<Reporter>& reporter: reporters)
+		reporter->start(numTests);
+}
+
+// Report a message about the run, rather than about a test, to every
+// reporter (or, before there are any, to the standard output).
+void UnitTest::Runner::reportDiagnostic (const std::string& text)
+{
+	if (reporters.empty())
+		msg(text);
+	for (const std::shared_ptr<Reporter>& reporter: reporters)
+		reporter->diagnostic(text);
+}
+
+
+namespace {
+
+// The abbreviation of a camelCase test name: its first character
+// followed by its capital letters, e.g. "tI" for "testIncrement".
+std::string abbreviate (const std::string& testName)
+{
+	std::string reducedName (testName, 0, 1);
+	for (unsigned j = 1; j < testName.size(); ++j)
+	{
+		if (testName[j] >= 'A' && testName[j] <= 'Z')
+		{
+			reducedName += testName[j];
+		}
+	}
+	return reducedName;
+}
+
+}
+
+// Register a new UnitTest
+int UnitTest::registerUT (std::string functName, int timeLimit, TestFunction funct,
+		bool concurrent, bool benchmark)
+{
+	// Kept for the life of the program, like the static registrations.
+	const char* name = (new std::string(functName))->c_str();
+	new Registration(name, timeLimit, funct, concurrent, benchmark);
+	if (Runner::tests != nullptr)
+	{
+		if (Runner::tests->count(functName) > 0) {
+			std::cerr << "**Error: duplicate unit test named " << functName << std::endl;
+		}
+		(*Runner::tests)[functName] = Runner::BoundedTest(timeLimit, funct, abbreviate(functName),
+				concurrent, benchmark);
+	}
+	return 0;
+}
+
+// Build the map of tests from the registrations, the first time
+// that it is needed.
+void UnitTest::Runner::indexTests ()
+{
+	if (tests != nullptr)
+		return;
+	tests = new std::map<std::string, BoundedTest>();
+	for (const Registration* r = registrations; r != nullptr; r = r->next)
+	{
+		std::string functName = r->name;
+		if (tests->count(functName) > 0) {
+			std::cerr << "**Error: duplicate unit test named " << functName << std::endl;
+		}
+		(*tests)[functName] = BoundedTest(r->timeLimit, r->function, abbreviate(functName),
+				r->concurrent, r->benchmark, r->fixture, r->data);
+	}
+}
+
+namespace {
+
+// The teardowns of the fixtures constructed so far, in that order.
+std::vector<void (*)()>* fixtureTeardowns = nullptr;
+
+}
+
+std::recursive_mutex& UnitTest::Runner::fixtureMutex ()
+{
+	static std::recursive_mutex m;
+	return m;
+}
+
+UnitTest::FixtureLock::FixtureLock ()
+{
+	Runner::fixtureMutex().lock();
+}
+
+UnitTest::FixtureLock::~FixtureLock ()
+{
+	Runner::fixtureMutex().unlock();
+}
+
+void UnitTest::addFixtureTeardown (void (*teardown)())
+{
+	if (fixtureTeardowns == nullptr)
+		fixtureTeardowns = new std::vector<void (*)()>();
+	fixtureTeardowns->push_back(teardown);
+}
+
+// Build the fixtures of the tests to be run, before any of them is
+// timed, and before any worker process is forked, so that the workers
+// share them (copy-on-write) instead of each building its own. A
+// fixture that cannot be built is left to fail the tests that use it.
+void UnitTest::Runner::prepareFixtures (const std::vector<std::string>& testNames)
+{
+	for (const std::string& testName: testNames) {
+		TestFunction prepare = (*tests)[testName].fixture;
+		if (prepare == nullptr)
+			continue;
+		try {
+			prepare();
+		} catch (...) {
+		}
+	}
+}
+
+// Destroy the fixtures, the last constructed first.
+void UnitTest::Runner::destroyFixtures ()
+{
+	std::lock_guard<std::recursive_mutex> l(fixtureMutex());
+	if (fixtureTeardowns == nullptr || testsAbandoned.load())
+		return;
+	while (!fixtureTeardowns->empty()) {
+		void (*teardown)() = fixtureTeardowns->back();
+		fixtureTeardowns->pop_back();
+		teardown();
+	}
+}
+
+#ifndef __MINGW32__
+
+namespace {
+
+// In a worker process, the write end of its pipe to the parent.
+int workerResultFd = -1;
+
+// Send a binary record to the parent, which is gone if it cannot be sent.
+void sendWorkerMessage (int fd, BinaryReporter::Kind kind, unsigned testIndex,
+		int testResult, const std::string& text,
+		const UnitTest::TestTiming& timing = UnitTest::TestTiming())
+{
+	if (!BinaryReporter(fd).record(kind, testIndex + 1, testResult, text, timing))
+		::_exit(3);
+}
+
+}
+
+#endif
+
+namespace {
+
+// CPU time used so far by the calling thread (by the whole process, where
+// per-thread times are unavailable), in milliseconds.
+double cpuTimeMS ()
+{
+#ifndef __MINGW32__
+	timespec t;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t) == 0)
+		return t.tv_sec * 1000.0 + t.tv_nsec / 1.0e6;
+#endif
+	return std::clock() * 1000.0 / CLOCKS_PER_SEC;
+}
+
+// Measures the wall and CPU time, and any hardware events, since its
+// construction.
+class TestClock {
+	UnitTest::HardwareCounters countersStart;
+	std::chrono::steady_clock::time_point wallStart;
+	double cpuStart;
+public:
+	TestClock ()
+	: countersStart(readHardwareCounters()), wallStart(std::chrono::steady_clock::now()),
+	  cpuStart(cpuTimeMS())
+	{}
+
+	UnitTest::TestTiming elapsed () const
+	{
+		double cpu = cpuTimeMS() - cpuStart;
+		std::chrono::duration<double, std::milli> wall =
+				std::chrono::steady_clock::now() - wallStart;
+		UnitTest::TestTiming timing (wall.count(), cpu);
+		timing.counters = countersBetween(countersStart, readHardwareCounters());
+		return timing;
+	}
+};
+
+}
+
+// Per thread, since a signal is handled on the thread that raised it.
+thread_local jmp_buf unitTestSignalEnv;
+thread_local int unitTestLastSignal = 0;
+
+// Set on the threads of the test pool, for which the handlers are
+// installed once for all of the tests.
+thread_local bool signalsAlreadyGuarded = false;
+
+void unitTestSignalHandler(int sig) {
+	unitTestLastSignal = sig;
+	longjmp (unitTestSignalEnv, sig);
+}
+
+namespace {
+
+// Catches run-time errors for the duration of a single test, then
+// restores whatever handlers were there before.
+class TestSignalGuard {
+	void (*previousFPE)(int) = nullptr;
+	void (*previousSEGV)(int) = nullptr;
+	bool installed = false;
+public:
+	void install ()
+	{
+		previousFPE = signal(SIGFPE, &unitTestSignalHandler);
+		previousSEGV = signal(SIGSEGV, &unitTestSignalHandler);
+		installed = true;
+	}
+
+	~TestSignalGuard ()
+	{
+		if (installed) {
+			signal(SIGFPE, previousFPE);
+			signal(SIGSEGV, previousSEGV);
+		}
+	}
+};
+
+}
+
+// Add a test's heap use to the details of its result, and fail it
+// on a leak if asked to.
+void UnitTest::Runner::reportAllocations (TestContext& context, std::string& details)
+{
+	const AllocationCounts& counts = context.allocations;
+	std::ostringstream out;
+	if (details != "")
+		out << '\n';
+	long long leakedBytes = counts.liveBytes.load();
+	long long leakedAllocations = counts.liveAllocations.load();
+	out << "allocations: " << counts.allocations
+		<< "\nallocated_bytes: " << counts.bytes
+		<< "\npeak_live_bytes: " << counts.peakLiveBytes;
+	if (leakedBytes > 0)
+		out << "\nleaked_bytes: " << leakedBytes
+			<< "\nleaked_allocations: " << leakedAllocations;
+	details += out.str();
+	if (failOnLeaks && leakedBytes > 0)
+		context.recordFailure("# " + context.name + " leaked " + std::to_string(leakedBytes)
+				+ " bytes in " + std::to_string(leakedAllocations)
+				+ ((leakedAllocations == 1) ? " allocation" : " allocations"));
+}
+
+namespace {
+
+// A label as a YAML key, quoted unless it is a plain word.
+std::string yamlKey (const std::string& label)
+{
+	bool plain = !label.empty();
+	for (char c: label)
+		plain = plain && (std::isalnum((unsigned char)c) || c == '_' || c == '-' || c == '.');
+	if (plain)
+		return label;
+	std::string quoted = "\"";
+	for (char c: label) {
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		quoted += c;
+	}
+	return quoted + '"';
+}
+
+}
+
+// Add the totals of the regions measured by a test to the details of
+// its result.
+void UnitTest::Runner::reportRegions (TestContext& context, std::string& details)
+{
+	std::vector<TestContext::Region> regions = context.measuredRegions();
+	if (regions.empty())
+		return;
+	std::ostringstream out;
+	if (details != "")
+		out << '\n';
+	out << "regions:";
+	for (const TestContext::Region& region: regions) {
+		out << "\n  " << yamlKey(region.label) << ':'
+			<< "\n    calls: " << region.calls
+			<< std::fixed << std::setprecision(3)
+			<< "\n    duration_ms: " << region.total.wallMS
+			<< "\n    cpu_ms: " << region.total.cpuMS;
+		writeCounters(out, region.total.counters, "    ");
+	}
+	details += out.str();
+}
+
+UnitTest::TestTiming UnitTest::measure (const std::string& label,
+		const Callable<void()>& region)
+{
+	const TestClock clock;
+	region();
+	TestTiming timing = clock.elapsed();
+	currentContext()->addRegion(label, timing);
+	return timing;
+}
+
+namespace {
+
+// Set by --profile-slow and --profile-dir.
+double profileFraction = -1.0;
+std::string profileDirectory = ".";
+
+#if defined(__linux__)
+
+/**
+ * The stacks sampled from a test's thread, on a timer of the thread's
+ * CPU time. Each thread keeps its own buffer, allocated once, which
+ * holds the latest samples.
+ */
+struct StackSamples {
+	static const int maxDepth = 64;
+	static const unsigned capacity = 1024;
+	static const long intervalNS = 1000000L; // one sample per millisecond of CPU
+
+	struct Sample {
+		int depth;
+		void* frames[maxDepth];
+	};
+	Sample samples[capacity];
+	std::atomic<unsigned> taken;
+	Sample base; // the stack when sampling started
+	timer_t timer;
+	std::atomic<bool> armed;
+
+	StackSamples (): taken(0), armed(false) {}
+};
+
+// The samples being taken on this thread, for the signal handler.
+thread_local StackSamples* samplingInto = nullptr;
+thread_local std::shared_ptr<StackSamples> threadSamples;
+
+void takeStackSample (int)
+{
+	StackSamples* s = samplingInto;
+	if (s == nullptr)
+		return;
+	int savedErrno = errno;
+	StackSamples::Sample& sample = s->samples[s->taken.fetch_add(1) % StackSamples::capacity];
+	sample.depth = backtrace(sample.frames, StackSamples::maxDepth);
+	errno = savedErrno;
+}
+
+void installProfiler ()
+{
+	void* warmUp[1];
+	backtrace(warmUp, 1); // loads the unwinder, which the handler must not
+	struct sigaction action;
+	std::memset(&action, 0, sizeof(action));
+	action.sa_handler = &takeStackSample;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGPROF, &action, nullptr);
+}
+
+// Start sampling the calling thread, which is about to run a test.
+std::shared_ptr<StackSamples> startProfiling ()
+{
+	if (threadSamples == nullptr)
+		threadSamples = std::make_shared<StackSamples>();
+	std::shared_ptr<StackSamples> s = threadSamples;
+	s->taken = 0;
+	s->base.depth = backtrace(s->base.frames, StackSamples::maxDepth);
+	sigevent event;
+	std::memset(&event, 0, sizeof(event));
+	event.sigev_notify = SIGEV_THREAD_ID;
+	event.sigev_signo = SIGPROF;
+#ifdef sigev_notify_thread_id
+	event.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+#else
+	event._sigev_un._tid = (pid_t)syscall(SYS_gettid);
+#endif
+	if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &s->timer) != 0)
+		return nullptr;
+	itimerspec interval;
+	interval.it_interval.tv_sec = 0;
+	interval.it_interval.tv_nsec = StackSamples::intervalNS;
+	interval.it_value = interval.it_interval;
+	samplingInto = s.get();
+	s->armed = true;
+	timer_settime(s->timer, 0, &interval, nullptr);
+	return s;
+}
+
+// Stop sampling, from any thread.
+void stopProfiling (StackSamples& s)
+{
+	if (s.armed.exchange(false))
+		timer_delete(s.timer);
+}
+
+// The name of the function containing an address, demangled where
+// possible, or else its module and offset.
+std::string frameName (void* address)
+{
+	char** symbols = backtrace_symbols(&address, 1);
+	if (symbols == nullptr)
+		return "??";
+	std::string symbol = symbols[0]; // module(name+offset) [address]
+	std::free(symbols);
+	std::string::size_type open = symbol.find('(');
+	std::string::size_type plus = symbol.find('+', open);
+	std::string::size_type close = symbol.find(')', open);
+	if (open == std::string::npos || close == std::string::npos)
+		return symbol;
+	std::string name;
+	if (plus != std::string::npos && plus > open + 1 && plus < close) {
+		std::string mangled = symbol.substr(open + 1, plus - open - 1);
+		int status = 0;
+		char* demangled = abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+		name = (status == 0 && demangled != nullptr) ? demangled : mangled;
+		std::free(demangled);
+	} else {
+		std::string module = symbol.substr(0, open);
+		std::string::size_type slash = module.rfind('/');
+		if (slash != std::string::npos)
+			module = module.substr(slash + 1);
+		name = module + symbol.substr(open + 1, close - open - 1);
+	}
+	std::replace(name.begin(), name.end(), ';', ':'); // the separator of the stacks
+	return name;
+}
+
+/**
+ * Write the collapsed stacks ("outer;inner count" lines, as read by
+ * flamegraph.pl) of a test's samples to a file.
+ *
+ * @return a TAP comment listing the frames where the most samples fell
+ */
+std::string reportProfile (const std::string& testName, StackSamples& s)
+{
+	const unsigned numHotFrames = 5;
+	unsigned taken = std::min(s.taken.load(), unsigned(StackSamples::capacity));
+	if (taken == 0)
+		return "";
+	std::unordered_map<void*, std::string> names;
+	std::map<std::string, unsigned> stacks;
+	std::map<std::string, unsigned> selfCounts;
+	for (unsigned i = 0; i < taken; ++i) {
+		const StackSamples::Sample& sample = s.samples[i];
+		// Leave out the signal handler and its trampoline, and the frames
+		// shared with the stack that started sampling, which end with the
+		// one calling the test function.
+		int innermost = 2;
+		int outermost = sample.depth;
+		int shared = 0;
+		while (shared < outermost && shared < s.base.depth
+				&& sample.frames[outermost - 1 - shared] == s.base.frames[s.base.depth - 1 - shared])
+			++shared;
+		if (shared > 0)
+			outermost -= shared + 1;
+		if (outermost <= innermost)
+			continue;
+		std::string stack;
+		for (int f = outermost - 1; f >= innermost; --f) {
+			auto pos = names.find(sample.frames[f]);
+			if (pos == names.end())
+				pos = names.emplace(sample.frames[f], frameName(sample.frames[f])).first;
+			if (stack != "")
+				stack += ';';
+			stack += pos->second;
+			if (f == innermost)
+				++selfCounts[pos->second];
+		}
+		++stacks[stack];
+	}
+
+	std::string path = profileDirectory + "/" + testName + ".folded";
+	std::ofstream out (path);
+	for (const auto& stack: stacks)
+		out << stack.first << ' ' << stack.second << '\n';
+	bool written = out.good();
+
+	std::vector<std::pair<unsigned, std::string>> hot;
+	for (const auto& frame: selfCounts)
+		hot.emplace_back(frame.second, frame.first);
+	std::sort(hot.begin(), hot.end(),
+			[] (const std::pair<unsigned, std::string>& a, const std::pair<unsigned, std::string>& b) {
+				return a.first > b.first;
+			});
+	std::ostringstream comment;
+	comment << "# Profile of " << testName << ": " << taken << " samples of CPU time";
+	if (written)
+		comment << ", stacks in " << path;
+	else
+		comment << " (cannot write " << path << ")";
+	for (unsigned i = 0; i < hot.size() && i < numHotFrames; ++i)
+		comment << "\n#   " << std::fixed << std::setprecision(1) << std::setw(5)
+			<< 100.0 * hot[i].first / taken << "%  " << hot[i].second;
+	return comment.str();
+}
+
+#else
+
+struct StackSamples {};
+
+void installProfiler () {}
+
+std::shared_ptr<StackSamples> startProfiling () { return nullptr; }
+
+void stopProfiling (StackSamples&) {}
+
+std::string reportProfile (const std::string&, StackSamples&) { return ""; }
+
+#endif
+
+/**
+ * Samples the stack of a test, with --profile-slow, for as long as it
+ * runs. If the test takes more than the given fraction of its time
+ * limit, its profile is added to its result.
+ */
+class ProfileScope {
+public:
+	ProfileScope (UnitTest::TestContext& testContext, long timeLimit,
+			const UnitTest::TestTiming& testTiming, std::string& testExplanation)
+	: context(testContext), limit(timeLimit), timing(testTiming), explanation(testExplanation)
+	{
+		if (profileFraction >= 0.0 && limit > 0L) {
+			samples = startProfiling();
+			context.profileInto(samples);
+		}
+	}
+
+	~ProfileScope ()
+	{
+		if (samples == nullptr)
+			return;
+		stopProfiling(*samples);
+#if defined(__linux__)
+		samplingInto = nullptr;
+#endif
+		if (context.profile() != samples)
+			return; // reported as timed out
+		context.profileInto(nullptr);
+		if (timing.wallMS >= profileFraction * limit) {
+			std::string profile = reportProfile(context.name, *samples);
+			if (profile != "")
+				explanation += "\n" + profile;
+		}
+	}
+
+private:
+	UnitTest::TestContext& context;
+	long limit;
+	const UnitTest::TestTiming& timing;
+	std::string& explanation;
+	std::shared_ptr<StackSamples> samples;
+};
+
+// Puts the subtests of a data-driven test before its result.
+class SubtestsFirst {
+public:
+	SubtestsFirst (UnitTest::TestContext& testContext, std::string& testExplanation)
+	: context(testContext), explanation(testExplanation) {}
+
+	~SubtestsFirst ()
+	{
+		if (context.subtests != "")
+			explanation = context.subtests + explanation;
+	}
+
+private:
+	UnitTest::TestContext& context;
+	std::string& explanation;
+};
+
+}
+
+namespace {
+
+// The expectations that failed before a test was ended by an error.
+std::string alsoFailed (UnitTest::TestContext& context)
+{
+	std::string failures = context.expectationFailures();
+	return (failures != "") ? "\n" + failures : failures;
+}
+
+}
+
+int UnitTest::Runner::runTestGuarded (unsigned testNumber, std::string testName, TestFunction u,
+		std::string& testExplanation, TestTiming& timing,
+		std::shared_ptr<TestContext> context)
+{
+	if (context == nullptr)
+		context = std::make_shared<TestContext>(testName);
+	context->owner = std::this_thread::get_id();
+	const ContextScope contextScope(context);
+	const ActiveContextScope active(context);
+	std::string threadFailure;
+	const TestClock testClock;
+	TestSignalGuard signalGuard;
+	long timeLimit = 0L;
+	if (tests != nullptr) {
+		auto registered = tests->find(testName);
+		if (registered != tests->end())
+			timeLimit = registered->second.timeLimit;
+	}
+	const ProfileScope profiling (*context, timeLimit, timing, testExplanation);
+	const SubtestsFirst subtests (*context, testExplanation);
+	try {
+#ifndef __MINGW32__
+		// A worker process is simply replaced if a test crashes it.
+		if (workerResultFd < 0 && !signalsAlreadyGuarded)
+#endif
+		{
+			signalGuard.install();
+		}
+		if (setjmp(unitTestSignalEnv)) {
+			// Runtime error was caught
+			countingAllocations = nullptr; // skipped by the longjmp
+			timing = testClock.elapsed();
+			std::ostringstream out;
+			out << context->expectationFailures() << "# runtime error " << unitTestLastSignal;
+			if (!context->expectToFail.load()) {
+				testExplanation =  UnitTest::msgFailed(testNumber, testName, out.str(), timing);
+				return -1;
+			} else {
 				// OK (failed but was expected to fail)"
-				UnitTest::msgXFailed(testNumber, testName, out.str(), 0);
+				testExplanation = UnitTest::msgXFailed(testNumber, testName, out.str(), timing);
+			}
+		} else {
+			{
+				const AllocationScope counted (&context->allocations);
+				u();
+			}
+			timing = testClock.elapsed();
+			timing.details = context->details;
+			if (allocationCountingEnabled)
+				reportAllocations(*context, timing.details);
+			reportRegions(*context, timing.details);
+			std::string expectationFailures = context->expectationFailures();
+			if (context->failedElsewhere(threadFailure) || expectationFailures != "") {
+				threadFailure = expectationFailures + threadFailure;
+				if (!context->expectToFail.load()) {
+					testExplanation = UnitTest::msgFailed(testNumber, testName,
+							threadFailure, timing);
+					return 0;
+				} else {
+					testExplanation = UnitTest::msgXFailed(testNumber, testName,
+							threadFailure, timing);
+					return 1;
+				}
+			} else if (!context->expectToFail.load()) {
+				testExplanation = UnitTest::msgPassed(testNumber, testName, timing);
+			} else {
+				// Failed (passed but was expected to fail
+				testExplanation = UnitTest::msgXPassed(testNumber, testName, timing);
+				return 0;
+			}
+		}
+		return 1;
+	} catch (UnitTestFailure& ex) {
+		timing = testClock.elapsed();
+		std::string failures = context->expectationFailures() + ex.what();
+		if (!context->expectToFail.load()) {
+			testExplanation = UnitTest::msgFailed(testNumber, testName, failures, timing);
+			return 0;
+		} else {
+			// OK (failed but was expected to fail)"
+			testExplanation = UnitTest::msgXFailed(testNumber, testName, failures, timing);
+			return 1;
+		}
+	} catch (std::exception& e) {
+		timing = testClock.elapsed();
+		if (!context->expectToFail.load()) {
+			testExplanation = UnitTest::msgError(testNumber, testName,
+					"Unexpected error in " + testName + ": " +e.what()
+					+ alsoFailed(*context), timing);
+			return -1;
+		} else {
+			// OK (exception but was expected to fail)"
+			testExplanation = UnitTest::msgXFailed(testNumber, testName, "", timing);
+			return 1;
+		}
+	} catch (...) {
+		timing = testClock.elapsed();
+		if (!context->expectToFail.load()) {
+			testExplanation = UnitTest::msgError(testNumber, testName,
+					"Unexpected error in " + testName + alsoFailed(*context), timing);
+			return -1;
+		} else {
+			// OK (exception but was expected to fail)"
+			testExplanation = UnitTest::msgXFailed(testNumber, testName, "", timing);
+			return 1;
+		}
+	}
+}
+
+/**
+ * Reverses the expectation for the current test.  A test that fails or halts
+ * with an error will be reported and counted as OK.  If that test succeeds,
+ * it will be reported and counted as an error.
+ *
+ * Must be called before any assertions.
+ */
+void UnitTest::expectedToFail()
+{
+	currentContext()->expectToFail = true;
+#ifndef __MINGW32__
+	if (workerResultFd >= 0)
+		sendWorkerMessage(workerResultFd, BinaryReporter::TestExpectedToFail, 0, 0, "");
+#endif
+}
+
+namespace {
+
+// Guards the record of the tests' results.
+std::mutex resultsMutex;
+
+// The result of a test not run because --fail-fast stopped the run,
+// beside 1 (passed), 0 (failed) and -1 (error).
+const int testSkipped = TestReport::Skipped;
+
+}
+
+// Record the outcome of a test that ran to completion, or was skipped.
+void UnitTest::Runner::recordResult (unsigned testNumber, std::string testName, int testResult,
+		const std::string& testExplanation, const TestTiming& timing)
+{
+	std::lock_guard<std::mutex> l(resultsMutex);
+	if (timing.wallMS >= 0.0)
+		testTimings[testName] = timing;
+	addCounters(counterTotals, timing.counters);
+	try {
+		// Normal exit
+		if (testResult == 1) {
+			++numSuccesses;
+		} else if (testResult == 0) {
+			++numFailures;
+			failedTests.push_back(testName);
+		} else if (testResult == -1) {
+			++numErrors;
+			failedTests.push_back(testName);
+		} else if (testResult == testSkipped) {
+			++numSkipped;
+		}
+		TestReport report (testNumber, testName, (TestReport::Outcome)testResult,
+				testExplanation, timing);
+		for (const std::shared_ptr<Reporter>& reporter: reporters)
+			reporter->result(report);
+	} catch (std::runtime_error& e) {
+		++numErrors;
+		failedTests.push_back(testName);
+		UnitTest::msg(std::string("# Test ") + testName + " failed due to "
+				+ e.what() + "\n");
+	}
+	if (failFastLimit > 0L && numFailures + numErrors >= failFastLimit)
+		stopRequested = true;
+}
+
+#ifndef __MINGW32__
+
+/**
+ * A long-lived thread on which timed tests are run, one at a time,
+ * so that a new thread need not be created for each test.
+ *
+ * A test that exceeds its time limit cannot be safely stopped, so
+ * its executor is abandoned: anything the test eventually produces is
+ * discarded, and the thread is left with the process, which ends once
+ * the test has been reported. That is normally a worker process, which
+ * the runner replaces; in this one, the remaining tests are skipped.
+ */
+namespace {
+class TestExecutor {
+	struct State {
+		std::mutex m;
+		std::condition_variable changed;
+		std::function<void()> job;
+		bool jobFinished = false;
+		bool stopping = false;
+	};
+	std::shared_ptr<State> state;
+	std::thread worker;
+
+	static void workerLoop (std::shared_ptr<State> state)
+	{
+		std::unique_lock<std::mutex> l(state->m);
+		while (true) {
+			state->changed.wait(l,
+					[&state] { return state->stopping || state->job; });
+			if (state->job == nullptr)
+				return;
+			std::function<void()> job = std::move(state->job);
+			state->job = nullptr;
+			l.unlock();
+			job();
+			l.lock();
+			state->jobFinished = true;
+			state->changed.notify_all();
+		}
+	}
+
+public:
+	TestExecutor ()
+	: state(std::make_shared<State>()), worker(&TestExecutor::workerLoop, state)
+	{}
+
+	~TestExecutor ()
+	{
+		{
+			std::unique_lock<std::mutex> l(state->m);
+			state->stopping = true;
+			state->changed.notify_all();
+		}
+		if (worker.joinable())
+			worker.join();
+	}
+
+	/**
+	 * Run a job on the worker thread.
+	 *
+	 * @param job the job to run
+	 * @param limit maximum time to wait for the job to finish
+	 * @return true if the job finished within the time limit
+	 */
+	bool run (std::function<void()> job, std::chrono::milliseconds limit)
+	{
+		using namespace std::chrono;
+		std::unique_lock<std::mutex> l(state->m);
+		state->jobFinished = false;
+		state->job = std::move(job);
+		state->changed.notify_all();
+		steady_clock::time_point deadline = steady_clock::now() + limit;
+		while (true) {
+			// Wake now and then to pass on what the test has written.
+			steady_clock::time_point wake =
+					std::min(deadline, steady_clock::now() + milliseconds(250));
+			if (state->changed.wait_until(l, wake, [this] { return state->jobFinished; }))
+				return true;
+			if (steady_clock::now() >= deadline)
+				return false;
+			if (outputSink != nullptr)
+				outputSink->flushIfStale();
+		}
+	}
+
+	/**
+	 * Give up on a job that has not finished. The executor, still
+	 * running it, must then never be destroyed.
+	 */
+	void abandon ()
+	{
+		std::unique_lock<std::mutex> l(state->m);
+		state->stopping = true;
+	}
+};
+
+std::unique_ptr<TestExecutor> testExecutor;
+}
+
+
+// The outcome of a test that was still running at its time limit.
+int UnitTest::Runner::timedOut (unsigned testNumber, const std::string& testName,
+		long timeLimit, TestContext& context, std::string& testExplanation, TestTiming& timing)
+{
+	std::ostringstream out;
+	out << "# Test " << testNumber << " - " << testName << " still running after "
+			<< timeLimit
+			<< " milliseconds - possible infinite loop?";
+	std::shared_ptr<StackSamples> samples = context.profile();
+	if (samples != nullptr) {
+		context.profileInto(nullptr);
+		stopProfiling(*samples);
+		std::string profile = reportProfile(testName, *samples);
+		if (profile != "")
+			out << "\n" << profile;
+	}
+	timing = TestTiming(timeLimit);
+	if (!context.expectToFail.load())
+	{
+		testExplanation = UnitTest::msgFailed(testNumber, testName, out.str(), timing);
+		return 0;
+	}
+	else
+	{
+		testExplanation = UnitTest::msgXFailed(testNumber, testName, out.str(), timing);
+		return 1;
+	}
+}
+
+// Run a single unit test function, stopping it at its time limit.
+int UnitTest::Runner::runTestTimed (unsigned testNumber, std::string testName, TestFunction u,
+		long timeLimit, std::string& testExplanation, TestTiming& timing)
+{
+	if (timeLimit > 0L && !debuggerIsRunning())
+	{
+		// Filled in on the executor thread. Held by shared pointer so that
+		// a job that outlives this call does not write into a dead frame.
+		struct TimedTestResult {
+			int testResult = -99; // 1== passed, 0 == failed, -1 == error
+			std::string testExplanation;
+			TestTiming timing;
+		};
+		auto result = std::make_shared<TimedTestResult>();
+		auto context = std::make_shared<TestContext>(testName);
+
+		if (testExecutor == nullptr)
+			testExecutor.reset(new TestExecutor());
+		bool finished = testExecutor->run(
+				[result, context, testNumber, testName, u] () {
+					result->testResult = runTestGuarded (testNumber, testName, u,
+							result->testExplanation, result->timing, context);
+				},
+				std::chrono::milliseconds(timeLimit));
+
+		if (!finished) {
+			deactivateContext(context);
+			testExecutor->abandon();
+			testExecutor.release(); // left running the test
+			testsAbandoned = true;
+			if (workerResultFd < 0 && !stopRequested.load()) {
+				stopRequested = true;
+				reportDiagnostic ("# Test " + std::to_string(testNumber) + " - " + testName
+						+ " cannot be stopped, so the tests after it are skipped");
+			}
+
+			return timedOut(testNumber, testName, timeLimit, *context,
+					testExplanation, timing);
+		}
+		testExplanation = result->testExplanation;
+		timing = result->timing;
+		return result->testResult;
+	}
+	else
+	{
+		return runTestGuarded (testNumber, testName, u, testExplanation, timing);
+	}
+
+}
+
+#else
+
+// Run a single unit test function.
+// No time-out supported if compiler does not have thread support.
+int UnitTest::Runner::runTestTimed (unsigned testNumber, std::string testName, TestFunction u,
+		long timeLimit, std::string& testExplanation, TestTiming& timing)
+{
+	return runTestGuarded (testNumber, testName, u, testExplanation, timing);
+}
+
+#endif
+
+
+// Run a single unit test function.
+void UnitTest::Runner::runTest (unsigned testNumber, std::string testName, TestFunction u, long timeLimit)
+{
+	if (stopRequested) {
+		recordResult (testNumber, testName, testSkipped, msgSkipped(testNumber, testName),
+				TestTiming());
+		return;
+	}
+	if (outputSink != nullptr)
+		outputSink->flushIfStale();
+	std::string testExplanation;
+	TestTiming timing;
+	int testResult = runTestTimed (testNumber, testName, u, timeLimit, testExplanation, timing);
+	recordResult (testNumber, testName, testResult, testExplanation, timing);
+}
+
+
+namespace {
+
+// FNV-1a hash of a test name. Unlike std::hash, this is the same on
+// every platform and in every run, so each shard selects the same tests
+// no matter which machine it runs on.
+std::uint32_t stableHash (const std::string& s)
+{
+	std::uint32_t h = 2166136261u;
+	for (char c: s) {
+		h ^= (unsigned char)c;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+// Read a timing file of "testName milliseconds" lines, as left by a
+// previous run. Blank lines and lines starting with '#' are ignored.
+bool readShardTimings (const std::string& path, std::map<std::string, long>& timings)
+{
+	std::ifstream in (path);
+	if (in.is_open() == false)
+		return false;
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream fields (line);
+		std::string testName;
+		long milliseconds;
+		if (fields >> testName >> milliseconds && testName[0] != '#')
+			timings[testName] = milliseconds;
+	}
+	return true;
+}
+
+// The outcome of a test in an earlier run, as kept in the results cache.
+struct CachedResult {
+	bool passed = true;
+	long milliseconds = 0L;
+	std::string buildID;
+};
+
+#if defined(__linux__)
+// Find the GNU build ID note of the program (the first object listed).
+int findBuildID (dl_phdr_info* info, size_t, void* data)
+{
+	std::string& id = *static_cast<std::string*>(data);
+	for (int i = 0; i < info->dlpi_phnum; ++i) {
+		const ElfW(Phdr)& segment = info->dlpi_phdr[i];
+		if (segment.p_type != PT_NOTE)
+			continue;
+		const char* p = (const char*)(info->dlpi_addr + segment.p_vaddr);
+		const char* end = p + segment.p_memsz;
+		while (p + sizeof(ElfW(Nhdr)) <= end) {
+			const ElfW(Nhdr)* note = (const ElfW(Nhdr)*)p;
+			const char* desc = p + sizeof(ElfW(Nhdr)) + ((note->n_namesz + 3) & ~3u);
+			if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4
+					&& std::memcmp(p + sizeof(ElfW(Nhdr)), "GNU", 4) == 0) {
+				static const char hex[] = "0123456789abcdef";
+				for (unsigned k = 0; k < note->n_descsz; ++k) {
+					id += hex[(unsigned char)desc[k] >> 4];
+					id += hex[(unsigned char)desc[k] & 15];
+				}
+				return 1;
+			}
+			p = desc + ((note->n_descsz + 3) & ~3u);
+		}
+	}
+	return 1; // Only the program itself is of interest.
+}
+#endif
+
+// Identifies this build of the test program: the build ID the linker
+// recorded, where there is one, else the size and time of the program.
+std::string buildID (const char* program)
+{
+	std::string id;
+#if defined(__linux__)
+	dl_iterate_phdr(findBuildID, &id);
+	if (id != "")
+		return id;
+	program = "/proc/self/exe";
+#endif
+#ifndef __MINGW32__
+	struct stat info;
+	if (program != nullptr && ::stat(program, &info) == 0)
+		return std::to_string((long long)info.st_size) + "-"
+			+ std::to_string((long long)info.st_mtime);
+#endif
+	return "unknown";
+}
+
+// Read a results cache of "testName passed|failed milliseconds buildID"
+// lines, as left by the previous run. A missing file has no results.
+void readResultsCache (const std::string& path,
+		std::map<std::string, CachedResult>& results)
+{
+	std::ifstream in (path);
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream fields (line);
+		std::string testName, outcome;
+		CachedResult result;
+		if (fields >> testName >> outcome >> result.milliseconds >> result.buildID
+				&& testName[0] != '#') {
+			result.passed = (outcome == "passed");
+			results[testName] = result;
+		}
+	}
+}
+
+bool writeResultsCache (const std::string& path,
+		const std::map<std::string, CachedResult>& results)
+{
+	std::ofstream out (path);
+	out << "# test result milliseconds build\n";
+	for (const auto& entry: results)
+		out << entry.first << ' ' << ((entry.second.passed) ? "passed" : "failed")
+			<< ' ' << entry.second.milliseconds << ' ' << entry.second.buildID << '\n';
+	return out.good();
+}
+
+// Read a baselines file of "testName key machine iterations repetitions
+// min median p99 mean stddev" lines. A missing file has no baselines.
+void readBaselines (const std::string& path,
+		std::map<std::string, BenchmarkStatistics>& baselines)
+{
+	std::ifstream in (path);
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream fields (line);
+		std::string testName, key, machine;
+		BenchmarkStatistics stats;
+		if (fields >> testName >> key >> machine >> stats.iterations >> stats.repetitions
+				>> stats.minNS >> stats.medianNS >> stats.p99NS >> stats.meanNS
+				>> stats.stddevNS
+				&& testName[0] != '#')
+			baselines[testName + ' ' + key + ' ' + machine] = stats;
+	}
+}
+
+bool writeBaselines (const std::string& path,
+		const std::map<std::string, BenchmarkStatistics>& baselines)
+{
+	std::ofstream out (path);
+	out << "# test key machine iterations repetitions min_ns median_ns p99_ns"
+			" mean_ns stddev_ns\n";
+	out << std::fixed << std::setprecision(3);
+	for (const auto& entry: baselines)
+	{
+		const BenchmarkStatistics& stats = entry.second;
+		out << entry.first << ' ' << stats.iterations << ' ' << stats.repetitions
+			<< ' ' << stats.minNS << ' ' << stats.medianNS << ' ' << stats.p99NS
+			<< ' ' << stats.meanNS << ' ' << stats.stddevNS << '\n';
+	}
+	return out.good();
+}
+
+// Select the tests that belong to shard shardIndex of shardCount.
+//
+// Without timings, a test's shard is determined by the hash of its name.
+// With timings, the tests are packed longest-first, each into the shard
+// with the least estimated work so far. Tests missing from the timing
+// file are assumed to take the average time of those present.
+std::set<std::string> selectShard (const std::set<std::string>& testNames,
+		unsigned shardIndex, unsigned shardCount,
+		const std::map<std::string, long>* timings)
+{
+	std::set<std::string> selected;
+	if (timings == nullptr) {
+		for (const std::string& testName: testNames)
+			if (stableHash(testName) % shardCount == shardIndex)
+				selected.insert(testName);
+	} else {
+		long long total = 0;
+		long known = 0;
+		for (const std::string& testName: testNames) {
+			auto pos = timings->find(testName);
+			if (pos != timings->end()) {
+				total += pos->second;
+				++known;
+			}
+		}
+		long defaultTime = (known > 0) ? std::max(1LL, total / known) : 1L;
+
+		std::vector<std::pair<long, std::string>> jobs;
+		for (const std::string& testName: testNames) {
+			auto pos = timings->find(testName);
+			jobs.emplace_back((pos != timings->end()) ? pos->second : defaultTime, testName);
+		}
+		std::stable_sort(jobs.begin(), jobs.end(),
+				[] (const std::pair<long, std::string>& a, const std::pair<long, std::string>& b) {
+					return a.first > b.first;
+				});
+
+		std::vector<long long> loads (shardCount, 0);
+		for (const auto& job: jobs) {
+			unsigned lightest = std::min_element(loads.begin(), loads.end()) - loads.begin();
+			loads[lightest] += job.first;
+			if (lightest == shardIndex)
+				selected.insert(job.second);
+		}
+	}
+	return selected;
+}
+
+}
+
+
+namespace {
+
+// Does text match a glob pattern of literal characters, '*' (any
+// sequence), '?' (any one character) and [...] character sets?
+bool globMatch (const char* pattern, const char* text)
+{
+	const char* resumePattern = nullptr;
+	const char* resumeText = nullptr;
+	while (*text != '\0') {
+		if (*pattern == '*') {
+			resumePattern = ++pattern;
+			resumeText = text;
+			continue;
+		}
+		bool matched = false;
+		const char* next = pattern + 1;
+		if (*pattern == '?') {
+			matched = true;
+		} else if (*pattern == '[') {
+			const char* p = pattern + 1;
+			bool negate = (*p == '!' || *p == '^');
+			if (negate)
+				++p;
+			bool inSet = false;
+			do {
+				if (p[1] == '-' && p[2] != ']' && p[2] != '\0') {
+					inSet = inSet || (*text >= p[0] && *text <= p[2]);
+					p += 3;
+				} else {
+					inSet = inSet || (*text == *p);
+					++p;
+				}
+			} while (*p != ']' && *p != '\0');
+			matched = (*p == ']') && (inSet != negate);
+			next = p + 1;
+		} else {
+			matched = (*pattern == *text);
+		}
+		if (matched && *pattern != '\0') {
+			pattern = next;
+			++text;
+		} else if (resumePattern != nullptr) {
+			// Let the last '*' absorb one more character.
+			pattern = resumePattern;
+			text = ++resumeText;
+		} else {
+			return false;
+		}
+	}
+	while (*pattern == '*')
+		++pattern;
+	return *pattern == '\0';
+}
+
+// The longest run of literal characters in a glob pattern.
+std::string longestLiteral (const std::string& pattern)
+{
+	std::string longest, current;
+	bool inSet = false;
+	for (char c: pattern) {
+		if (inSet) {
+			inSet = (c != ']');
+		} else if (c == '*' || c == '?' || c == '[') {
+			if (current.size() > longest.size())
+				longest = current;
+			current.clear();
+			inSet = (c == '[');
+		} else {
+			current += c;
+		}
+	}
+	return (current.size() > longest.size()) ? current : longest;
+}
+
+
+/**
+ * Lookup tables over the names of the registered tests, so that
+ * selecting tests costs time in proportion to the tests that match
+ * rather than to the number registered.
+ *
+ * Substrings of three or more characters are found through a trigram
+ * index: only the tests that contain the rarest trigram of the substring
+ * need be checked. Shorter substrings are found by a single search of
+ * all of the names, joined together.
+ */
+class TestIndex {
+	std::vector<std::string> names;
+	std::unordered_map<std::string, std::vector<unsigned>> byAbbreviation;
+	std::unordered_map<std::uint32_t, std::vector<unsigned>> byTrigram;
+	std::string allNames;             // names, each followed by '\n'
+	std::vector<std::size_t> offsets; // where each name starts in allNames
+
+	static std::uint32_t trigram (const char* s)
+	{
+		return ((std::uint32_t)(unsigned char)s[0] << 16)
+				| ((std::uint32_t)(unsigned char)s[1] << 8)
+				| (std::uint32_t)(unsigned char)s[2];
+	}
+
+public:
+	/**
+	 * @param testNames names of all tests, in sorted order
+	 * @param abbreviations abbreviations of those names
+	 */
+	TestIndex (std::vector<std::string> testNames,
+			const std::vector<std::string>& abbreviations)
+		: names(std::move(testNames))
+	{
+		for (unsigned i = 0; i < names.size(); ++i) {
+			const std::string& name = names[i];
+			byAbbreviation[abbreviations[i]].push_back(i);
+			offsets.push_back(allNames.size());
+			allNames += name;
+			allNames += '\n';
+			for (std::size_t k = 0; k + 3 <= name.size(); ++k) {
+				std::vector<unsigned>& postings = byTrigram[trigram(name.data() + k)];
+				if (postings.empty() || postings.back() != i)
+					postings.push_back(i);
+			}
+		}
+	}
+
+	unsigned size() const { return names.size(); }
+
+	const std::string& name (unsigned i) const { return names[i]; }
+
+	/**
+	 * Indices, in increasing order, of all tests whose names contain
+	 * fragment.
+	 */
+	std::vector<unsigned> containing (const std::string& fragment) const
+	{
+		std::vector<unsigned> found;
+		if (fragment.find('\n') != std::string::npos)
+			return found;
+		if (fragment.size() < 3) {
+			std::size_t pos = allNames.find(fragment);
+			while (pos != std::string::npos) {
+				unsigned i = std::upper_bound(offsets.begin(), offsets.end(), pos)
+						- offsets.begin() - 1;
+				found.push_back(i);
+				// Resume at the start of the next name.
+				pos = (i + 1 < offsets.size())
+						? allNames.find(fragment, offsets[i+1]) : std::string::npos;
+			}
+			return found;
+		}
+		const std::vector<unsigned>* rarest = nullptr;
+		for (std::size_t k = 0; k + 3 <= fragment.size(); ++k) {
+			auto pos = byTrigram.find(trigram(fragment.data() + k));
+			if (pos == byTrigram.end())
+				return found;
+			if (rarest == nullptr || pos->second.size() < rarest->size())
+				rarest = &pos->second;
+		}
+		for (unsigned i: *rarest)
+			if (names[i].find(fragment) != std::string::npos)
+				found.push_back(i);
+		return found;
+	}
+
+	/**
+	 * Indices of all tests whose camelCase abbreviation is abbreviation.
+	 */
+	std::vector<unsigned> abbreviatedAs (const std::string& abbreviation) const
+	{
+		auto pos = byAbbreviation.find(abbreviation);
+		return (pos != byAbbreviation.end()) ? pos->second : std::vector<unsigned>();
+	}
+
+	/**
+	 * Indices of all tests whose names match a --filter pattern: a glob,
+	 * or a regular expression written as /regex/.
+	 *
+	 * @throws std::regex_error if the regular expression is malformed
+	 */
+	std::vector<unsigned> matching (const std::string& pattern) const
+	{
+		std::vector<unsigned> found;
+		if (pattern.size() >= 2 && pattern.front() == '/' && pattern.back() == '/') {
+			std::regex re (pattern.substr(1, pattern.size()-2));
+			for (unsigned i = 0; i < names.size(); ++i)
+				if (std::regex_search(names[i], re))
+					found.push_back(i);
+			return found;
+		}
+		// Only names containing the pattern's literal text can match it.
+		std::string literal = longestLiteral(pattern);
+		if (literal.size() >= 3) {
+			for (unsigned i: containing(literal))
+				if (globMatch(pattern.c_str(), names[i].c_str()))
+					found.push_back(i);
+		} else {
+			for (unsigned i = 0; i < names.size(); ++i)
+				if (globMatch(pattern.c_str(), names[i].c_str()))
+					found.push_back(i);
+		}
+		return found;
+	}
+};
+
+}
+
+namespace {
+
+// The name of the test suite, for reports: the program's file name.
+std::string suiteName (const char* program)
+{
+	std::string name = (program != nullptr) ? program : "unittest";
+	std::string::size_type slash = name.find_last_of("/\\");
+	return (slash != std::string::npos) ? name.substr(slash + 1) : name;
+}
+
+// Lists the tests that one shard of the program would run, by running
+// it with args plus --list and --shard-index=shard. Returns false if the
+// program could not be run or did not end normally.
+bool listShard (const char* program, const std::vector<std::string>& args,
+		unsigned shard, std::vector<std::string>& testNames)
+{
+#ifndef __MINGW32__
+	if (program == nullptr)
+		return false;
+	std::vector<std::string> childArgs {program};
+	childArgs.insert(childArgs.end(), args.begin(), args.end());
+	childArgs.push_back("--list");
+	childArgs.push_back("--shard-index=" + std::to_string(shard));
+	std::vector<char*> argv;
+	for (std::string& arg: childArgs)
+		argv.push_back(&arg[0]);
+	argv.push_back(nullptr);
+
+	int fds[2];
+	if (::pipe(fds) != 0)
+		return false;
+	std::cout.flush();
+	pid_t pid = ::fork();
+	if (pid < 0) {
+		::close(fds[0]);
+		::close(fds[1]);
+		return false;
+	}
+	if (pid == 0) {
+		::close(fds[0]);
+		::dup2(fds[1], 1);
+		::close(fds[1]);
+		::execvp(argv[0], argv.data());
+		::_exit(127);
+	}
+	::close(fds[1]);
+	std::string listing;
+	char buffer[4096];
+	for (;;) {
+		ssize_t n = ::read(fds[0], buffer, sizeof(buffer));
+		if (n > 0)
+			listing.append(buffer, n);
+		else if (n == 0 || errno != EINTR)
+			break;
+	}
+	::close(fds[0]);
+	int status = 0;
+	while (::waitpid(pid, &status, 0) < 0)
+		if (errno != EINTR)
+			return false;
+
+	std::istringstream lines (listing);
+	std::string line;
+	while (std::getline(lines, line))
+		if (line != "" && line[0] != '#')
+			testNames.push_back(line);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#else
+	return false;
+#endif
+}
+
+}
+
+
+// Run all units tests whose name contains testNames[i],
+// 0 <= i <= nTests
+//
+// Special case: If nTests == 0, runs all unit Tests.
+void UnitTest::Runner::runTests (int nTests, char** testNames, char* program)
+{
+	std::set<std::string> testsToRun;
+	std::vector<std::string> testSpecs;
+	std::string badTestSpecifications = "";
+	unsigned numJobs = 1;
+	unsigned numThreads = 0;
+	bool isolate = false;
+	unsigned shardIndex = 0;
+	unsigned shardCount = 0;
+	std::string shardTimingsPath;
+	bool verifyShards = false;
+	std::string saveTimingsPath;
+	int outputFD = -1;
+	std::vector<std::string> filters;
+	bool allBenchmarks = false;
+	std::string benchmarkOutputPath;
+	// Each program keeps its own results, beside it.
+	std::string resultsCachePath = (program != nullptr)
+			? std::string(program) + ".unittest-results" : "";
+	bool failedFirst = false;
+	bool onlyFailed = false;
+	std::vector<std::string> reporterSpecs;
+
+	// Separate options from test specifications
+	for (int i = 0; i < nTests; ++i)
+	{
+		std::string arg = testNames[i];
+		std::string jobsValue;
+		if (arg == "-j" && i+1 < nTests)
+			jobsValue = testNames[++i];
+		else if (arg.compare(0, 2, "-j") == 0 && arg.size() > 2)
+			jobsValue = arg.substr(2);
+		else if (arg.compare(0, 7, "--jobs=") == 0)
+			jobsValue = arg.substr(7);
+		else if (arg == "--isolate")
+		{
+			isolate = true;
+			continue;
+		}
+		else if (arg.compare(0, 10, "--threads=") == 0)
+		{
+			numThreads = std::atoi(arg.c_str() + 10);
+			continue;
+		}
+		else if (arg.compare(0, 14, "--shard-index=") == 0)
+		{
+			shardIndex = std::atoi(arg.c_str() + 14);
+			continue;
+		}
+		else if (arg.compare(0, 14, "--shard-count=") == 0)
+		{
+			shardCount = std::atoi(arg.c_str() + 14);
+			continue;
+		}
+		else if (arg.compare(0, 16, "--shard-timings=") == 0)
+		{
+			shardTimingsPath = arg.substr(16);
+			continue;
+		}
+		else if (arg == "--verify-shards")
+		{
+			verifyShards = true;
+			continue;
+		}
+		else if (arg.compare(0, 11, "--reporter=") == 0)
+		{
+			reporterSpecs.push_back(arg.substr(11));
+			continue;
+		}
+		else if (arg.compare(0, 16, "--results-cache=") == 0)
+		{
+			resultsCachePath = arg.substr(16);
+			continue;
+		}
+		else if (arg == "--failed-first")
+		{
+			failedFirst = true;
+			continue;
+		}
+		else if (arg == "--only-failed")
+		{
+			onlyFailed = true;
+			continue;
+		}
+		else if (arg == "--fail-fast")
+		{
+			failFastLimit = 1L;
+			continue;
+		}
+		else if (arg.compare(0, 12, "--fail-fast=") == 0)
+		{
+			failFastLimit = std::max(1, std::atoi(arg.c_str() + 12));
+			continue;
+		}
+		else if (arg.compare(0, 15, "--save-timings=") == 0)
+		{
+			saveTimingsPath = arg.substr(15);
+			continue;
+		}
+		else if (arg.compare(0, 10, "--slowest=") == 0)
+		{
+			numSlowestReported = std::atoi(arg.c_str() + 10);
+			continue;
+		}
+		else if (arg.compare(0, 9, "--output=") == 0)
+		{
+			std::string path = arg.substr(9);
+			outputFD = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (outputFD < 0)
+				badTestSpecifications += "# Warning: Cannot write to " + path + "\n";
+			continue;
+		}
+		else if (arg.compare(0, 12, "--output-fd=") == 0)
+		{
+			outputFD = std::atoi(arg.c_str() + 12);
+			continue;
+		}
+		else if (arg.compare(0, 9, "--filter=") == 0 && arg.size() > 9)
+		{
+			filters.push_back(arg.substr(9));
+			continue;
+		}
+		else if (arg == "--list")
+		{
+			listOnly = true;
+			continue;
+		}
+		else if (arg == "--benchmarks")
+		{
+			allBenchmarks = true;
+			continue;
+		}
+		else if (arg.compare(0, 24, "--benchmark-repetitions=") == 0)
+		{
+			benchmarkRepetitions = std::max(1, std::atoi(arg.c_str() + 24));
+			continue;
+		}
+		else if (arg.compare(0, 19, "--benchmark-min-ms=") == 0)
+		{
+			benchmarkMinMS = std::atof(arg.c_str() + 19);
+			continue;
+		}
+		else if (arg.compare(0, 19, "--benchmark-output=") == 0)
+		{
+			benchmarkOutputPath = arg.substr(19);
+			continue;
+		}
+		else if (arg.compare(0, 12, "--baselines=") == 0)
+		{
+			baselinesPath = arg.substr(12);
+			continue;
+		}
+		else if (arg.compare(0, 14, "--machine-tag=") == 0)
+		{
+			machineTag = arg.substr(14);
+			continue;
+		}
+		else if (arg == "--update-baselines")
+		{
+			updateBaselines = true;
+			continue;
+		}
+		else if (arg == "--fail-on-leaks")
+		{
+			failOnLeaks = true;
+			continue;
+		}
+		else if (arg.compare(0, 7, "--rows=") == 0)
+		{
+			std::string range = arg.substr(7);
+			std::string::size_type dash = range.find('-');
+			std::string first = range.substr(0, dash);
+			std::string last = (dash != std::string::npos) ? range.substr(dash + 1) : first;
+			if (first != "")
+				dataFirstRow = std::max(1ul, std::strtoul(first.c_str(), nullptr, 10));
+			if (last != "")
+				dataLastRow = std::strtoul(last.c_str(), nullptr, 10);
+			continue;
+		}
+		else if (arg.compare(0, 17, "--property-cases=") == 0)
+		{
+			propertyCases = std::strtoul(arg.c_str() + 17, nullptr, 10);
+			continue;
+		}
+		else if (arg.compare(0, 7, "--seed=") == 0)
+		{
+			propertySeed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+			propertySeedGiven = true;
+			continue;
+		}
+		else if (arg.compare(0, 13, "--data-parts=") == 0)
+		{
+			dataParts = std::max(1, std::atoi(arg.c_str() + 13));
+			continue;
+		}
+		else if (arg.compare(0, 26, "--max-failed-expectations=") == 0)
+		{
+			maxFailedExpectations = std::max(1, std::atoi(arg.c_str() + 26));
+			continue;
+		}
+		else if (arg == "--counters")
+		{
+			countHardwareEvents = true;
+			continue;
+		}
+		else if (arg == "--profile-slow")
+		{
+			profileFraction = 0.5;
+			continue;
+		}
+		else if (arg.compare(0, 15, "--profile-slow=") == 0)
+		{
+			profileFraction = std::atof(arg.c_str() + 15);
+			continue;
+		}
+		else if (arg.compare(0, 14, "--profile-dir=") == 0)
+		{
+			profileDirectory = arg.substr(14);
+			continue;
+		}
+		else if (arg.size() > 1 && arg[0] == '-')
+		{
+			badTestSpecifications += "# Warning: Unknown option " + arg + "\n";
+			continue;
+		}
+		else
+		{
+			testSpecs.push_back(arg);
+			continue;
+		}
+		int j = std::atoi(jobsValue.c_str());
+		numJobs = (j > 0) ? j : std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	if (profileFraction >= 0.0)
+		installProfiler();
+	if (!propertySeedGiven)
+	{
+		// Chosen once, before any workers are forked, so all use it.
+		propertySeed = std::chrono::system_clock::now().time_since_epoch().count()
+				% 1000000000ULL; // short enough to type into --seed
+	}
+
+	indexTests();
+	if (dataParts > 1)
+	{
+		// Each part of a data-driven test is run as a test of its own.
+		std::vector<std::string> dataTests;
+		for (const auto& utest: *tests)
+			if (utest.second.data)
+				dataTests.push_back(utest.first);
+		for (const std::string& testName: dataTests) {
+			BoundedTest test = (*tests)[testName];
+			tests->erase(testName);
+			for (unsigned k = 1; k <= dataParts; ++k)
+				(*tests)[testName + "[" + std::to_string(k) + "of"
+					+ std::to_string(dataParts) + "]"] = test;
+		}
+	}
+	std::vector<std::string> names;
+	std::vector<std::string> abbreviations;
+	std::vector<char> isBenchmark;
+	names.reserve(tests->size());
+	abbreviations.reserve(tests->size());
+	for (const auto& utest: *tests) {
+		names.push_back(utest.first);
+		abbreviations.push_back(utest.second.abbreviation);
+		isBenchmark.push_back(utest.second.benchmark);
+	}
+	const TestIndex index (std::move(names), abbreviations);
+
+	std::vector<char> selected (index.size(), 0);
+	bool anySelected = false;
+	if (allBenchmarks)
+	{
+		selected = isBenchmark;
+		anySelected = true;
+	}
+	for (const std::string& testID: testSpecs)
+	{
+		std::vector<unsigned> found = index.containing(testID);
+		if (found.empty())
+			found = index.abbreviatedAs(testID);
+		if (found.empty())
+		{
+			badTestSpecifications += "# Warning: No matching test found for input specification "
+					+ testID + "\n";
+		}
+		for (unsigned i: found)
+			selected[i] = 1;
+		anySelected = anySelected || !found.empty();
+	}
+	std::vector<unsigned> excluded;
+	for (const std::string& filter: filters)
+	{
+		bool negative = (filter[0] == '-');
+		std::string pattern = (negative) ? filter.substr(1) : filter;
+		std::vector<unsigned> found;
+		try {
+			found = index.matching(pattern);
+		} catch (std::regex_error& e) {
+			badTestSpecifications += "# Warning: Bad regular expression in --filter="
+					+ filter + ": " + e.what() + "\n";
+			continue;
+		}
+		if (negative)
+		{
+			excluded.insert(excluded.end(), found.begin(), found.end());
+			continue;
+		}
+		if (found.empty())
+		{
+			badTestSpecifications += "# Warning: No matching test found for --filter="
+					+ filter + "\n";
+		}
+		for (unsigned i: found)
+			selected[i] = 1;
+		anySelected = anySelected || !found.empty();
+	}
+	if (!anySelected)
+	{
+		// Benchmarks take too long to run unless asked for.
+		for (unsigned i = 0; i < index.size(); ++i)
+			selected[i] = !isBenchmark[i];
+	}
+	for (unsigned i: excluded)
+		selected[i] = 0;
+	for (unsigned i = 0; i < index.size(); ++i)
+		if (selected[i])
+			testsToRun.insert(testsToRun.end(), index.name(i));
+
+	std::map<std::string, CachedResult> cachedResults;
+	std::string thisBuild;
+	if (resultsCachePath != "")
+	{
+		readResultsCache(resultsCachePath, cachedResults);
+		thisBuild = buildID(program);
+		for (const auto& entry: cachedResults)
+			if (entry.second.buildID != thisBuild)
+			{
+				badTestSpecifications += "# Results cached in " + resultsCachePath
+						+ " include some from another build\n";
+				break;
+			}
+	}
+	auto previouslyFailed = [&cachedResults] (const std::string& testName) {
+		auto pos = cachedResults.find(testName);
+		return pos != cachedResults.end() && !pos->second.passed;
+	};
+	if (onlyFailed)
+	{
+		// Tests never run before are kept, having not yet passed.
+		for (auto pos = testsToRun.begin(); pos != testsToRun.end(); )
+			if (cachedResults.count(*pos) > 0 && !previouslyFailed(*pos))
+				pos = testsToRun.erase(pos);
+			else
+				++pos;
+	}
+
+	std::map<std::string, long> timings;
+	bool useTimings = false;
+	if (shardTimingsPath != "")
+	{
+		useTimings = readShardTimings(shardTimingsPath, timings);
+		if (!useTimings)
+			badTestSpecifications += "# Warning: Cannot read test timings from "
+				+ shardTimingsPath + "\n";
+	}
+	const std::map<std::string, long>* shardTimings = (useTimings) ? &timings : nullptr;
+	std::map<std::string, long> cachedTimings;
+	for (const auto& entry: cachedResults)
+		cachedTimings[entry.first] = entry.second.milliseconds;
+
+	// Each shard selects its own tests, so that --list shows them.
+	if (shardCount > 0 && shardIndex < shardCount && !verifyShards)
+		testsToRun = selectShard(testsToRun, shardIndex, shardCount, shardTimings);
+
+	if (listOnly)
+	{
+		// Just names, for IDEs and scripts.
+		for (const std::string& testName: testsToRun)
+			std::cout << testName << '\n';
+		std::cerr << badTestSpecifications;
+		std::cout.flush();
+		return;
+	}
+
+	installOutputSink();
+	if (outputFD >= 0)
+		outputSink->redirect(outputFD);
+	runStarted = std::chrono::steady_clock::now();
+	for (const std::string& spec: reporterSpecs)
+	{
+		std::string::size_type colon = spec.find(':');
+		std::string format = spec.substr(0, colon);
+		std::string path = (colon != std::string::npos) ? spec.substr(colon + 1) : "";
+		if (format == "tap" && path == "")
+			addReporter(std::make_shared<TapReporter>());
+		else if (format == "tap")
+			addReporter(std::make_shared<TapReporter>(path));
+		else if (format == "junit" && path != "")
+			addReporter(std::make_shared<JUnitReporter>(path, suiteName(program)));
+		else if (format == "binary" && path != "")
+			addReporter(std::make_shared<BinaryReporter>(path));
+		else
+			badTestSpecifications += "# Warning: Unknown reporter --reporter=" + spec + "\n";
+	}
+	if (reporters.empty())
+		addReporter(std::make_shared<TapReporter>());
+
+	if (shardCount > 0)
+	{
+		if (shardIndex >= shardCount)
+		{
+			startReporters (0);
+			reportDiagnostic ("Bail out! --shard-index=" + std::to_string(shardIndex)
+					+ " must be less than --shard-count=" + std::to_string(shardCount));
+			return;
+		}
+
+		if (verifyShards)
+		{
+			// Run each shard's own selection, via --list, and check that
+			// every test lands in exactly one of them.
+			std::vector<std::string> args;
+			for (int i = 0; i < nTests; ++i)
+			{
+				std::string arg = testNames[i];
+				if (arg != "--verify-shards" && arg.compare(0, 14, "--shard-index=") != 0)
+					args.push_back(arg);
+			}
+			std::map<std::string, unsigned> coverage;
+			for (const std::string& testName: testsToRun)
+				coverage[testName] = 0;
+			std::ostringstream out;
+			std::string problems;
+			for (unsigned shard = 0; shard < shardCount; ++shard)
+			{
+				std::vector<std::string> selected;
+				if (!listShard(program, args, shard, selected))
+					problems += "shard " + std::to_string(shard) + " could not be listed\n";
+				for (const std::string& testName: selected)
+					++coverage[testName];
+				out << "# shard " << shard << ": " << selected.size() << " tests";
+				if (useTimings)
+				{
+					long recordedMS = 0L;
+					for (const std::string& testName: selected)
+					{
+						auto pos = timings.find(testName);
+						recordedMS += (pos != timings.end()) ? pos->second : 0L;
+					}
+					out << ", " << recordedMS << " recorded milliseconds";
+				}
+				out << "\n";
+			}
+			for (const auto& entry: coverage)
+				if (testsToRun.count(entry.first) == 0)
+					problems += entry.first + " is not selected without sharding\n";
+				else if (entry.second != 1)
+					problems += entry.first + " is in " + std::to_string(entry.second)
+						+ " shards\n";
+			std::string testName = "shards cover all " + std::to_string(testsToRun.size())
+					+ " tests exactly once";
+			startReporters (1);
+			reportDiagnostic (badTestSpecifications + out.str());
+			if (problems == "")
+				recordResult (1, testName, 1, msgPassed(1, testName, TestTiming()), TestTiming());
+			else
+				recordResult (1, testName, 0, msgFailed(1, testName, problems, TestTiming()),
+						TestTiming());
+			return;
+		}
+	}
+
+	startReporters (testsToRun.size());
+	reportDiagnostic (badTestSpecifications);
+	debuggerIsRunning(); // Probe once, before any test is timed.
+
+	readBaselines(baselinesPath, baselines);
+	if (updateBaselines)
+	{
+		// Record the times undisturbed by other tests.
+		numJobs = 1;
+		numThreads = 1;
+		isolate = false;
+	}
+
+	// The benchmarks run last, one at a time in this process, so that
+	// no other test disturbs their timing.
+	std::vector<std::string> testOrder;
+	std::vector<std::string> benchmarkOrder;
+	for (const std::string& testName: testsToRun)
+		if ((*tests)[testName].benchmark)
+			benchmarkOrder.push_back(testName);
+		else
+			testOrder.push_back(testName);
+
+	unsigned numFirst = 0;
+	if (failedFirst)
+		numFirst = std::stable_partition(testOrder.begin(), testOrder.end(),
+				previouslyFailed) - testOrder.begin();
+
+	prepareFixtures(testOrder);
+	prepareFixtures(benchmarkOrder);
+
+	if ((numJobs > 1 || isolate) && !debuggerIsRunning())
+	{
+		runTestsInWorkers (testOrder, numJobs,
+				(shardTimings != nullptr) ? shardTimings : &cachedTimings, numFirst);
+	}
+	else
+	{
+		if (numThreads == 0)
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+		runTestsInThreads (testOrder, debuggerIsRunning() ? 1 : numThreads);
+	}
+	for (unsigned i = 0; i < benchmarkOrder.size(); ++i) {
+		BoundedTest test = (*tests)[benchmarkOrder[i]];
+		runTest (testOrder.size() + i + 1, benchmarkOrder[i], test.unitTest, test.timeLimit);
+	}
+#ifndef __MINGW32__
+	testExecutor.reset();
+#endif
+	destroyFixtures();
+	std::cout.flush();
+
+	if (saveTimingsPath != "")
+	{
+		std::ofstream out (saveTimingsPath);
+		for (const auto& entry: testTimings)
+			out << entry.first << ' ' << (long)(entry.second.wallMS + 0.5) << '\n';
+		if (!out.good())
+			reportDiagnostic ("# Warning: Cannot write test timings to " + saveTimingsPath);
+	}
+
+	if (benchmarkOutputPath != "")
+	{
+		std::ofstream out (benchmarkOutputPath);
+		out << "# name iterations repetitions min_ns median_ns p99_ns mean_ns stddev_ns"
+				" bytes_per_second items_per_second\n";
+		out << std::fixed << std::setprecision(3);
+		for (const auto& entry: benchmarkResults)
+		{
+			const BenchmarkStatistics& stats = entry.second;
+			out << entry.first << ' ' << stats.iterations << ' ' << stats.repetitions
+				<< ' ' << stats.minNS << ' ' << stats.medianNS << ' ' << stats.p99NS
+				<< ' ' << stats.meanNS << ' ' << stats.stddevNS
+				<< ' ' << stats.bytesPerSecond << ' ' << stats.itemsPerSecond << '\n';
+		}
+		if (!out.good())
+			reportDiagnostic ("# Warning: Cannot write benchmark statistics to "
+					+ benchmarkOutputPath);
+	}
+
+	if (updateBaselines && !writeBaselines(baselinesPath, baselines))
+		reportDiagnostic ("# Warning: Cannot write baselines to " + baselinesPath);
+
+	if (resultsCachePath != "")
+	{
+		// Skipped tests keep the results of their last run.
+		for (const auto& entry: testTimings)
+		{
+			CachedResult& result = cachedResults[entry.first];
+			result.passed = true;
+			result.milliseconds = (long)(entry.second.wallMS + 0.5);
+			result.buildID = thisBuild;
+		}
+		for (const std::string& testName: failedTests)
+		{
+			CachedResult& result = cachedResults[testName];
+			result.passed = false;
+			result.buildID = thisBuild;
+		}
+		if (!writeResultsCache(resultsCachePath, cachedResults))
+			reportDiagnostic ("# Warning: Cannot write test results to " + resultsCachePath);
+	}
+}
+
+
+#ifndef __MINGW32__
+
+namespace {
+
+// Everything written to fd since offset 0.
+std::string readCaptured (int fd)
+{
+	std::string result;
+	char buffer[4096];
+	off_t offset = 0;
+	ssize_t n;
+	while ((n = ::pread(fd, buffer, sizeof(buffer), offset)) > 0) {
+		result.append(buffer, n);
+		offset += n;
+	}
+	return result;
+}
+
+// The parent's view of a worker process.
+struct WorkerProcess {
+	pid_t pid;
+	int fd;           // read end of the worker's result pipe
+	long currentTest = -1L; // index of the test in progress, or -1
+	bool expectingFailure = false;
+	bool hasDeadline = false;
+	bool timedOut = false;
+	bool quitting = false;  // will exit after reporting its test
+	std::chrono::steady_clock::time_point started;
+	std::chrono::steady_clock::time_point deadline;
+	std::string received;
+
+	WorkerProcess (pid_t p, int f): pid(p), fd(f) {}
+};
+
+// The outcome of one test, as reported by a worker.
+struct WorkerResult {
+	bool done = false;
+	int testResult = -1;
+	std::string testExplanation;
+	UnitTest::TestTiming timing;
+};
+
+// Read what a worker has sent, handing each complete record and its
+// text to handle. Returns false once the worker has closed its end.
+template <typename Handler>
+bool readWorkerRecords (WorkerProcess& w, Handler handle)
+{
+	char buffer[65536];
+	ssize_t n = ::read(w.fd, buffer, sizeof(buffer));
+	if (n < 0 && errno == EINTR)
+		return true;
+	if (n <= 0)
+		return false;
+	w.received.append(buffer, n);
+	BinaryReporter::Record header;
+	std::size_t used = 0;
+	while (w.received.size() - used >= sizeof(header)) {
+		std::memcpy(&header, w.received.data() + used, sizeof(header));
+		if (w.received.size() - used < sizeof(header) + header.length)
+			break;
+		handle(header, w.received.data() + used + sizeof(header));
+		used += sizeof(header) + header.length;
+	}
+	w.received.erase(0, used);
+	return true;
+}
+
+// The outcome of a test as given in a worker's TestFinished record.
+void readResult (WorkerResult& r, const BinaryReporter::Record& header, const char* text)
+{
+	r.done = true;
+	r.testResult = header.testResult;
+	r.testExplanation.assign(text, header.length);
+	r.timing = UnitTest::TestTiming(header.wallMS, header.cpuMS);
+	r.timing.counters.cycles = header.counters[0];
+	r.timing.counters.instructions = header.counters[1];
+	r.timing.counters.cacheMisses = header.counters[2];
+	r.timing.counters.branchMisses = header.counters[3];
+}
+
+// Time that a worker running its tests' own time limits has, past a
+// limit, to report the test as timed out before it is killed.
+const long workerGraceMS = 2000L;
+
+}
+
+
+// The outcome of a test whose worker process ended while running it,
+// either killed at its time limit or by the test itself.
+int UnitTest::Runner::workerEnded (unsigned testNumber, const std::string& testName,
+		bool killed, bool expectingFailure, int status, double elapsedMS,
+		std::string& testExplanation, TestTiming& timing)
+{
+	std::ostringstream out;
+	int testResult;
+	timing = TestTiming(elapsedMS);
+	if (killed) {
+		out << "# Test " << testNumber << " - " << testName << " still running after "
+				<< (*tests)[testName].timeLimit
+				<< " milliseconds - possible infinite loop?";
+		testResult = (expectingFailure) ? 1 : 0;
+	} else {
+		if (WIFSIGNALED(status))
+			out << "# runtime error " << WTERMSIG(status);
+		else
+			out << "# test process exited with status " << WEXITSTATUS(status);
+		testResult = (expectingFailure) ? 1 : -1;
+	}
+	if (expectingFailure)
+		testExplanation = msgXFailed(testNumber, testName, out.str(), timing);
+	else
+		testExplanation = msgFailed(testNumber, testName, out.str(), timing);
+	return testResult;
+}
+
+
+// Run tests in a worker process: claim test indices until none remain,
+// reporting each outcome over resultFd.
+//
+// Normally, tests run directly on the worker's main thread, with their
+// output captured, to be reported along with their results. A crash
+// simply ends the worker, and time limits are enforced by the parent.
+//
+// With passOutput, the worker runs the tests one at a time, as this
+// process would: their output goes straight to its own, and they are
+// held to their time limits on the executor thread. A test that runs out
+// of time is reported, and the worker then exits, taking it along.
+void UnitTest::Runner::runWorker (const std::vector<std::string>& testOrder,
+		const std::function<bool(unsigned&)>& claimTest, int resultFd, bool passOutput)
+{
+	workerResultFd = resultFd;
+	if (passOutput) {
+		// Any executor was the parent's; its thread is not in this process.
+		testExecutor.release();
+	} else {
+		signal(SIGFPE, SIG_DFL);
+		signal(SIGSEGV, SIG_DFL);
+
+		// Capture the test's standard output, so that it can be reported
+		// along with the test result.
+		std::FILE* captured = std::tmpfile();
+		if (captured == nullptr)
+			::_exit(2);
+		std::cout.flush();
+		std::fflush(stdout);
+		::dup2(fileno(captured), STDOUT_FILENO);
+		outputSink->redirect(STDOUT_FILENO);
+	}
+
+	unsigned testIndex;
+	while (claimTest(testIndex))
+	{
+		sendWorkerMessage(resultFd, BinaryReporter::TestStarted, testIndex, 0, "");
+		const std::string& testName = testOrder[testIndex];
+		BoundedTest test = (*tests)[testName];
+		std::string testExplanation;
+		TestTiming timing;
+		if (passOutput) {
+			int testResult = runTestTimed(testIndex+1, testName, test.unitTest,
+					test.timeLimit, testExplanation, timing);
+			std::cout.flush();
+			if (testsAbandoned)
+				sendWorkerMessage(resultFd, BinaryReporter::RunFinished, testIndex, 0, "");
+			sendWorkerMessage(resultFd, BinaryReporter::TestFinished, testIndex, testResult,
+					testExplanation, timing);
+			if (testsAbandoned)
+				::_exit(0);
+			continue;
+		}
+
+		::lseek(STDOUT_FILENO, 0, SEEK_SET);
+		if (::ftruncate(STDOUT_FILENO, 0) != 0)
+			::_exit(2);
+		int testResult = runTestGuarded(testIndex+1, testName, test.unitTest,
+				testExplanation, timing);
+		UnitTest::msg(testExplanation);
+		std::cout.flush();
+		std::fflush(stdout);
+
+		sendWorkerMessage(resultFd, BinaryReporter::TestFinished, testIndex, testResult,
+				readCaptured(STDOUT_FILENO), timing);
+	}
+	::_exit(0);
+}
+
+
+// Run the tests in numJobs worker processes, reporting the results
+// in test-number order.
+void UnitTest::Runner::runTestsInWorkers (const std::vector<std::string>& testOrder,
+		unsigned numJobs, const std::map<std::string, long>* timings,
+		unsigned numFirst)
+{
+	using namespace std::chrono;
+
+	void* shared = ::mmap(nullptr, sizeof(std::atomic<unsigned>),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		reportDiagnostic("# Warning: cannot share a test queue - running serially");
+		for (unsigned i = 0; i < testOrder.size(); ++i) {
+			BoundedTest test = (*tests)[testOrder[i]];
+			runTest (i+1, testOrder[i], test.unitTest, test.timeLimit);
+		}
+		return;
+	}
+	std::atomic<unsigned>* nextTest = new (shared) std::atomic<unsigned>(0);
+
+	// Start the tests known to be slowest first, so that the
+	// last worker is not left running a long test on its own. The
+	// first numFirst tests, though, keep their place at the front.
+	std::vector<unsigned> startOrder (testOrder.size());
+	for (unsigned i = 0; i < testOrder.size(); ++i)
+		startOrder[i] = i;
+	if (timings != nullptr)
+	{
+		auto timeOf = [timings, &testOrder] (unsigned i) {
+			auto pos = timings->find(testOrder[i]);
+			return (pos != timings->end()) ? pos->second : 0L;
+		};
+		std::stable_sort(startOrder.begin() + numFirst, startOrder.end(),
+				[&timeOf] (unsigned a, unsigned b) { return timeOf(a) > timeOf(b); });
+	}
+	auto claimTest = [nextTest, &startOrder] (unsigned& testIndex) {
+		unsigned position = nextTest->fetch_add(1);
+		if (position >= startOrder.size())
+			return false;
+		testIndex = startOrder[position];
+		return true;
+	};
+
+	std::vector<WorkerProcess> workers;
+	std::vector<WorkerResult> results (testOrder.size());
+	unsigned nextToReport = 0;
+
+	auto startWorker = [&] () {
+		int fds[2];
+		if (::pipe(fds) != 0)
+			return false;
+		std::cout.flush();
+		pid_t pid = ::fork();
+		if (pid < 0) {
+			::close(fds[0]);
+			::close(fds[1]);
+			return false;
+		}
+		if (pid == 0) {
+			::close(fds[0]);
+			for (const WorkerProcess& w: workers)
+				::close(w.fd);
+			runWorker(testOrder, claimTest, fds[1], false);
+		}
+		::close(fds[1]);
+		workers.push_back(WorkerProcess(pid, fds[0]));
+		return true;
+	};
+
+	// Handle a message that a worker has sent.
+	auto receive = [&] (WorkerProcess& w, const BinaryReporter::Record& header,
+			const char* text) {
+		unsigned testIndex = header.testNumber - 1;
+		if (header.kind == BinaryReporter::TestStarted) {
+			w.currentTest = testIndex;
+			w.expectingFailure = false;
+			long timeLimit = (*tests)[testOrder[testIndex]].timeLimit;
+			w.hasDeadline = timeLimit > 0L;
+			w.started = steady_clock::now();
+			w.deadline = w.started + milliseconds(timeLimit);
+		} else if (header.kind == BinaryReporter::TestExpectedToFail) {
+			w.expectingFailure = true;
+		} else if (header.kind == BinaryReporter::TestFinished) {
+			readResult(results[testIndex], header, text);
+			w.currentTest = -1L;
+			w.hasDeadline = false;
+		}
+	};
+
+	// Record the outcome of the test a worker was running when it ended.
+	auto testEnded = [&] (WorkerProcess& w, int status) {
+		unsigned testIndex = w.currentTest;
+		WorkerResult& r = results[testIndex];
+		duration<double, std::milli> elapsed = steady_clock::now() - w.started;
+		r.done = true;
+		r.testResult = workerEnded(testIndex + 1, testOrder[testIndex], w.timedOut,
+				w.expectingFailure, status, elapsed.count(), r.testExplanation, r.timing);
+	};
+
+	for (unsigned i = 0; i < numJobs && i < testOrder.size(); ++i)
+		startWorker();
+
+	while (!workers.empty() || nextToReport < testOrder.size())
+	{
+		if (workers.empty()) {
+			// Could not start any workers, so run the rest here.
+			unsigned i;
+			while (claimTest(i)) {
+				BoundedTest test = (*tests)[testOrder[i]];
+				results[i].done = true;
+				results[i].testResult = runTestTimed(i+1, testOrder[i], test.unitTest,
+						test.timeLimit, results[i].testExplanation, results[i].timing);
+			}
+			// Any lost by a worker between claiming and starting them,
+			// or left unclaimed when the run was stopped
+			for (i = nextToReport; i < testOrder.size(); ++i)
+				if (!results[i].done && stopRequested) {
+					results[i].done = true;
+					results[i].testResult = testSkipped;
+				} else if (!results[i].done) {
+					results[i].done = true;
+					results[i].testResult = -1;
+					results[i].testExplanation = msgError(i+1, testOrder[i],
+							"Test " + std::to_string(i+1) + " - " + testOrder[i]
+							+ " was lost by its worker process", TestTiming());
+				}
+		} else {
+			// Wait for output, or for the earliest deadline.
+			int timeout = -1;
+			steady_clock::time_point now = steady_clock::now();
+			for (const WorkerProcess& w: workers)
+				if (w.hasDeadline && !w.timedOut) {
+					long remaining = (w.deadline > now)
+							? (long)duration_cast<milliseconds>(w.deadline - now).count() + 1
+							: 0L;
+					if (timeout < 0 || remaining < timeout)
+						timeout = remaining;
+				}
+
+			std::vector<pollfd> polls;
+			for (const WorkerProcess& w: workers)
+				polls.push_back(pollfd{w.fd, POLLIN, 0});
+			if (::poll(polls.data(), polls.size(), timeout) < 0 && errno != EINTR)
+				break;
+
+			now = steady_clock::now();
+			for (unsigned k = workers.size(); k-- > 0; ) {
+				WorkerProcess& w = workers[k];
+				if (w.hasDeadline && !w.timedOut && now >= w.deadline) {
+					::kill(w.pid, SIGKILL);
+					w.timedOut = true;
+				}
+				if (polls[k].revents == 0)
+					continue;
+				if (readWorkerRecords(w, [&] (const BinaryReporter::Record& header,
+						const char* text) { receive(w, header, text); }))
+					continue;
+
+				// The worker has exited.
+				::close(w.fd);
+				int status = 0;
+				::waitpid(w.pid, &status, 0);
+				if (w.currentTest >= 0)
+					testEnded(w, status);
+				workers.erase(workers.begin() + k);
+				if (nextTest->load() < testOrder.size())
+					startWorker();
+			}
+		}
+
+		while (nextToReport < testOrder.size() && results[nextToReport].done) {
+			WorkerResult& r = results[nextToReport];
+			if (stopRequested)
+				recordResult (nextToReport+1, testOrder[nextToReport], testSkipped,
+						msgSkipped(nextToReport+1, testOrder[nextToReport]), TestTiming());
+			else
+				recordResult (nextToReport+1, testOrder[nextToReport], r.testResult,
+						r.testExplanation, r.timing);
+			r.testExplanation.clear();
+			++nextToReport;
+		}
+		if (stopRequested)
+			nextTest->store(testOrder.size()); // Start no more tests.
+	}
+	::munmap(shared, sizeof(std::atomic<unsigned>));
+}
+
+#else
+
+// No fork on this platform, so the tests run in this process.
+void UnitTest::Runner::runTestsInWorkers (const std::vector<std::string>& testOrder,
+		unsigned numJobs, const std::map<std::string, long>* timings,
+		unsigned numFirst)
+{
+	for (unsigned i = 0; i < testOrder.size(); ++i) {
+		BoundedTest test = (*tests)[testOrder[i]];
+		runTest (i+1, testOrder[i], test.unitTest, test.timeLimit);
+	}
+}
+
+#endif
+
+
+#ifndef __MINGW32__
+
+namespace {
+
+/**
+ * The worker process in which the tests that promise nothing are run,
+ * one at a time, when they can be. It is started when first needed, and
+ * again, from this process as it is then, after a test has crashed it,
+ * or has been left running in it and ended it.
+ */
+class SerialWorker {
+public:
+	typedef std::function<void(int commandFd, int resultFd)> Body;
+	typedef std::function<void(unsigned testIndex, const WorkerProcess& w, int status,
+			WorkerResult& result)> Ending;
+
+	/**
+	 * @param workerBody runs the worker, given the pipes on which it is
+	 *                   sent the indices of its tests and reports them
+	 * @param testEnded fills in the result of a test whose worker
+	 *                  ended while running it
+	 */
+	SerialWorker (Body workerBody, Ending testEnded)
+	: body(workerBody), ended(testEnded),
+	  // A worker that has exited is then found by a failed write.
+	  previousSIGPIPE(signal(SIGPIPE, SIG_IGN))
+	{}
+
+	~SerialWorker ()
+	{
+		if (process != nullptr)
+			stop();
+		signal(SIGPIPE, previousSIGPIPE);
+	}
+
+	/**
+	 * Run a test in the worker, killing the worker if it is still
+	 * running the test well after its time limit.
+	 *
+	 * @return false if no worker can be started to run it
+	 */
+	bool run (unsigned testIndex, long timeLimit, WorkerResult& result)
+	{
+		using namespace std::chrono;
+		std::cout.flush(); // to come before the test's own output
+		std::uint32_t command = testIndex;
+		bool sent = false;
+		for (int attempt = 0; attempt < 2 && !sent; ++attempt) {
+			if (process == nullptr && !start())
+				return false;
+			sent = ::write(commandFd, &command, sizeof(command)) == (ssize_t)sizeof(command);
+			if (!sent)
+				stop(); // gone since its last test
+		}
+		if (!sent)
+			return false;
+
+		WorkerProcess& w = *process;
+		w.currentTest = testIndex;
+		w.expectingFailure = false;
+		w.timedOut = false;
+		w.quitting = false;
+		w.started = steady_clock::now();
+		w.hasDeadline = timeLimit > 0L;
+		w.deadline = w.started + milliseconds(timeLimit + workerGraceMS);
+		while (true) {
+			int timeout = -1;
+			if (w.hasDeadline && !w.timedOut) {
+				steady_clock::time_point now = steady_clock::now();
+				timeout = (w.deadline > now)
+						? (int)duration_cast<milliseconds>(w.deadline - now).count() + 1 : 0;
+			}
+			pollfd waiting {w.fd, POLLIN, 0};
+			int ready = ::poll(&waiting, 1, timeout);
+			if (ready < 0 && errno != EINTR)
+				::kill(w.pid, SIGKILL);
+			if (w.hasDeadline && !w.timedOut && steady_clock::now() >= w.deadline) {
+				::kill(w.pid, SIGKILL);
+				w.timedOut = true;
+			}
+			if (ready <= 0)
+				continue;
+
+			bool finished = false;
+			bool open = readWorkerRecords(w, [&] (const BinaryReporter::Record& header,
+					const char* text) {
+				if (header.kind == BinaryReporter::TestExpectedToFail)
+					w.expectingFailure = true;
+				else if (header.kind == BinaryReporter::RunFinished)
+					w.quitting = true;
+				else if (header.kind == BinaryReporter::TestFinished) {
+					readResult(result, header, text);
+					finished = true;
+				}
+			});
+			if (finished) {
+				if (w.quitting)
+					stop();
+				return true;
+			}
+			if (open)
+				continue;
+
+			// The worker has exited.
+			::close(commandFd);
+			::close(w.fd);
+			int status = 0;
+			::waitpid(w.pid, &status, 0);
+			ended(testIndex, w, status, result);
+			process.reset();
+			return true;
+		}
+	}
+
+private:
+	Body body;
+	Ending ended;
+	void (*previousSIGPIPE)(int);
+	std::unique_ptr<WorkerProcess> process;
+	int commandFd = -1;
+
+	bool start ()
+	{
+		int commands[2];
+		int results[2];
+		if (::pipe(commands) != 0)
+			return false;
+		if (::pipe(results) != 0) {
+			::close(commands[0]);
+			::close(commands[1]);
+			return false;
+		}
+		std::cout.flush();
+		pid_t pid = ::fork();
+		if (pid == 0) {
+			::close(commands[1]);
+			::close(results[0]);
+			signal(SIGPIPE, previousSIGPIPE);
+			body(commands[0], results[1]);
+			::_exit(0);
+		}
+		::close(commands[0]);
+		::close(results[1]);
+		if (pid < 0) {
+			::close(commands[1]);
+			::close(results[0]);
+			return false;
+		}
+		process.reset(new WorkerProcess(pid, results[0]));
+		commandFd = commands[1];
+		return true;
+	}
+
+	// Closing its commands tells the worker that there are no more tests.
+	void stop ()
+	{
+		::close(commandFd);
+		::close(process->fd);
+		::waitpid(process->pid, nullptr, 0);
+		process.reset();
+	}
+};
+
+// A test run on the thread pool and its outcome, held until its turn
+// to be reported.
+struct PooledTest {
+	unsigned testNumber = 0;
+	std::string name;
+	UnitTest::TestFunction function = nullptr;
+	long timeLimit = 0;
+
+	std::atomic<bool> done {false};
+	int testResult = 0;
+	std::string explanation;
+	std::string output;
+	UnitTest::TestTiming timing;
+};
+
+/**
+ * A work-stealing pool of threads for the concurrent tests. Each thread
+ * takes tests from the front of its own queue and, once that is empty,
+ * steals them from the back of the others'.
+ *
+ * A thread whose test overruns its time limit cannot be stopped, so it is
+ * abandoned: its queue gets a new thread, and whatever the old one
+ * finally produces is discarded.
+ */
+struct TestPool {
+	struct Queue {
+		std::mutex m;
+		std::deque<unsigned> waiting;
+		unsigned generation = 0; // bumped when the queue's thread is abandoned
+		long running = -1;       // the test in progress, or -1
+		std::chrono::steady_clock::time_point started;
+		std::shared_ptr<UnitTest::TestContext> context;
+	};
+
+	std::vector<PooledTest> tests;
+	std::vector<Queue> queues;
+	std::atomic<unsigned> remaining;
+	std::atomic<long> awaited;   // the test being waited for, or -1 for all
+	std::mutex progressMutex;
+	std::condition_variable progress;
+
+	TestPool (unsigned numTests, unsigned numQueues)
+	: tests(numTests), queues(numQueues), remaining(numTests), awaited(-1L) {}
+
+	// Claim a test for the thread of queue q, if it is still current.
+	bool claim (unsigned q, unsigned generation, unsigned& test)
+	{
+		bool found = false;
+		{
+			std::lock_guard<std::mutex> l(queues[q].m);
+			if (queues[q].generation != generation)
+				return false;
+			if (!queues[q].waiting.empty()) {
+				test = queues[q].waiting.front();
+				queues[q].waiting.pop_front();
+				found = true;
+			}
+		}
+		for (unsigned i = 1; i < queues.size() && !found; ++i) {
+			Queue& victim = queues[(q + i) % queues.size()];
+			std::lock_guard<std::mutex> l(victim.m);
+			if (!victim.waiting.empty()) {
+				test = victim.waiting.back();
+				victim.waiting.pop_back();
+				found = true;
+			}
+		}
+		if (!found)
+			return false;
+		std::lock_guard<std::mutex> l(queues[q].m);
+		if (queues[q].generation != generation) {
+			queues[q].waiting.push_front(test); // for the replacement thread
+			return false;
+		}
+		queues[q].running = test;
+		queues[q].started = std::chrono::steady_clock::now();
+		queues[q].context = std::make_shared<UnitTest::TestContext>(tests[test].name);
+		return true;
+	}
+
+	// Record the outcome of a test, unless it was already reported as
+	// timed out.
+	bool finish (unsigned q, unsigned generation, unsigned test, int testResult,
+			std::string& explanation, std::string& output, const UnitTest::TestTiming& timing)
+	{
+		{
+			std::lock_guard<std::mutex> l(queues[q].m);
+			if (queues[q].generation != generation)
+				return false;
+			queues[q].running = -1;
+			queues[q].context.reset();
+			complete(test, testResult, explanation, output, timing);
+		}
+		return true;
+	}
+
+	// Called with the lock of the queue that ran the test.
+	void complete (unsigned test, int testResult, std::string& explanation,
+			std::string& output, const UnitTest::TestTiming& timing)
+	{
+		PooledTest& t = tests[test];
+		t.testResult = testResult;
+		t.explanation.swap(explanation);
+		t.output.swap(output);
+		t.timing = timing;
+		t.done = true;
+		unsigned left = --remaining;
+		long waitingFor = awaited;
+		if (waitingFor == (long)test || (waitingFor < 0 && left == 0)) {
+			{ std::lock_guard<std::mutex> pl(progressMutex); }
+			progress.notify_all();
+		}
+	}
+};
+
+}
+
+// Run the concurrent tests among testOrder on numThreads threads, and
+// then the others, one at a time, reporting all of them in order.
+//
+// The pool runs in a worker process of its own, which ends, taking
+// along any test left running past its time limit, before the others
+// run. They run in another worker process, which is killed, and
+// replaced, if one of them cannot be stopped at its time limit. Under a
+// debugger, or while baselines are recorded, all of them run in this
+// process instead, and a test left running ends the run.
+void UnitTest::Runner::runTestsInThreads (const std::vector<std::string>& testOrder,
+		unsigned numThreads)
+{
+	std::unique_ptr<SerialWorker> serial;
+	auto runAlone = [&] (unsigned i) {
+		BoundedTest test = (*tests)[testOrder[i]];
+		if (serial == nullptr && !debuggerIsRunning() && !updateBaselines)
+			serial.reset(new SerialWorker(
+				[&testOrder] (int commandFd, int resultFd) {
+					// The tests left running in this process are not in the worker.
+					testsAbandoned = false;
+					runWorker(testOrder, [commandFd] (unsigned& testIndex) {
+						std::uint32_t command;
+						ssize_t n;
+						do {
+							n = ::read(commandFd, &command, sizeof(command));
+						} while (n < 0 && errno == EINTR);
+						testIndex = command;
+						return n == (ssize_t)sizeof(command);
+					}, resultFd, true);
+				},
+				[&testOrder] (unsigned testIndex, const WorkerProcess& w, int status,
+						WorkerResult& r) {
+					std::chrono::duration<double, std::milli> elapsed =
+							std::chrono::steady_clock::now() - w.started;
+					r.done = true;
+					r.testResult = workerEnded(testIndex + 1, testOrder[testIndex],
+							w.timedOut, w.expectingFailure, status, elapsed.count(),
+							r.testExplanation, r.timing);
+				}));
+		WorkerResult r;
+		if (serial != nullptr && !stopRequested.load() && serial->run(i, test.timeLimit, r))
+			recordResult (i+1, testOrder[i], r.testResult, r.testExplanation, r.timing);
+		else
+			runTest (i+1, testOrder[i], test.unitTest, test.timeLimit);
+	};
+
+	std::vector<long> pooled (testOrder.size(), -1L); // index in the pool
+	unsigned numPooled = 0;
+	for (unsigned i = 0; i < testOrder.size(); ++i)
+		if ((*tests)[testOrder[i]].concurrent)
+			pooled[i] = numPooled++;
+	if (numThreads < 2 || numPooled < 2)
+	{
+		for (unsigned i = 0; i < testOrder.size(); ++i)
+			runAlone(i);
+		return;
+	}
+
+	numThreads = std::min(numThreads, numPooled);
+	auto pool = std::make_shared<TestPool>(numPooled, numThreads);
+	for (unsigned i = 0; i < testOrder.size(); ++i) {
+		if (pooled[i] < 0)
+			continue;
+		PooledTest& t = pool->tests[pooled[i]];
+		const BoundedTest& test = (*tests)[testOrder[i]];
+		t.testNumber = i + 1;
+		t.name = testOrder[i];
+		t.function = test.unitTest;
+		t.timeLimit = test.timeLimit;
+	}
+	// Contiguous blocks, so that neighbouring tests tend to share a thread.
+	for (unsigned k = 0; k < numPooled; ++k)
+		pool->queues[(unsigned long long)k * numThreads / numPooled].waiting.push_back(k);
+
+	// Copied into each thread, since an abandoned one may outlive this call.
+	std::function<void(unsigned, unsigned)> work =
+		[pool] (unsigned q, unsigned generation) {
+			signalsAlreadyGuarded = true;
+			unsigned test;
+			while (pool->claim(q, generation, test)) {
+				PooledTest& t = pool->tests[test];
+				std::string explanation;
+				std::string output;
+				TestTiming timing;
+				if (stopRequested) {
+					// To be reported as skipped, so not worth running.
+					if (!pool->finish(q, generation, test, testSkipped, explanation, output,
+							timing))
+						return;
+					continue;
+				}
+				std::shared_ptr<TestContext> context;
+				{
+					std::lock_guard<std::mutex> l(pool->queues[q].m);
+					context = pool->queues[q].context;
+				}
+				capturedOutput = &output;
+				int testResult = runTestGuarded(t.testNumber, t.name, t.function,
+						explanation, timing, context);
+				capturedOutput = nullptr;
+				if (!pool->finish(q, generation, test, testResult, explanation, output, timing))
+					return;
 			}
-		} else {
-			u();
-			if (!expectToFail) {
-				UnitTest::msgPassed(testNumber, testName, 0);
-			} else {
-				// Failed (passed but was expected to fail
-				UnitTest::msgXPassed(testNumber, testName, 0);
-				return 0;
+		};
+
+	// Run the pool, handing each pooled test to reported, in order, once it
+	// has finished. With runSerial, the other tests are run between them;
+	// otherwise this is the pool's worker process, which ends afterwards.
+	auto runPool = [&] (const std::function<void(PooledTest&)>& reported, bool runSerial) {
+		TestSignalGuard signalGuard;
+		signalGuard.install();
+		std::vector<std::thread> threads;
+		for (unsigned q = 0; q < numThreads; ++q)
+			threads.push_back(std::thread(work, q, 0u));
+
+		// Never destroyed, since a thread still running cannot be joined.
+		std::vector<std::thread>* abandoned = nullptr;
+
+		// Report the timed-out tests, and replace the threads running them.
+		const bool enforceLimits = !debuggerIsRunning();
+		auto abandonOverdue = [&] () {
+			auto now = std::chrono::steady_clock::now();
+			for (unsigned q = 0; q < numThreads; ++q) {
+				TestPool::Queue& queue = pool->queues[q];
+				std::lock_guard<std::mutex> l(queue.m);
+				if (queue.running < 0)
+					continue;
+				PooledTest& t = pool->tests[queue.running];
+				if (t.timeLimit <= 0L
+					|| now - queue.started < std::chrono::milliseconds(t.timeLimit))
+					continue;
+				std::string explanation;
+				std::string output;
+				TestTiming timing;
+				int testResult = timedOut(t.testNumber, t.name, t.timeLimit,
+						*queue.context, explanation, timing);
+				unsigned test = queue.running;
+				queue.running = -1;
+				queue.context.reset();
+				++queue.generation;
+				pool->complete(test, testResult, explanation, output, timing);
+				if (abandoned == nullptr)
+					abandoned = new std::vector<std::thread>();
+				abandoned->push_back(std::move(threads[q]));
+				testsAbandoned = true;
+				if (runSerial && !stopRequested.load()) {
+					stopRequested = true;
+					reportDiagnostic ("# Test " + std::to_string(t.testNumber) + " - " + t.name
+							+ " cannot be stopped, so the tests after it are skipped");
+				}
+				threads[q] = std::thread(work, q, queue.generation);
+			}
+		};
+
+		// Wait until a pooled test (or, with -1, all of them) has finished.
+		auto await = [&] (long test) {
+			pool->awaited = test;
+			std::unique_lock<std::mutex> l(pool->progressMutex);
+			while ((test >= 0) ? !pool->tests[test].done.load() : pool->remaining > 0) {
+				pool->progress.wait_for(l, std::chrono::milliseconds(10));
+				if (enforceLimits) {
+					l.unlock();
+					abandonOverdue();
+					l.lock();
+				}
+			}
+		};
+
+		for (unsigned i = 0; i < testOrder.size(); ++i) {
+			if (pooled[i] >= 0) {
+				await(pooled[i]);
+				reported(pool->tests[pooled[i]]);
+			} else if (runSerial) {
+				// The remaining tests promised nothing, so run them alone.
+				await(-1L);
+				runAlone(i);
 			}
 		}
-		return 1;
-	} catch (UnitTestFailure& ex) {
-		if (!expectToFail) {
-			testExplanation = UnitTest::msgFailed(testNumber, testName, ex.what(), 0);
-			return 0;
-		} else {
-			// OK (failed but was expected to fail)"
-			UnitTest::msgXFailed(testNumber, testName, ex.what(), 0);
-			return 1;
+		await(-1L);
+		for (std::thread& t: threads)
+			t.join();
+	};
+
+	auto reportHere = [] (PooledTest& t) {
+		if (stopRequested) {
+			recordResult (t.testNumber, t.name, testSkipped,
+					msgSkipped(t.testNumber, t.name), TestTiming());
+			return;
 		}
-	} catch (std::exception& e) {
-		if (!expectToFail) {
-			UnitTest::msgError(testNumber, testName,
-					"Unexpected error in " + currentTest + ": " +e.what(), 0);
-			testExplanation = "";
-			return -1;
-		} else {
-			// OK (exception but was expected to fail)"
-			UnitTest::msgXFailed(testNumber, testName, "", 0);
-			return 1;
+		std::cout << t.output;
+		recordResult (t.testNumber, t.name, t.testResult, t.explanation, t.timing);
+	};
+
+	// The pool runs in a worker process of its own, where it can, so that
+	// a test left running past its time limit ends with that process,
+	// before any test after the pool is run.
+	int fds[2];
+	pid_t pid = -1;
+	if (!debuggerIsRunning() && !updateBaselines && ::pipe(fds) == 0) {
+		std::cout.flush();
+		pid = ::fork();
+		if (pid < 0) {
+			::close(fds[0]);
+			::close(fds[1]);
 		}
-	} catch (...) {
-		if (!expectToFail) {
-			UnitTest::msgError(testNumber, testName, "Unexpected error in " + currentTest, 0);
-			testExplanation = "";
-			return -1;
+	}
+	if (pid < 0) {
+		runPool(reportHere, true);
+		return;
+	}
+	if (pid == 0) {
+		::close(fds[0]);
+		// Any executor was the parent's; its thread is not in this process.
+		testExecutor.release();
+		runPool([&fds] (PooledTest& t) {
+			// Kept count of here, too, so that --fail-fast stops the pool.
+			if (t.testResult == 0)
+				++numFailures;
+			else if (t.testResult == -1)
+				++numErrors;
+			if (failFastLimit > 0L && numFailures + numErrors >= failFastLimit)
+				stopRequested = true;
+			unsigned testIndex = t.testNumber - 1;
+			sendWorkerMessage(fds[1], BinaryReporter::Diagnostic, testIndex, 0, t.output);
+			sendWorkerMessage(fds[1], BinaryReporter::TestFinished, testIndex, t.testResult,
+					t.explanation, t.timing);
+		}, false);
+		::_exit(0);
+	}
+	::close(fds[1]);
+
+	WorkerProcess w(pid, fds[0]);
+	std::vector<WorkerResult> results (numPooled);
+	bool ended = false;
+	int status = 0;
+	// Read what the pool's worker has reported, until a pooled test (or,
+	// with -1, all of them) has finished and the worker has ended.
+	auto receive = [&] (long test) {
+		while (!ended && (test < 0 || !results[test].done)) {
+			if (readWorkerRecords(w, [&] (const BinaryReporter::Record& header,
+					const char* text) {
+				PooledTest& t = pool->tests[pooled[header.testNumber - 1]];
+				if (header.kind == BinaryReporter::Diagnostic)
+					t.output.assign(text, header.length);
+				else if (header.kind == BinaryReporter::TestFinished)
+					readResult(results[pooled[header.testNumber - 1]], header, text);
+			}))
+				continue;
+			::close(w.fd);
+			::waitpid(pid, &status, 0);
+			ended = true;
+		}
+	};
+
+	for (unsigned i = 0; i < testOrder.size(); ++i) {
+		if (pooled[i] >= 0) {
+			receive(pooled[i]);
+			PooledTest& t = pool->tests[pooled[i]];
+			WorkerResult& r = results[pooled[i]];
+			if (stopRequested || r.testResult == testSkipped) {
+				recordResult (t.testNumber, t.name, testSkipped,
+						msgSkipped(t.testNumber, t.name), TestTiming());
+				continue;
+			}
+			if (!r.done)
+				r.testResult = workerEnded(t.testNumber, t.name, false, false, status, 0.0,
+						r.testExplanation, r.timing);
+			std::cout << t.output;
+			recordResult (t.testNumber, t.name, r.testResult, r.testExplanation, r.timing);
 		} else {
-			// OK (exception but was expected to fail)"
-			UnitTest::msgXFailed(testNumber, testName, "", 0);
-			return 1;
+			// The remaining tests promised nothing, so run them alone.
+			receive(-1L);
+			runAlone(i);
 		}
 	}
+	receive(-1L);
 }
 
-/**
- * Reverses the expectation for the current test.  A test that fails or halts
- * with an error will be reported and counted as OK.  If that test succeeds,
- * it will be reported and counted as an error.
- *
- * Must be called before any assertions.
- */
-void UnitTest::expectedToFail()
+#else
+
+// No threads on this platform, so the tests all run one at a time.
+void UnitTest::Runner::runTestsInThreads (const std::vector<std::string>& testOrder,
+		unsigned numThreads)
+{
+	for (unsigned i = 0; i < testOrder.size(); ++i) {
+		BoundedTest test = (*tests)[testOrder[i]];
+		runTest (i+1, testOrder[i], test.unitTest, test.timeLimit);
+	}
+}
+
+#endif
+
+
+
+namespace {
+
+// Timings of a benchmark stop growing at this many iterations.
+const unsigned long long maxBenchmarkIterations = 1000000000ULL;
+
+long long nowNS ()
 {
-	expectToFail = true;
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Read, in benchmarkSink, so that the escaped values are never dead.
+const volatile void* volatile benchmarkEscape = nullptr;
+
 }
 
-// Run a single unit test function with no timer.
-void UnitTest::runTestUntimed (unsigned testNumber, std::string testName, TestFunction u)
+void CppUnitLite::benchmarkSink (const volatile void* p)
 {
-	int testResult; // 1== passed, 0 == failed, -1 == erro
-	std::string testExplanation;
+	benchmarkEscape = p;
+}
 
-	// No time-out supported if compiler does not have thread support.
-	testResult = runTestGuarded (testNumber, testName, u, testExplanation);
+Benchmark::Benchmark ()
+: remaining(0), runIterations(0), started(false), finished(false),
+  startNS(0), elapsedNS(0), bytesPerIteration(-1.0), itemsPerIteration(-1.0)
+{}
 
-	try {
-		// Normal exit
-		if (testResult == 1) {
-			++numSuccesses;
-		} else if (testResult == 0) {
-			++numFailures;
-			failedTests.push_back(testName);
-			UnitTest::msg(testExplanation);
-		} else if (testResult == -1) {
-			++numErrors;
-			failedTests.push_back(testName);
-			UnitTest::msg(testExplanation);
+// The slow path of keepRunning(): the first and last calls of a run.
+bool Benchmark::startOrStop ()
+{
+	if (finished)
+		return false;
+	if (!started) {
+		started = true;
+		remaining = (runIterations > 0) ? runIterations - 1 : 0;
+		startNS = nowNS();
+		return runIterations > 0;
+	}
+	elapsedNS += nowNS() - startNS;
+	finished = true;
+	return false;
+}
+
+void Benchmark::pauseTiming ()
+{
+	elapsedNS += nowNS() - startNS;
+}
+
+void Benchmark::resumeTiming ()
+{
+	startNS = nowNS();
+}
+
+double Benchmark::measure (const Callable<void(Benchmark&)>& body, unsigned long long n,
+		bool& looped)
+{
+	remaining = 0;
+	runIterations = n;
+	started = false;
+	finished = false;
+	elapsedNS = 0;
+	if (looped) {
+		body(*this);
+		if (started) {
+			if (!finished)
+				elapsedNS += nowNS() - startNS; // left the loop early
+			unsigned long long done = runIterations - remaining;
+			return (done > 0) ? (double)elapsedNS / done : 0.0;
 		}
-	} catch (std::runtime_error& e) {
-		++numErrors;
-		failedTests.push_back(testName);
-		UnitTest::msg(std::string("# Test ") + currentTest + " failed due to "
-				+ e.what() + "\n");
+		looped = false;
 	}
+	// No loop of its own, so time the calls of the body.
+	started = true;
+	startNS = nowNS();
+	for (unsigned long long i = 0; i < n; ++i)
+		body(*this);
+	elapsedNS += nowNS() - startNS;
+	return (double)elapsedNS / n;
+}
+
 
+BenchmarkStatistics::BenchmarkStatistics ()
+: iterations(0), repetitions(0), minNS(0.0), medianNS(0.0), p99NS(0.0),
+  meanNS(0.0), stddevNS(0.0), bytesPerSecond(-1.0), itemsPerSecond(-1.0)
+{}
 
+BenchmarkStatistics::BenchmarkStatistics (std::vector<double> nsPerIteration,
+		unsigned long long iterationsPerRepetition,
+		double bytesPerIteration, double itemsPerIteration)
+: BenchmarkStatistics()
+{
+	iterations = iterationsPerRepetition;
+	repetitions = nsPerIteration.size();
+	if (nsPerIteration.empty())
+		return;
+	std::sort(nsPerIteration.begin(), nsPerIteration.end());
+	std::size_t n = nsPerIteration.size();
+	minNS = nsPerIteration.front();
+	medianNS = (n % 2 == 1) ? nsPerIteration[n/2]
+			: (nsPerIteration[n/2 - 1] + nsPerIteration[n/2]) / 2.0;
+	// Nearest rank, so that it is one of the timings.
+	p99NS = nsPerIteration[(std::size_t)std::ceil(0.99 * n) - 1];
+	double sum = 0.0;
+	for (double t: nsPerIteration)
+		sum += t;
+	meanNS = sum / n;
+	double squares = 0.0;
+	for (double t: nsPerIteration)
+		squares += (t - meanNS) * (t - meanNS);
+	stddevNS = (n > 1) ? std::sqrt(squares / (n - 1)) : 0.0;
+	if (bytesPerIteration >= 0.0 && medianNS > 0.0)
+		bytesPerSecond = bytesPerIteration * 1.0e9 / medianNS;
+	if (itemsPerIteration >= 0.0 && medianNS > 0.0)
+		itemsPerSecond = itemsPerIteration * 1.0e9 / medianNS;
 }
 
+std::string BenchmarkStatistics::yaml () const
+{
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3)
+		<< "benchmark:"
+		<< "\n  iterations: " << iterations
+		<< "\n  repetitions: " << repetitions
+		<< "\n  min_ns: " << minNS
+		<< "\n  median_ns: " << medianNS
+		<< "\n  p99_ns: " << p99NS
+		<< "\n  mean_ns: " << meanNS
+		<< "\n  stddev_ns: " << stddevNS
+		<< std::setprecision(0);
+	if (bytesPerSecond >= 0.0)
+		out << "\n  bytes_per_second: " << bytesPerSecond;
+	if (itemsPerSecond >= 0.0)
+		out << "\n  items_per_second: " << itemsPerSecond;
+	return out.str();
+}
 
-#ifndef __MINGW32__
+std::string BenchmarkStatistics::summary () const
+{
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3)
+		<< "min " << minNS << ", median " << medianNS << ", p99 " << p99NS
+		<< ", stddev " << stddevNS << " ns, over " << repetitions << " x "
+		<< iterations << " calls";
+	return out.str();
+}
 
-// Run a single unit test function.
-void UnitTest::runTest (unsigned testNumber, std::string testName, TestFunction u, long timeLimit)
+
+// Calibrate, warm up and then repeatedly time a benchmark.
+BenchmarkStatistics UnitTest::Runner::measureBenchmark (
+		const Callable<void(Benchmark&)>& body, bool looped)
 {
-	if (timeLimit > 0L && !debuggerIsRunning())
+	Benchmark benchmark;
+	const double targetNS = benchmarkMinMS * 1.0e6;
+
+	// Grow the iterations until a timing lasts long enough to be
+	// trusted. These first runs also warm up the caches.
+	unsigned long long iterations = 1;
+	double perIteration = benchmark.measure(body, iterations, looped);
+	while (perIteration * iterations < targetNS && iterations < maxBenchmarkIterations)
 	{
-		int testResult = -99; // 1== passed, 0 == failed, -1 == error
-		std::string testExplanation;
+		double total = perIteration * iterations;
+		double growth = (total > 0.0) ? std::min(10.0, 1.4 * targetNS / total) : 10.0;
+		iterations = std::min(maxBenchmarkIterations,
+				std::max(iterations + 1,
+						(unsigned long long)std::ceil(iterations * growth)));
+		perIteration = benchmark.measure(body, iterations, looped);
+	}
+	benchmark.measure(body, iterations, looped); // warm up at full length
 
-		std::mutex m;
-		std::chrono::duration<int,std::milli> limit (timeLimit);
-		std::chrono::duration<int,std::milli> incr (100);
-		std::chrono::duration<int,std::milli> elapsed (0);
+	std::vector<double> samples;
+	for (unsigned r = 0; r < benchmarkRepetitions; ++r)
+		samples.push_back(benchmark.measure(body, iterations, looped));
+	return BenchmarkStatistics(samples, iterations,
+			benchmark.bytesPerIteration, benchmark.itemsPerIteration);
+}
 
-		std::thread t([&m, &testNumber, &testName, &u, &testResult, &testExplanation](){
-			{
-				int result = runTestGuarded (testNumber, testName, u, testExplanation);
-				std::unique_lock<std::mutex> l2(m);
-				testResult = result;
-			}
-		});
-		t.detach();
-
-		bool finished = false;
-		do {
-		    {
-		    	std::unique_lock<std::mutex> l(m);
-		    	finished = (testResult >= -1 || elapsed >= limit);
-		    	elapsed += incr;
-		    }
-		    std::this_thread::sleep_for( incr );
-		} while (!finished);
-
-		if (testResult < -1) {
-			++numFailures;
-			failedTests.push_back(testName);
+void UnitTest::runBenchmark (void (*body)(Benchmark&))
+{
+	BenchmarkStatistics stats = Runner::measureBenchmark(body, true);
+	std::shared_ptr<TestContext> context = currentContext();
+	context->details = stats.yaml();
+	std::lock_guard<std::mutex> l(resultsMutex);
+	Runner::benchmarkResults[context->name] = stats;
+}
+
+
+namespace {
+
+// Guards the baselines, which concurrent tests may check at once.
+std::mutex baselinesMutex;
+
+std::string hostName ()
+{
+#ifndef __MINGW32__
+	char name[256];
+	if (gethostname(name, sizeof(name)) == 0) {
+		name[sizeof(name) - 1] = '\0';
+		return name;
+	}
+#else
+	const char* name = std::getenv("COMPUTERNAME");
+	if (name != nullptr)
+		return name;
+#endif
+	return "unknown";
+}
+
+// A field of a baselines file, with any whitespace within it replaced.
+std::string baselineField (std::string field)
+{
+	for (char& c: field)
+		if (std::isspace((unsigned char)c))
+			c = '_';
+	return field;
+}
+
+// The whitespace-separated fields that identify a baseline.
+std::string baselineKey (const std::string& testName, const std::string& key,
+		const std::string& machine)
+{
+	return baselineField(testName) + ' ' + baselineField(key) + ' ' + baselineField(machine);
+}
+
+}
+
+AssertionResult UnitTest::completesWithin (double limitNS,
+		const Callable<void()>& body)
+{
+	BenchmarkStatistics measured = Runner::measureBenchmark(
+			[&body] (Benchmark&) { body(); }, false);
+	return AssertionResult(measured.medianNS <= limitNS,
+		[measured, limitNS] (bool passed) {
 			std::ostringstream out;
-			out << "# Test " << testNumber << " - " << currentTest << " still running after "
-					<< timeLimit
-					<< " milliseconds - possible infinite loop?";
-			if (!expectToFail)
-			{
-				UnitTest::msg (
-						UnitTest::msgFailed(testNumber, testName, out.str(), timeLimit)
-				);
-			}
-			else
-			{
-				UnitTest::msgXFailed(testNumber, testName, out.str(), timeLimit);
-				++numSuccesses;
-				--numFailures;
-			}
-		}
-		// Normal exit
-		else if (testResult == 1) {
-			++numSuccesses;
-		} else if (testResult == 0) {
-			++numFailures;
-			failedTests.push_back(testName);
-			UnitTest::msg(testExplanation);
-		} else if (testResult == -1) {
-			++numErrors;
-			failedTests.push_back(testName);
-			UnitTest::msg(testExplanation);
-		}
+			out << std::fixed << std::setprecision(3)
+				<< "median of " << measured.medianNS << " ns is "
+				<< ((passed) ? "within" : "over") << " the limit of " << limitNS
+				<< " ns\n    measured: " << measured.summary();
+			return out.str();
+		});
+}
+
+AssertionResult UnitTest::noSlowerThanBaseline (const std::string& key,
+		const Callable<void()>& body, double tolerance)
+{
+	BenchmarkStatistics measured = Runner::measureBenchmark(
+			[&body] (Benchmark&) { body(); }, false);
+	std::string testName = currentContext()->name;
+	std::lock_guard<std::mutex> l(baselinesMutex);
+	if (Runner::machineTag == "")
+		Runner::machineTag = hostName();
+	std::string entry = baselineKey(testName, key, Runner::machineTag);
+	if (Runner::updateBaselines) {
+		Runner::baselines[entry] = measured;
+		return AssertionResult(true, "", "");
 	}
-	else
+	auto pos = Runner::baselines.find(entry);
+	if (pos == Runner::baselines.end()) {
+		std::cout << "# No baseline for " << key << " in " << testName << " on "
+				<< Runner::machineTag << ": run with --update-baselines to record one"
+				<< std::endl;
+		return AssertionResult(true, "", "");
+	}
+	return compareToBaseline(key, measured, pos->second, tolerance);
+}
+
+AssertionResult UnitTest::compareToBaseline (const std::string& key,
+		const BenchmarkStatistics& measured, const BenchmarkStatistics& baseline,
+		double tolerance)
+{
+	return AssertionResult(measured.medianNS <= baseline.medianNS * (1.0 + tolerance),
+		[key, measured, baseline, tolerance] (bool passed) {
+			std::ostringstream out;
+			out << std::fixed << std::setprecision(1)
+				<< key << ": median is "
+				<< 100.0 * (measured.medianNS / baseline.medianNS - 1.0)
+				<< "% slower than the baseline, "
+				<< ((passed) ? "within" : "beyond") << " the tolerance of "
+				<< 100.0 * tolerance << "%"
+				<< "\n    measured: " << measured.summary()
+				<< "\n    baseline: " << baseline.summary();
+			return out.str();
+		});
+}
+
+AssertionResult UnitTest::allocatesAtMost (long maxAllocations,
+		const Callable<void()>& body)
+{
+	if (!allocationCountingEnabled)
+		return AssertionResult(false, "",
+				"heap allocations are not being counted: define UNITTEST_COUNT_ALLOCATIONS"
+				" in one source file, before including unittest.h");
+	AllocationCounts counts (countingAllocations);
 	{
-		runTestUntimed (testNumber, testName, u);
+		const AllocationScope counted (&counts);
+		body();
 	}
+	long long allocations = counts.allocations;
+	long long bytes = counts.bytes;
+	return AssertionResult(allocations <= maxAllocations,
+		[allocations, bytes, maxAllocations] (bool) {
+			return "made " + std::to_string(allocations) + " allocations ("
+				+ std::to_string(bytes) + " bytes) where at most "
+				+ std::to_string(maxAllocations) + " were allowed";
+		});
+}
 
+
+
+
+/**
+ * The call log of the current test.
+ */
+CallLog& UnitTest::callLog()
+{
+	// The test's own threads have adopted its context, so this is
+	// normally found without taking a lock.
+	if (adoptedContext != nullptr)
+		return adoptedContext->callLog;
+	return currentContext()->callLog;
 }
 
-#else
+/**
+ * Clear the call log.
+ */
+void UnitTest::clearCallLog()
+{
+	callLog().clear();
+}
 
-// Run a single unit test function.
-void UnitTest::runTest (unsigned testNumber, std::string testName, TestFunction u, long int timeLimit)
+/**
+ * Position of oldest logged call.
+ */
+UnitTest::iterator UnitTest::begin()
 {
-	runTestUntimed (testNumber, testName, u);
+	return callLog().text().begin();
 }
 
-#endif
+/**
+ * Position just after the most recently logged call.
+ */
+UnitTest::iterator UnitTest::end()
+{
+	return callLog().text().end();
+}
 
 
-// Run all units tests whose name contains testNames[i],
-// 0 <= i <= nTests
-//
-// Special case: If nTests == 0, runs all unit Tests.
-void UnitTest::runTests (int nTests, char** testNames, char* program)
+
+std::string LoggedValue::str() const
 {
-	std::set<std::string> testsToRun;
-	// Check for GTest emulation
-	for (int i = 0; i < nTests; ++i)
-	{
-		std::string arg = testNames[i];
+	ReprBuffer buffer;
+	write(buffer.stream());
+	return buffer.str();
+}
+
+std::string LoggedCall::str() const
+{
+	ReprBuffer buffer;
+	buffer.stream() << function;
+	for (unsigned i = 0; i < numArguments; ++i) {
+		buffer.stream() << '\t';
+		arguments[i]->write(buffer.stream());
 	}
+	return buffer.str();
+}
 
-	std::string badTestSpecifications = "";
+namespace {
 
-		for (int i = 0; i < nTests; ++i)
-		{
-			std::string testID = testNames[i];
-			bool found = false;
-			for (const auto& utest: *tests) {
-				if (utest.first.find(testID) != std::string::npos) {
-					testsToRun.insert(utest.first);
-					found = true;
-				}
-			}
-			if (!found)
-			{
-				for (const auto& utest: *tests) {
-					const std::string& utestName = utest.first;
-					std::string reducedName (1, utestName[0]);
-					for (unsigned j = 1; j < utest.first.size(); ++j)
-					{
-						if (utestName[j] >= 'A' && utestName[j] <= 'Z')
-						{
-							reducedName += utestName[j];
-						}
-					}
-					if (testID == reducedName)
-					{
-						testsToRun.insert(utest.first);
-						found = true;
-					}
-				}
-			}
-			if (!found)
-			{
-				badTestSpecifications += "# Warning: No matching test found for input specification "
-						+ testID + "\n";
-			}
+// The size of the blocks in which the call log's arena grows
+const std::size_t CallLogBlockSize = 64 * 1024;
+const std::size_t CallLogAlignment = alignof(std::max_align_t);
+
+// A call in the form f(a, b)
+std::string callSignature (const LoggedCall& call)
+{
+	std::ostringstream out;
+	out << call.function << '(';
+	for (unsigned i = 0; i < call.numArguments; ++i) {
+		if (i > 0)
+			out << ", ";
+		call.arguments[i]->write(out);
+	}
+	out << ')';
+	return out.str();
+}
+
+// Notes the calls missing from a log that reached its limit.
+std::string droppedCallsNote (const CallLog& log)
+{
+	if (log.droppedCalls() == 0)
+		return "";
+	return " (" + std::to_string(log.droppedCalls())
+		+ " calls were not logged, beyond the limit of "
+		+ std::to_string(log.limit()) + ")";
+}
+
+}
+
+struct CallLog::Mutex {
+	std::mutex m;
+};
+
+CallLog::CallLog ()
+: mutex(new Mutex()), currentBlock(0), used(0), maxCalls(0), dropped(0), clears(0),
+  textClears(0)
+{}
+
+CallLog::~CallLog ()
+{
+	clear();
+}
+
+void CallLog::lock ()
+{
+	mutex->m.lock();
+}
+
+void CallLog::unlock ()
+{
+	mutex->m.unlock();
+}
+
+void CallLog::clear ()
+{
+	const Locked locked(*this);
+	for (auto d = destructors.rbegin(); d != destructors.rend(); ++d)
+		d->first(d->second);
+	destructors.clear();
+	calls.clear();
+	currentBlock = 0;
+	used = 0;
+	dropped = 0;
+	++clears;
+}
+
+void CallLog::setLimit (std::size_t limit)
+{
+	const Locked locked(*this);
+	maxCalls = limit;
+}
+
+const std::vector<std::string>& CallLog::text() const
+{
+	const UncountedAllocations uncounted;
+	if (textClears != clears) {
+		cachedText.clear();
+		textClears = clears;
+	}
+	for (std::size_t i = cachedText.size(); i < calls.size(); ++i)
+		cachedText.push_back(calls[i]->str());
+	return cachedText;
+}
 
+void* CallLog::allocate (std::size_t size)
+{
+	size = (size + CallLogAlignment - 1) / CallLogAlignment * CallLogAlignment;
+	// Reuse the blocks kept from before the last clear, then add more.
+	while (currentBlock < blocks.size() && used + size > blockSizes[currentBlock]) {
+		++currentBlock;
+		used = 0;
 	}
-	if (testsToRun.size() == 0) {
-		for (const auto& utest: *tests) {
-			testsToRun.insert(utest.first);
-		}
+	if (currentBlock == blocks.size()) {
+		const UncountedAllocations uncounted;
+		std::size_t capacity = std::max(size, CallLogBlockSize);
+		blocks.push_back(std::unique_ptr<char[]>(new char[capacity]));
+		blockSizes.push_back(capacity);
+		used = 0;
 	}
+	void* p = blocks[currentBlock].get() + used;
+	used += size;
+	return p;
+}
 
-	// Emit TAP plan line
-	UnitTest::msg ("1.." + std::to_string(testsToRun.size()));
-	UnitTest::msg (badTestSpecifications);
+const char* CallLog::copy (const char* s)
+{
+	std::size_t n = std::strlen(s) + 1;
+	char* p = static_cast<char*>(allocate(n));
+	std::memcpy(p, s, n);
+	return p;
+}
 
-	unsigned testNumber = 1;
-	for (std::string testName: testsToRun) {
-		BoundedTest test = (*tests)[testName];
-		runTest (testNumber, testName, test.unitTest, test.timeLimit);
-		++testNumber;
+LoggedCall* CallLog::startCall (const char* function, bool copyName, unsigned numArguments)
+{
+	if (maxCalls > 0 && calls.size() >= maxCalls) {
+		++dropped;
+		return nullptr;
 	}
+	LoggedCall* call = static_cast<LoggedCall*>(
+		allocate(sizeof(LoggedCall) + numArguments * sizeof(const LoggedValue*)));
+	call->function = (copyName) ? copy(function) : function;
+	call->numArguments = numArguments;
+	call->arguments = reinterpret_cast<const LoggedValue**>(call + 1);
+	return call;
 }
 
-
-/**
- * Clear the call log.
- */
-void UnitTest::clearCallLog()
+std::string CppUnitLite::describeCalls (const CallLog& log, const std::string& function)
 {
-	callLog.clear();
+	static const unsigned DisplayLimit = 10;
+	std::string result;
+	unsigned shown = 0;
+	std::size_t matching = 0;
+	for (const LoggedCall* call: log) {
+		if (function != "" && function != call->function)
+			continue;
+		++matching;
+		if (shown < DisplayLimit) {
+			result += (shown > 0) ? ", " : "";
+			result += callSignature(*call);
+			++shown;
+		}
+	}
+	if (matching == 0)
+		return (function == "") ? "no calls were logged" : function + " was never called";
+	if (matching > shown)
+		result += ", ... (" + std::to_string(matching - shown) + " more)";
+	return ((function == "") ? "the calls were " : "the calls to " + function + " were ")
+		+ result;
 }
 
-/**
- * Position of oldest logged call.
- */
-UnitTest::iterator UnitTest::begin()
+AssertionResult CalledTimesMatcher::eval (const CallLog& log) const
 {
-	return callLog.begin();
+	std::size_t count = 0;
+	for (const LoggedCall* call: log)
+		if (expected.matches(*call))
+			++count;
+	return AssertionResult(count == times,
+			[this, &log, count] (bool passed) {
+				std::string counted = expected.str() + " was called "
+						+ std::to_string(count) + " times";
+				if (passed)
+					return counted;
+				return "Expected " + std::to_string(times) + " calls, but " + counted
+						+ ": " + describeCalls(log, expected.functionName())
+						+ droppedCallsNote(log);
+			});
 }
 
-/**
- * Position just after the most recently logged call.
- */
-UnitTest::iterator UnitTest::end()
+AssertionResult CalledWithMatcher::eval (const CallLog& log) const
 {
-	return callLog.end();
+	long position = -1L;
+	long i = 0L;
+	for (const LoggedCall* call: log) {
+		if (expected.matches(*call)) {
+			position = i;
+			break;
+		}
+		++i;
+	}
+	return AssertionResult(position >= 0L,
+			[this, &log, position] (bool passed) {
+				if (passed)
+					return "Found " + expected.str() + " in position "
+							+ std::to_string(position) + " of the call log";
+				return "Could not find " + expected.str() + " in the call log: "
+						+ describeCalls(log, expected.functionName())
+						+ droppedCallsNote(log);
+			});
 }
 
+AssertionResult CallSequenceMatcher::eval (const CallLog& log) const
+{
+	// Match each expected call to the earliest possible logged one.
+	std::size_t found = 0;
+	std::size_t position = 0; // of the log entry after the last match
+	for (CallLog::const_iterator call = log.begin();
+			call != log.end() && found < sequence.size(); ++call) {
+		if (sequence[found].matches(**call)) {
+			++found;
+			position = (call - log.begin()) + 1;
+		}
+	}
+	return AssertionResult(found == sequence.size(),
+			[this, &log, found, position] (bool passed) {
+				if (passed)
+					return "All " + std::to_string(sequence.size())
+							+ " calls were found in sequence";
+				std::string where = (found == 0) ? std::string("")
+						: " after position " + std::to_string(position - 1);
+				return "Found the first " + std::to_string(found) + " of "
+						+ std::to_string(sequence.size()) + " calls in sequence, but not "
+						+ sequence[found].str() + where + ": "
+						+ describeCalls(log, "") + droppedCallsNote(log);
+			});
+}
 
 
-/**
- * Log a call to a zero-parameter function.
- *
- * @param functionName name of the function
- */
-void UnitTest::logCall (const std::string& functionName)
+std::string UnitTest::msgPassed (unsigned testNumber, std::string testName, const TestTiming& timing)
 {
-	callLog.push_back (functionName);
+	return "ok " + std::to_string(testNumber) + " - " + testName + msgTiming(timing);
 }
 
-
-void UnitTest::msgPassed (unsigned testNumber, std::string testName, unsigned timeMS)
+std::string UnitTest::msgSkipped (unsigned testNumber, std::string testName)
 {
-	using namespace std;
-	cout << flush;
-	cout << "ok " << testNumber << " - " << testName << endl;
+	if (testsAbandoned)
+		return "ok " + std::to_string(testNumber) + " - " + testName
+				+ " # SKIP stopped at a test left running past its time limit";
+	return "ok " + std::to_string(testNumber) + " - " + testName + " # SKIP stopped after "
+			+ std::to_string(Runner::numFailures + Runner::numErrors) + " failures (--fail-fast)";
 }
 
-void UnitTest::msgXPassed (unsigned testNumber, std::string testName, unsigned timeMS)
+std::string UnitTest::msgXPassed (unsigned testNumber, std::string testName, const TestTiming& timing)
 {
-	UnitTest::msg(
-			UnitTest::msgFailed(testNumber, testName,
+	return UnitTest::msgFailed(testNumber, testName,
 					std::string("Test ") + std::to_string(testNumber) + " - " + testName
-					+ " passed but was expected to fail.", timeMS)
-	);
+					+ " passed but was expected to fail.", timing);
+}
+
+// TAP v13 YAML block giving a test's timing, to follow its result line.
+std::string UnitTest::msgTiming (const TestTiming& timing)
+{
+	if (timing.wallMS < 0.0)
+		return "";
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3)
+		<< "\n  ---\n  duration_ms: " << timing.wallMS;
+	if (timing.cpuMS >= 0.0)
+		out << "\n  cpu_ms: " << timing.cpuMS;
+	if (timing.counters.measured()) {
+		out << "\n  counters:";
+		writeCounters(out, timing.counters, "    ");
+	}
+	std::istringstream details (timing.details);
+	std::string line;
+	while (std::getline(details, line))
+		out << "\n  " << line;
+	out << "\n  ...";
+	return out.str();
 }
 
 
-std::string UnitTest::extractLocation (const std::string& msg)
+std::string UnitTest::Runner::extractLocation (const std::string& msg)
 {
 	using namespace std;
 
@@ -587,17 +5071,18 @@ std::string UnitTest::extractLocation (const std::string& msg)
 
 
 std::string UnitTest::msgFailed (unsigned testNumber, std::string testName,
-		std::string diagnostics, unsigned timeMS)
+		std::string diagnostics, const TestTiming& timing)
 {
 	using namespace std;
 
-	string location = extractLocation(diagnostics);
+	string location = Runner::extractLocation(diagnostics);
 	if (location.size() > 0)
 		location += ": error: Failed test\n";
 	string diagnosticString = location + msgComment(diagnostics);
 
 
-	string resultMsg = "not ok " + to_string(testNumber) + " - " + testName;
+	string resultMsg = "not ok " + to_string(testNumber) + " - " + testName
+			+ msgTiming(timing);
 
 	if (diagnosticMessagesBeforeResults)
 		return diagnosticString + ": \n" + resultMsg;
@@ -605,69 +5090,135 @@ std::string UnitTest::msgFailed (unsigned testNumber, std::string testName,
 		return resultMsg + "\n" + diagnosticString;
 }
 
+namespace {
+
+/**
+ * Append text to out in one pass, starting each of its lines (including
+ * the empty one after a final newline) with prefix, unless the line
+ * already starts with it. Shared by the reporters, for TAP comments and
+ * for XML text.
+ *
+ * @param xml true to escape the characters special to XML, and replace
+ *        those that XML 1.0 cannot hold at all
+ */
+void appendLines (std::string& out, const std::string& text,
+		const std::string& prefix, bool xml = false)
+{
+	out.reserve(out.size() + text.size() + prefix.size());
+	std::string::size_type lineStart = 0;
+	for (;;) {
+		if (text.compare(lineStart, prefix.size(), prefix) != 0)
+			out += prefix;
+		std::string::size_type lineEnd = text.find('\n', lineStart);
+		std::string::size_type stop = (lineEnd != std::string::npos) ? lineEnd + 1 : text.size();
+		if (!xml)
+			out.append(text, lineStart, stop - lineStart);
+		else
+			for (std::string::size_type i = lineStart; i < stop; ++i) {
+				char c = text[i];
+				switch (c) {
+				case '&': out += "&amp;"; break;
+				case '<': out += "&lt;"; break;
+				case '>': out += "&gt;"; break;
+				case '"': out += "&quot;"; break;
+				case '\'': out += "&apos;"; break;
+				default:
+					out += ((unsigned char)c < 0x20 && c != '\t' && c != '\n' && c != '\r')
+							? '?' : c;
+				}
+			}
+		if (lineEnd == std::string::npos)
+			return;
+		lineStart = lineEnd + 1;
+	}
+}
+
+}
+
 std::string UnitTest::msgComment (const std::string& commentary) {
 	const static std::string commentPrefix = "# ";
 	std::string result;
-	std::string startOfLine = commentary.substr(0, commentPrefix.size());
-	if (startOfLine == commentPrefix)
-		result = commentary;
-	else
-		result = commentPrefix + commentary;
-	std::string::size_type pos = result.find('\n');
-	while (pos != std::string::npos)
-	{
-		if (result.size() >= pos+1+commentPrefix.size())
-		{
-			startOfLine = result.substr(pos+1, commentPrefix.size());
-			if (startOfLine != commentPrefix)
-			{
-				result.insert(pos+1, commentPrefix);
-			}
-		}
-		else
-		{
-			result.insert(pos+1, commentPrefix);
-		}
-		pos = result.find('\n', pos+1);
-	}
+	appendLines(result, commentary, commentPrefix);
 	return result;
 }
 
 
-void UnitTest::msgXFailed (unsigned testNumber, std::string testName, std::string diagnostics, unsigned timeMS)
+std::string UnitTest::msgXFailed (unsigned testNumber, std::string testName, std::string diagnostics, const TestTiming& timing)
 {
 	std::string diagnosticMsg = msgComment(std::string("Test ") + std::to_string(testNumber) + " failed but was expected to fail.");
+	std::string resultMsg = UnitTest::msgPassed(testNumber, testName, timing);
 	if (diagnosticMessagesBeforeResults)
-		UnitTest::msg(diagnosticMsg);
-	UnitTest::msgPassed(testNumber, testName, timeMS);
-	if (!diagnosticMessagesBeforeResults)
-		UnitTest::msg(diagnosticMsg);
+		return diagnosticMsg + "\n" + resultMsg;
+	else
+		return resultMsg + "\n" + diagnosticMsg;
 }
 
-void UnitTest::msgError (unsigned testNumber, std::string testName, std::string diagnostics, unsigned timeMS)
+std::string UnitTest::msgError (unsigned testNumber, std::string testName, std::string diagnostics, const TestTiming& timing)
 {
 	std::string diagnosticMsg = msgComment("ERROR - " + diagnostics);
+	std::string resultMsg = "not ok " + std::to_string(testNumber) + " - " + testName
+			+ msgTiming(timing);
 	if (diagnosticMessagesBeforeResults)
-		UnitTest::msg(diagnosticMsg);
-	UnitTest::msg("not ok " + std::to_string(testNumber) + " - " + testName);
-	if (!diagnosticMessagesBeforeResults)
-		UnitTest::msg(diagnosticMsg);
+		return diagnosticMsg + "\n" + resultMsg;
+	else
+		return resultMsg + "\n" + diagnosticMsg;
 }
 
-void UnitTest::msgSummary ()
+std::string UnitTest::msgSummary ()
 {
 	using namespace std;
-	cout << "# UnitTest: passed " << numSuccesses << " out of "
+	ostringstream out;
+	out << "# UnitTest: passed " << Runner::numSuccesses << " out of "
 		 << getNumTests() << " tests, for a success rate of "
 		 << std::showpoint << std::fixed << std::setprecision(1)
-		 << (100.0 * numSuccesses)/(float)getNumTests()
+		 << (100.0 * Runner::numSuccesses)/(float)getNumTests()
 		 << "%" << endl;
+	if (Runner::numSkipped > 0 && testsAbandoned)
+		out << "# UnitTest: skipped " << Runner::numSkipped
+			 << " tests after one was left running past its time limit" << endl;
+	else if (Runner::numSkipped > 0)
+		out << "# UnitTest: skipped " << Runner::numSkipped << " tests after "
+			 << Runner::numFailures + Runner::numErrors << " failures (--fail-fast)" << endl;
+	if (counterTotals.measured()) {
+		out << "# Hardware counters:";
+		std::ostringstream counts;
+		writeCounters(counts, counterTotals, "#   ");
+		out << counts.str() << endl;
+	}
+	return out.str();
 }
 
 
 
 
 
+std::string UnitTest::msgSlowest ()
+{
+	using namespace std;
+	vector<pair<double, string>> slowest;
+	for (const auto& entry: Runner::testTimings)
+		slowest.emplace_back(entry.second.wallMS, entry.first);
+	unsigned n = min((unsigned)slowest.size(), Runner::numSlowestReported);
+	if (n == 0)
+		return "";
+	ostringstream out;
+	partial_sort(slowest.begin(), slowest.begin() + n, slowest.end(),
+			[] (const pair<double, string>& a, const pair<double, string>& b) {
+				return a.first > b.first || (a.first == b.first && a.second < b.second);
+			});
+	out << "# Slowest tests:\n";
+	for (unsigned i = 0; i < n; ++i) {
+		const TestTiming& timing = Runner::testTimings[slowest[i].second];
+		out << "#   " << fixed << setprecision(3) << setw(10) << timing.wallMS
+			<< " ms";
+		if (timing.cpuMS >= 0.0)
+			out << " (" << timing.cpuMS << " ms CPU)";
+		out << "  " << slowest[i].second << "\n";
+	}
+	return out.str();
+}
+
+
 void UnitTest::msg (const std::string& detailMessage)
 {
 	using std::cout;
@@ -676,26 +5227,592 @@ void UnitTest::msg (const std::string& detailMessage)
 	if (detailMessage.size() > 0 &&
 			detailMessage[detailMessage.size()-1] != '\n')
 		cout << "\n";
-	cout << std::flush;
+	if (outputSink != nullptr)
+		outputSink->flushIfStale();
+	else
+		cout << std::flush;
+}
+
+TapReporter::TapReporter ()
+{
+}
+
+TapReporter::TapReporter (const std::string& path)
+	: file(std::make_shared<std::ofstream>(path))
+{
+	if (static_cast<std::ofstream&>(*file).is_open() == false)
+		std::cerr << "# Warning: Cannot write TAP results to " << path << std::endl;
+}
+
+void TapReporter::start (unsigned numTests)
+{
+	write ("TAP version 13");
+	write ("1.." + std::to_string(numTests));
+}
+
+void TapReporter::result (const TestReport& report)
+{
+	write (report.transcript);
+}
+
+void TapReporter::diagnostic (const std::string& text)
+{
+	write (text);
+}
+
+void TapReporter::summary (const RunSummary&)
+{
+	write (UnitTest::msgSummary());
+	write (UnitTest::msgSlowest());
+}
+
+// Write text as one or more whole lines.
+void TapReporter::write (const std::string& text)
+{
+	if (file == nullptr) {
+		UnitTest::msg(text);
+		return;
+	}
+	if (text.empty())
+		return;
+	*file << text;
+	if (text.back() != '\n')
+		*file << '\n';
+}
+
+
+namespace {
+
+// Split a test's TAP transcript into the first line of its diagnostics
+// and the rest, leaving out its result line, its YAML block and the "# "
+// of its comments.
+void splitTranscript (const std::string& transcript, std::string& message,
+		std::string& details)
+{
+	std::istringstream lines (transcript);
+	std::string line;
+	bool inYAML = false;
+	while (std::getline(lines, line)) {
+		if (inYAML) {
+			inYAML = (line != "  ...");
+			continue;
+		}
+		if (line == "  ---") {
+			inYAML = true;
+			continue;
+		}
+		if (line.compare(0, 3, "ok ") == 0 || line.compare(0, 7, "not ok ") == 0
+				|| line == "# : ")
+			continue;
+		if (line.compare(0, 2, "# ") == 0)
+			line.erase(0, 2);
+		if (message.empty())
+			message = line;
+		details += line;
+		details += '\n';
+	}
+}
+
+std::string xmlEscaped (const std::string& text)
+{
+	std::string result;
+	appendLines(result, text, "", true);
+	return result;
+}
+
+// Seconds, as JUnit XML gives times.
+std::string seconds (double milliseconds)
+{
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3) << std::max(0.0, milliseconds) / 1000.0;
+	return out.str();
+}
+
+}
+
+JUnitReporter::JUnitReporter (const std::string& reportPath, const std::string& suite)
+	: path(reportPath), suiteName(xmlEscaped(suite))
+{
+}
+
+void JUnitReporter::result (const TestReport& report)
+{
+	std::string message;
+	std::string details;
+	if (report.outcome == TestReport::Skipped) {
+		std::string::size_type skip = report.transcript.find("# SKIP ");
+		if (skip != std::string::npos)
+			message = report.transcript.substr(skip + 7,
+					report.transcript.find('\n', skip) - skip - 7);
+	} else {
+		splitTranscript(report.transcript, message, details);
+	}
+
+	testCases += "    <testcase name=\"";
+	appendLines(testCases, report.name, "", true);
+	testCases += "\" classname=\"" + suiteName + "\" time=\""
+			+ seconds(report.timing.wallMS) + "\"";
+	if (report.outcome == TestReport::Passed && details.empty()) {
+		testCases += "/>\n";
+		return;
+	}
+	testCases += ">\n";
+	if (report.outcome == TestReport::Passed) {
+		testCases += "      <system-out>";
+		appendLines(testCases, details, "", true);
+		testCases += "</system-out>\n";
+	} else if (report.outcome == TestReport::Skipped) {
+		testCases += "      <skipped message=\"" + xmlEscaped(message) + "\"/>\n";
+	} else {
+		const char* element = (report.outcome == TestReport::Error) ? "error" : "failure";
+		testCases += std::string("      <") + element + " message=\"";
+		appendLines(testCases, message, "", true);
+		testCases += "\">";
+		appendLines(testCases, details, "", true);
+		testCases += std::string("</") + element + ">\n";
+	}
+	testCases += "    </testcase>\n";
 }
 
+void JUnitReporter::diagnostic (const std::string& text)
+{
+	appendLines(systemOut, text, "", true);
+}
+
+void JUnitReporter::summary (const RunSummary& totals)
+{
+	std::ostringstream counts;
+	counts << "tests=\"" << totals.passed + totals.failed + totals.errors + totals.skipped
+		<< "\" failures=\"" << totals.failed << "\" errors=\"" << totals.errors
+		<< "\" skipped=\"" << totals.skipped << "\" time=\"" << seconds(totals.wallMS) << "\"";
+	std::ofstream out (path);
+	out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		<< "<testsuites name=\"" << suiteName << "\" " << counts.str() << ">\n"
+		<< "  <testsuite name=\"" << suiteName << "\" " << counts.str() << ">\n"
+		<< testCases;
+	if (!systemOut.empty())
+		out << "    <system-out>" << systemOut << "</system-out>\n";
+	out << "  </testsuite>\n"
+		<< "</testsuites>\n";
+	if (!out.good())
+		std::cerr << "# Warning: Cannot write JUnit results to " << path << std::endl;
+}
+
+
+namespace {
+
+bool writeAll (int fd, const char* data, std::size_t n)
+{
+	while (n > 0) {
+		ssize_t written = ::write(fd, data, n);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		data += written;
+		n -= written;
+	}
+	return true;
+}
+
+}
+
+BinaryReporter::BinaryReporter (int outputFD)
+	: fd(outputFD), owned(false)
+{
+}
+
+BinaryReporter::BinaryReporter (const std::string& path)
+	: fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)), owned(true)
+{
+	if (fd < 0)
+		std::cerr << "# Warning: Cannot write binary results to " << path << std::endl;
+}
+
+BinaryReporter::~BinaryReporter()
+{
+	if (owned && fd >= 0)
+		::close(fd);
+}
+
+bool BinaryReporter::record (Kind kind, unsigned testNumber, int testResult,
+		const std::string& text, const UnitTest::TestTiming& timing)
+{
+	if (fd < 0)
+		return false;
+	Record header = {(std::uint32_t)kind, (std::uint32_t)testNumber,
+			(std::int32_t)testResult, (std::uint32_t)text.size(),
+			timing.wallMS, timing.cpuMS,
+			{timing.counters.cycles, timing.counters.instructions,
+			 timing.counters.cacheMisses, timing.counters.branchMisses}};
+	return writeAll(fd, (const char*)&header, sizeof(header))
+			&& writeAll(fd, text.data(), text.size());
+}
+
+void BinaryReporter::start (unsigned numTests)
+{
+	record(RunStarted, numTests, 0, "");
+}
+
+void BinaryReporter::result (const TestReport& report)
+{
+	record(TestFinished, report.testNumber, report.outcome, report.transcript, report.timing);
+}
+
+void BinaryReporter::diagnostic (const std::string& text)
+{
+	if (!text.empty())
+		record(Diagnostic, 0, 0, text);
+}
+
+void BinaryReporter::summary (const RunSummary& totals)
+{
+	record(RunFinished, totals.passed + totals.failed + totals.errors + totals.skipped, 0,
+			std::to_string(totals.passed) + ' ' + std::to_string(totals.failed) + ' '
+			+ std::to_string(totals.errors) + ' ' + std::to_string(totals.skipped),
+			UnitTest::TestTiming(totals.wallMS));
+}
+
+
+std::string ElementTolerance::description() const
+{
+	std::ostringstream out;
+	if (ulps >= 0LL)
+		out << "to within " << ulps << " ULPs";
+	else if (exact())
+		out << "exactly";
+	else
+	{
+		out << "to within ";
+		if (absolute != 0.0)
+			out << absolute;
+		if (absolute != 0.0 && relative != 0.0)
+			out << " or ";
+		if (relative != 0.0)
+			out << relative << " relative";
+	}
+	return out.str();
+}
+
+void ElementComparison::recordMismatch (std::size_t pos, double error)
+{
+	// A NaN is the worst possible mismatch.
+	if (mismatches == 0 || error > maxError
+			|| (std::isnan(error) && !std::isnan(maxError)))
+	{
+		worstMismatch = pos;
+		maxError = error;
+	}
+	if (mismatches == 0)
+		firstMismatch = pos;
+	++mismatches;
+}
+
+namespace {
+
+// Maps the bits of a floating point value onto integers in the same
+// order as the values, so that adjacent values differ by 1.
+template <typename Int, typename Float>
+Int orderedBits (Float x)
+{
+	Int bits;
+	std::memcpy(&bits, &x, sizeof(bits));
+	return (bits < 0) ? std::numeric_limits<Int>::min() - bits : bits;
+}
+
+template <typename Int, typename Float>
+bool elementMatchesIn (Float actual, Float expected,
+		const ElementTolerance& tolerance, double& error)
+{
+	if (tolerance.ulps >= 0LL)
+	{
+		if (std::isnan(actual) || std::isnan(expected))
+		{
+			error = std::numeric_limits<double>::quiet_NaN();
+			return false;
+		}
+		Int a = orderedBits<Int>(actual);
+		Int e = orderedBits<Int>(expected);
+		// Unsigned, since the difference may not fit in Int
+		typedef typename std::make_unsigned<Int>::type UInt;
+		UInt distance = (a < e) ? (UInt)e - (UInt)a : (UInt)a - (UInt)e;
+		error = (double)distance;
+		return distance <= (unsigned long long)tolerance.ulps;
+	}
+	// In Float arithmetic, to agree with the vectorized kernels
+	Float diff = std::fabs(actual - expected);
+	error = (double)diff;
+	if (actual == expected)
+		return true;
+	Float scale = std::max(std::fabs(actual), std::fabs(expected));
+	return diff <= std::max((Float)tolerance.absolute,
+			(Float)tolerance.relative * scale);
+}
+
+// The vectorized kernels count the elements that neither are equal nor are
+// within max(absolute, relative * max(|a|, |e|)) of one another, in a
+// prefix of the arrays that is a multiple of their width, and return the
+// length of that prefix.
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#define CPPUNITLITE_AVX_DISPATCH
+#endif
 
+#ifdef CPPUNITLITE_AVX_DISPATCH
 
+// Compiled for AVX whatever the compiler options, but only called
+// if the processor supports it.
+__attribute__((target("avx")))
+std::size_t countMismatchesAVX (const double* a, const double* e, std::size_t n,
+		double absolute, double relative, std::size_t& mismatches)
+{
+	const __m256d signBit = _mm256_set1_pd(-0.0);
+	const __m256d absTol = _mm256_set1_pd(absolute);
+	const __m256d relTol = _mm256_set1_pd(relative);
+	std::size_t count = 0;
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m256d va = _mm256_loadu_pd(a + i);
+		__m256d ve = _mm256_loadu_pd(e + i);
+		__m256d diff = _mm256_andnot_pd(signBit, _mm256_sub_pd(va, ve));
+		__m256d scale = _mm256_max_pd(_mm256_andnot_pd(signBit, va),
+				_mm256_andnot_pd(signBit, ve));
+		__m256d tol = _mm256_max_pd(absTol, _mm256_mul_pd(relTol, scale));
+		__m256d ok = _mm256_or_pd(_mm256_cmp_pd(va, ve, _CMP_EQ_OQ),
+				_mm256_cmp_pd(diff, tol, _CMP_LE_OQ));
+		count += 4 - __builtin_popcount(_mm256_movemask_pd(ok));
+	}
+	mismatches += count;
+	return i;
+}
+
+__attribute__((target("avx")))
+std::size_t countMismatchesAVX (const float* a, const float* e, std::size_t n,
+		double absolute, double relative, std::size_t& mismatches)
+{
+	const __m256 signBit = _mm256_set1_ps(-0.0f);
+	const __m256 absTol = _mm256_set1_ps((float)absolute);
+	const __m256 relTol = _mm256_set1_ps((float)relative);
+	std::size_t count = 0;
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 va = _mm256_loadu_ps(a + i);
+		__m256 ve = _mm256_loadu_ps(e + i);
+		__m256 diff = _mm256_andnot_ps(signBit, _mm256_sub_ps(va, ve));
+		__m256 scale = _mm256_max_ps(_mm256_andnot_ps(signBit, va),
+				_mm256_andnot_ps(signBit, ve));
+		__m256 tol = _mm256_max_ps(absTol, _mm256_mul_ps(relTol, scale));
+		__m256 ok = _mm256_or_ps(_mm256_cmp_ps(va, ve, _CMP_EQ_OQ),
+				_mm256_cmp_ps(diff, tol, _CMP_LE_OQ));
+		count += 8 - __builtin_popcount(_mm256_movemask_ps(ok));
+	}
+	mismatches += count;
+	return i;
+}
+
+bool haveAVX ()
+{
+	static const bool supported = __builtin_cpu_supports("avx");
+	return supported;
+}
+
+#endif
+
+#if defined(__SSE2__)
+
+std::size_t countMismatchesSIMD (const double* a, const double* e, std::size_t n,
+		double absolute, double relative, std::size_t& mismatches)
+{
+#ifdef CPPUNITLITE_AVX_DISPATCH
+	if (haveAVX())
+		return countMismatchesAVX(a, e, n, absolute, relative, mismatches);
+#endif
+	const __m128d signBit = _mm_set1_pd(-0.0);
+	const __m128d absTol = _mm_set1_pd(absolute);
+	const __m128d relTol = _mm_set1_pd(relative);
+	std::size_t count = 0;
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		__m128d va = _mm_loadu_pd(a + i);
+		__m128d ve = _mm_loadu_pd(e + i);
+		__m128d diff = _mm_andnot_pd(signBit, _mm_sub_pd(va, ve));
+		__m128d scale = _mm_max_pd(_mm_andnot_pd(signBit, va),
+				_mm_andnot_pd(signBit, ve));
+		__m128d tol = _mm_max_pd(absTol, _mm_mul_pd(relTol, scale));
+		__m128d ok = _mm_or_pd(_mm_cmpeq_pd(va, ve), _mm_cmple_pd(diff, tol));
+		count += 2 - __builtin_popcount(_mm_movemask_pd(ok));
+	}
+	mismatches += count;
+	return i;
+}
+
+std::size_t countMismatchesSIMD (const float* a, const float* e, std::size_t n,
+		double absolute, double relative, std::size_t& mismatches)
+{
+#ifdef CPPUNITLITE_AVX_DISPATCH
+	if (haveAVX())
+		return countMismatchesAVX(a, e, n, absolute, relative, mismatches);
+#endif
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	const __m128 absTol = _mm_set1_ps((float)absolute);
+	const __m128 relTol = _mm_set1_ps((float)relative);
+	std::size_t count = 0;
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128 va = _mm_loadu_ps(a + i);
+		__m128 ve = _mm_loadu_ps(e + i);
+		__m128 diff = _mm_andnot_ps(signBit, _mm_sub_ps(va, ve));
+		__m128 scale = _mm_max_ps(_mm_andnot_ps(signBit, va),
+				_mm_andnot_ps(signBit, ve));
+		__m128 tol = _mm_max_ps(absTol, _mm_mul_ps(relTol, scale));
+		__m128 ok = _mm_or_ps(_mm_cmpeq_ps(va, ve), _mm_cmple_ps(diff, tol));
+		count += 4 - __builtin_popcount(_mm_movemask_ps(ok));
+	}
+	mismatches += count;
+	return i;
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+std::size_t countMismatchesSIMD (const double* a, const double* e, std::size_t n,
+		double absolute, double relative, std::size_t& mismatches)
+{
+	const float64x2_t absTol = vdupq_n_f64(absolute);
+	const float64x2_t relTol = vdupq_n_f64(relative);
+	std::size_t count = 0;
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		float64x2_t va = vld1q_f64(a + i);
+		float64x2_t ve = vld1q_f64(e + i);
+		float64x2_t diff = vabdq_f64(va, ve);
+		float64x2_t scale = vmaxq_f64(vabsq_f64(va), vabsq_f64(ve));
+		float64x2_t tol = vmaxq_f64(absTol, vmulq_f64(relTol, scale));
+		uint64x2_t ok = vorrq_u64(vceqq_f64(va, ve), vcleq_f64(diff, tol));
+		count += 2 - vaddvq_u64(vshrq_n_u64(ok, 63));
+	}
+	mismatches += count;
+	return i;
+}
+
+std::size_t countMismatchesSIMD (const float* a, const float* e, std::size_t n,
+		double absolute, double relative, std::size_t& mismatches)
+{
+	const float32x4_t absTol = vdupq_n_f32((float)absolute);
+	const float32x4_t relTol = vdupq_n_f32((float)relative);
+	std::size_t count = 0;
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		float32x4_t va = vld1q_f32(a + i);
+		float32x4_t ve = vld1q_f32(e + i);
+		float32x4_t diff = vabdq_f32(va, ve);
+		float32x4_t scale = vmaxq_f32(vabsq_f32(va), vabsq_f32(ve));
+		float32x4_t tol = vmaxq_f32(absTol, vmulq_f32(relTol, scale));
+		uint32x4_t ok = vorrq_u32(vceqq_f32(va, ve), vcleq_f32(diff, tol));
+		count += 4 - vaddvq_u32(vshrq_n_u32(ok, 31));
+	}
+	mismatches += count;
+	return i;
+}
+
+#else
+
+template <typename Float>
+std::size_t countMismatchesSIMD (const Float*, const Float*, std::size_t,
+		double, double, std::size_t&)
+{
+	return 0;
+}
+
+#endif
+
+template <typename Int, typename Float>
+ElementComparison compareElementsIn (const Float* actual, const Float* expected,
+		std::size_t n, const ElementTolerance& tolerance)
+{
+	ElementComparison summary(n);
+	double error;
+	std::size_t mismatches = 0;
+	std::size_t done = 0;
+	if (tolerance.ulps < 0LL)
+		done = countMismatchesSIMD(actual, expected, n,
+				tolerance.absolute, tolerance.relative, mismatches);
+	for (std::size_t i = done; i < n; ++i)
+		if (!elementMatchesIn<Int>(actual[i], expected[i], tolerance, error))
+			++mismatches;
+	if (mismatches > 0)
+	{
+		// Rare, so find the details of the mismatches one at a time.
+		for (std::size_t i = 0; i < n; ++i)
+			if (!elementMatchesIn<Int>(actual[i], expected[i], tolerance, error))
+				summary.recordMismatch(i, error);
+	}
+	return summary;
+}
+
+}
+
+bool CppUnitLite::elementMatches (double actual, double expected,
+		const ElementTolerance& tolerance, double& error)
+{
+	return elementMatchesIn<std::int64_t>(actual, expected, tolerance, error);
+}
 
+bool CppUnitLite::elementMatches (float actual, float expected,
+		const ElementTolerance& tolerance, double& error)
+{
+	return elementMatchesIn<std::int32_t>(actual, expected, tolerance, error);
+}
+
+ElementComparison CppUnitLite::compareElements (const double* actual,
+		const double* expected, std::size_t n, const ElementTolerance& tolerance)
+{
+	return compareElementsIn<std::int64_t>(actual, expected, n, tolerance);
+}
 
+ElementComparison CppUnitLite::compareElements (const float* actual,
+		const float* expected, std::size_t n, const ElementTolerance& tolerance)
+{
+	return compareElementsIn<std::int32_t>(actual, expected, n, tolerance);
+}
 
 
+namespace CppUnitLite {
 
+// Declared extern in unittestMatchers.h, so that each test source need
+// not instantiate its own copies of the commonest comparisons.
+template std::string getStringRepr (const int&);
+template std::string getStringRepr (const long&);
+template std::string getStringRepr (const double&);
+template std::string getStringRepr (const std::string&);
 
+template class EqualToMatcher<int>;
+template class EqualToMatcher<long>;
+template class EqualToMatcher<double>;
+template class EqualToMatcher<std::string>;
+template class NotEqualToMatcher<int>;
+template class NotEqualToMatcher<long>;
+template class NotEqualToMatcher<double>;
+template class NotEqualToMatcher<std::string>;
 
+}
 
 StringContainsMatcher::StringContainsMatcher (const std::string& t): right(t) {}
 AssertionResult StringContainsMatcher::eval(const std::string& e) const {
-	auto result = e.find(right);
-	return AssertionResult( result != std::string::npos,
-			"Found " + getStringRepr(right) + " starting in position "
-				+ getStringRepr(result) + " of " + getStringRepr(e),
-			"Within " + getStringRepr(e) + ", cannot find " + getStringRepr(right));
+	return AssertionResult( e.find(right) != std::string::npos,
+			[this, &e] (bool passed) {
+				if (passed)
+					return "Found " + getStringRepr(right) + " starting in position "
+						+ getStringRepr(e.find(right)) + " of " + getStringRepr(e);
+				else
+					return "Within " + getStringRepr(e) + ", cannot find " + getStringRepr(right);
+			});
 }
 
 CppUnitLite::StringContainsMatcher
@@ -712,15 +5829,16 @@ contains(const std::string& t)
 
 StringEndsWithMatcher::StringEndsWithMatcher (const std::string& t): right(t) {}
 AssertionResult StringEndsWithMatcher::eval(const std::string& e) const {
-	std::string eStr = getStringRepr(e);
-	std::string rightStr = getStringRepr(right);
 	bool result = (right.size() <= e.size())
 			&& equal(right.begin(), right.end(),
 				e.begin() + e.size() - right.size());
 
 	return AssertionResult(result,
-			eStr + " ends with " + rightStr,
-			eStr + " does not end with " + rightStr);
+			[this, &e] (bool passed) {
+				return getStringRepr(e)
+					+ ((passed) ? " ends with " : " does not end with ")
+					+ getStringRepr(right);
+			});
 }
 
 StringEndsWithMatcher
@@ -740,14 +5858,14 @@ StringBeginsWithMatcher::StringBeginsWithMatcher (const std::string& t)
 
 AssertionResult StringBeginsWithMatcher::eval(const std::string& e) const
 {
-	std::string eStr = getStringRepr(e);
-	std::string rightStr = getStringRepr(right);
 	bool result = (right.size() <= e.size())
 			&& equal(right.begin(), right.end(), e.begin());
 	return AssertionResult(result,
-			eStr + " begins with " + rightStr,
-			eStr + " does not begin with " + rightStr
-			);
+			[this, &e] (bool passed) {
+				return getStringRepr(e)
+					+ ((passed) ? " begins with " : " does not begin with ")
+					+ getStringRepr(right);
+			});
 }
 
 StringBeginsWithMatcher beginsWith(const char* t)
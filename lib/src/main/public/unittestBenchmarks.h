@@ -0,0 +1,253 @@
+#ifndef UNITTEST_BENCHMARKS_H
+#define UNITTEST_BENCHMARKS_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "unittestCore.h"
+
+
+/**
+ * Timing assertions, measured as benchmarks are:
+ *
+ *   assertCompletesWithin(duration, body) fails if the median time of
+ *     a call of body is longer than a std::chrono::duration.
+ *   assertNoSlowerThanBaseline(key, body [, tolerance]) fails if that
+ *     median is slower, by more than the fraction tolerance (default
+ *     0.1), than the median recorded for key, this test and this
+ *     machine in the baselines file.
+ *
+ * Each takes a few tenths of a second, so tests using them will need
+ * a longer time limit than the default.
+ */
+#define assertCompletesWithin(...) CppUnitLite::UnitTest::checkTest \
+	(CppUnitLite::completesWithin(__VA_ARGS__), \
+	"assertCompletesWithin(" #__VA_ARGS__ ")", __FILE__, __LINE__)
+
+#define assertNoSlowerThanBaseline(...) CppUnitLite::UnitTest::checkTest \
+	(CppUnitLite::UnitTest::noSlowerThanBaseline(__VA_ARGS__), \
+	"assertNoSlowerThanBaseline(" #__VA_ARGS__ ")", __FILE__, __LINE__)
+
+/**
+ * Time limit, in milliseconds, for each UnitBenchmark(...), which runs
+ * its body many times over.
+ */
+#define DEFAULT_UNIT_BENCHMARK_TIME_LIMIT 10000L
+
+/**
+ * Registration of a micro-benchmark. The body is given a Benchmark
+ * named `benchmark`, and the loop `while (benchmark.keepRunning())` is
+ * timed. A body without that loop is timed as a whole.
+ *
+ * Benchmarks are only run when selected by name, by --filter, or
+ * by --benchmarks.
+ */
+#define UnitBenchmark(functName) UnitBenchmarkTimed(functName, DEFAULT_UNIT_BENCHMARK_TIME_LIMIT)
+
+// A body timed as a whole need not use its Benchmark.
+#if defined(__GNUC__)
+#define UNITTEST_BENCHMARK_PARAMETER benchmark __attribute__((unused))
+#else
+#define UNITTEST_BENCHMARK_PARAMETER benchmark
+#endif
+
+#define UnitBenchmarkTimed(functName, limit) \
+		void functName(CppUnitLite::Benchmark&); \
+		void functName ## Benchmark() { CppUnitLite::UnitTest::runBenchmark(&functName); } \
+		CppUnitLite::UnitTest::Registration functName ## Registration \
+		(#functName, limit, &functName ## Benchmark, false, true); \
+		void functName(CppUnitLite::Benchmark& UNITTEST_BENCHMARK_PARAMETER)
+
+
+
+namespace CppUnitLite {
+
+/* ********************************************************
+ * Benchmarks
+ * ********************************************************/
+
+/**
+ * The state of a running UnitBenchmark(...). Its body is run several
+ * times, each with its own number of iterations of the timed loop:
+ *
+ *      UnitBenchmark (benchSort)
+ *      {
+ *          std::vector<int> v = randomInts(1000); // not timed
+ *          benchmark.setItemsPerIteration (v.size());
+ *          while (benchmark.keepRunning()) {
+ *              std::vector<int> w = v;
+ *              std::sort (w.begin(), w.end());
+ *              doNotOptimize (w);
+ *          }
+ *      }
+ */
+class Benchmark {
+public:
+	/**
+	 * Starts the clock on the first call.
+	 *
+	 * @return true while there are iterations left to run, false
+	 *         (after stopping the clock) when they are done
+	 */
+	bool keepRunning()
+	{
+		if (remaining > 0) {
+			--remaining;
+			return true;
+		}
+		return startOrStop();
+	}
+
+	/**
+	 * Stop the clock within the timed loop, e.g., while resetting
+	 * the data for the next iteration.
+	 */
+	void pauseTiming();
+
+	/**
+	 * Restart the clock after pauseTiming().
+	 */
+	void resumeTiming();
+
+	/**
+	 * Report the throughput of the benchmark, in bytes per second.
+	 *
+	 * @param bytes bytes processed by each iteration of the loop
+	 */
+	void setBytesPerIteration (double bytes) {bytesPerIteration = bytes;}
+
+	/**
+	 * Report the throughput of the benchmark, in items per second.
+	 *
+	 * @param items items processed by each iteration of the loop
+	 */
+	void setItemsPerIteration (double items) {itemsPerIteration = items;}
+
+	/**
+	 * @return the number of iterations being timed in this run of the body
+	 */
+	unsigned long long iterations() const {return runIterations;}
+
+private:
+	friend class UnitTest;
+
+	unsigned long long remaining;
+	unsigned long long runIterations;
+	bool started;
+	bool finished;
+	long long startNS;
+	long long elapsedNS;
+	double bytesPerIteration;
+	double itemsPerIteration;
+
+	Benchmark();
+	bool startOrStop();
+
+	/**
+	 * Run the body with the given number of iterations.
+	 *
+	 * @param looped set false if the body has no keepRunning() loop,
+	 *        in which case the body itself is run n times
+	 * @return the time per iteration, in nanoseconds
+	 */
+	double measure (const Callable<void(Benchmark&)>& body, unsigned long long n,
+			bool& looped);
+};
+
+/**
+ * Summary of the repeated timings of a benchmark.
+ */
+struct BenchmarkStatistics {
+	unsigned long long iterations; ///< iterations in each timing
+	unsigned repetitions;
+	double minNS;    ///< nanoseconds per iteration
+	double medianNS;
+	double p99NS;
+	double meanNS;
+	double stddevNS;
+	double bytesPerSecond; ///< or < 0 if not reported
+	double itemsPerSecond; ///< or < 0 if not reported
+
+	BenchmarkStatistics ();
+
+	/**
+	 * @param nsPerIteration the time per iteration of each repetition
+	 * @param iterationsPerRepetition iterations timed in each repetition
+	 * @param bytesPerIteration bytes processed per iteration, or < 0
+	 * @param itemsPerIteration items processed per iteration, or < 0
+	 */
+	BenchmarkStatistics (std::vector<double> nsPerIteration,
+			unsigned long long iterationsPerRepetition,
+			double bytesPerIteration = -1.0, double itemsPerIteration = -1.0);
+
+	/**
+	 * @return the statistics as lines of a TAP YAML block
+	 */
+	std::string yaml() const;
+
+	/**
+	 * @return the distribution of the times in one line, for messages
+	 */
+	std::string summary() const;
+};
+
+// Where compilers lack inline assembly, values escape through here.
+void benchmarkSink (const volatile void* p);
+
+/**
+ * Keep the compiler from discarding the computation of a value that
+ * a benchmark never uses.
+ */
+template <typename T>
+inline void doNotOptimize (const T& value)
+{
+#if defined(__GNUC__)
+	__asm__ __volatile__ ("" : : "r,m"(value) : "memory");
+#else
+	benchmarkSink (&value);
+#endif
+}
+
+template <typename T>
+inline void doNotOptimize (T& value)
+{
+#if defined(__GNUC__)
+	__asm__ __volatile__ ("" : "+m"(value) : : "memory");
+#else
+	benchmarkSink (&value);
+#endif
+}
+
+/**
+ * Keep the compiler from assuming that memory is unchanged across
+ * this point, or from leaving pending writes to memory undone.
+ */
+inline void clobberMemory ()
+{
+#if defined(__GNUC__)
+	__asm__ __volatile__ ("" : : : "memory");
+#else
+	std::atomic_signal_fence (std::memory_order_seq_cst);
+#endif
+}
+
+/**
+ * Check the median time of a call of body against a limit.
+ * Normally called via assertCompletesWithin(...).
+ *
+ * @param limit the longest time allowed
+ * @param body the code to be timed
+ */
+template <typename Rep, typename Period>
+inline AssertionResult completesWithin (std::chrono::duration<Rep, Period> limit,
+		const Callable<void()>& body)
+{
+	return UnitTest::completesWithin(
+			std::chrono::duration<double, std::nano>(limit).count(), body);
+}
+
+}
+
+#endif
@@ -0,0 +1,1312 @@
+#ifndef UNITTEST_CORE_H
+#define UNITTEST_CORE_H
+
+/**
+ * The core of CppUnitLite: the assertion and registration macros, and
+ * the running of the tests. The matchers (isEqualTo, contains, ...) are
+ * declared in unittestMatchers.h, and properties (UnitProperty) in
+ * unittestProperties.h; unittest.h includes all three. Benchmarks and
+ * timing assertions (unittestBenchmarks.h), data-driven tests
+ * (unittestData.h) and reporters (unittestReporters.h) are included
+ * only by the tests that use them.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <new>
+#include <ostream> // before the fail macro, which would break basic_ios::fail
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+
+/**
+ * Time limit, in milliseconds, before a test function is killed
+ * on suspicion of the code under test having gone into an infinite loop.
+ *
+ * Affects all subsequent UniTest(...) declarations, but is ignored by
+ * any UnitTestTimed(...) declarations (because they supply their own
+ * time limit, overriding the default).
+ *
+ * Note that a non-positive value for this time limit suppresses the timing
+ * check entirely. This may be useful as a way of "stopping the clock"
+ * when debugging failed tests.
+ */
+#define DEFAULT_UNIT_TEST_TIME_LIMIT 500L
+
+/**
+ *   Macros - actual tests will invoke one of these
+ */
+
+#define assertThat( obj, matcher ) CppUnitLite::UnitTest::checkTest \
+	((matcher).eval(obj), #obj, #matcher, __FILE__, __LINE__)
+
+
+#define assertTrue(cond) CppUnitLite::UnitTest::checkTest\
+	((cond) ? true : false, #cond, __FILE__, __LINE__)
+
+#define assertTruex(cond) CppUnitLite::UnitTest::checkTest\
+	(cond, #cond, __FILE__, __LINE__)
+
+#define assertFalse(cond) CppUnitLite::UnitTest::checkTest\
+	(!(cond), "!(" #cond ")", __FILE__, __LINE__)
+
+#define assertFalsex(cond) CppUnitLite::UnitTest::checkTest\
+	(!(cond), "!(" #cond ")", __FILE__, __LINE__)
+
+#define assertEqual( x, y ) assertThat(x, isEqualTo(y))
+#define assertEqualx( x, y ) CppUnitLite::UnitTest::checkTest ((x)==(y),\
+		"assertEqual("  #x "," #y ")", \
+		__FILE__, __LINE__)
+
+#define assertNotEqual( x , y ) assertThat(x, isNotEqualTo(y))
+
+#define assertNotEqualx( x , y ) assertFalse ((x)==(y))
+
+#define assertNull(x) assertTrue ((x)==nullptr)
+
+#define assertNotNull(x) assertTrue ((x)!=nullptr)
+
+#define succeed CppUnitLite::UnitTest::checkTest (\
+		true, "succeed", __FILE__, __LINE__)
+
+#define fail CppUnitLite::UnitTest::checkTest (\
+		false, "fail", __FILE__, __LINE__)
+
+/**
+ * Soft assertions: a failed expectation is recorded, and the test goes
+ * on. The test fails when it ends, listing every failed expectation,
+ * or is stopped once it has failed --max-failed-expectations of them.
+ */
+#define expectThat( obj, matcher ) CppUnitLite::UnitTest::checkExpectation \
+	((matcher).eval(obj), #obj, #matcher, __FILE__, __LINE__)
+
+#define expectTrue(cond) CppUnitLite::UnitTest::checkExpectation\
+	((cond) ? true : false, #cond, __FILE__, __LINE__)
+
+#define expectFalse(cond) CppUnitLite::UnitTest::checkExpectation\
+	(!(cond), "!(" #cond ")", __FILE__, __LINE__)
+
+#define expectEqual( x, y ) expectThat(x, isEqualTo(y))
+
+/**
+ * Heap allocation assertions: fail if body makes more than n (or any)
+ * allocations with operator new. These need UNITTEST_COUNT_ALLOCATIONS.
+ */
+#define assertMaxAllocations(n, ...) CppUnitLite::UnitTest::checkTest \
+	(CppUnitLite::UnitTest::allocatesAtMost((n), __VA_ARGS__), \
+	"assertMaxAllocations(" #n ", " #__VA_ARGS__ ")", __FILE__, __LINE__)
+
+#define assertNoAllocations(...) CppUnitLite::UnitTest::checkTest \
+	(CppUnitLite::UnitTest::allocatesAtMost(0, __VA_ARGS__), \
+	"assertNoAllocations(" #__VA_ARGS__ ")", __FILE__, __LINE__)
+
+/**
+ * Test registration
+ */
+
+#define UnitTest(functName) UnitTestTimed(functName, DEFAULT_UNIT_TEST_TIME_LIMIT)
+
+#define UnitTestTimed(functName, limit) void functName(); \
+		CppUnitLite::UnitTest::Registration functName ## Registration \
+		(#functName, limit, &functName); void functName()
+
+/**
+ * Registration of a test that is safe to run at the same time as other
+ * such tests, on a pool of threads within the test process.
+ */
+#define UnitTestConcurrent(functName) UnitTestConcurrentTimed(functName, DEFAULT_UNIT_TEST_TIME_LIMIT)
+
+#define UnitTestConcurrentTimed(functName, limit) void functName(); \
+		CppUnitLite::UnitTest::Registration functName ## Registration \
+		(#functName, limit, &functName, true); void functName()
+
+/**
+ * A fixture shared by the tests declared with UnitTestWith(...). It is
+ * declared as a struct, whose default constructor sets it up and whose
+ * destructor tears it down:
+ *
+ *    UnitTestFixture(ReferenceData) {
+ *        std::vector<Sample> samples;
+ *        ReferenceData(): samples(loadSamples("reference.dat")) {}
+ *    };
+ *
+ * A fixture is constructed once per process, when a test that uses it
+ * is first run, or, in the main process, before any of the tests
+ * selected to be run. It is destroyed at the end of runTests.
+ */
+#define UnitTestFixture(fixtureName) struct fixtureName: public CppUnitLite::SharedFixture
+
+/**
+ * Registration of a test whose body is given, as `fixture`, a const
+ * reference to a shared fixture.
+ */
+#define UnitTestWith(functName, fixtureName) \
+		UnitTestWithTimed(functName, fixtureName, DEFAULT_UNIT_TEST_TIME_LIMIT)
+
+#define UnitTestWithTimed(functName, fixtureName, limit) \
+		void functName(const fixtureName&); \
+		void functName ## WithFixture() \
+			{ functName(CppUnitLite::UnitTest::fixture<fixtureName>()); } \
+		CppUnitLite::UnitTest::Registration functName ## Registration \
+		(#functName, limit, &functName ## WithFixture, false, false, \
+			&CppUnitLite::UnitTest::prepareFixture<fixtureName>); \
+		void functName(const fixtureName& fixture)
+
+
+
+namespace CppUnitLite {
+
+
+/**
+ * A copy of any function object with a given signature, as kept by
+ * std::function, but without the weight of <functional> in every test
+ * source. One no bigger than three pointers, such as a lambda capturing
+ * a matcher and the value that it tests, is kept in place rather than
+ * on the heap.
+ */
+template <typename Signature>
+class Callable;
+
+template <typename R, typename... Args>
+class Callable<R(Args...)> {
+	typedef typename std::aligned_storage<3 * sizeof(void*)>::type Storage;
+
+	struct Operations {
+		R (*call) (void* f, Args&&... args);
+		void (*copy) (void* to, const void* from);
+		void (*move) (void* to, void* from); ///< leaves from destroyed
+		void (*destroy) (void* f);
+	};
+
+	template <typename F, bool inPlace = (sizeof(F) <= sizeof(Storage)
+			&& alignof(F) <= alignof(Storage))>
+	struct Held {
+		static F& get (void* s) { return *static_cast<F*>(s); }
+		template <typename G>
+		static void create (void* s, G&& g) { new (s) F(std::forward<G>(g)); }
+		static R call (void* s, Args&&... args) { return get(s)(std::forward<Args>(args)...); }
+		static void copy (void* to, const void* from) { new (to) F(*static_cast<const F*>(from)); }
+		static void move (void* to, void* from) { new (to) F(std::move(get(from))); get(from).~F(); }
+		static void destroy (void* s) { get(s).~F(); }
+		static const Operations* operations ()
+		{
+			static const Operations table = {&call, &copy, &move, &destroy};
+			return &table;
+		}
+	};
+
+	template <typename F>
+	struct Held<F, false> {
+		static F*& get (void* s) { return *static_cast<F**>(s); }
+		template <typename G>
+		static void create (void* s, G&& g) { get(s) = new F(std::forward<G>(g)); }
+		static R call (void* s, Args&&... args) { return (*get(s))(std::forward<Args>(args)...); }
+		static void copy (void* to, const void* from)
+		{
+			get(to) = new F(**static_cast<F* const*>(from));
+		}
+		static void move (void* to, void* from) { get(to) = get(from); }
+		static void destroy (void* s) { delete get(s); }
+		static const Operations* operations ()
+		{
+			static const Operations table = {&call, &copy, &move, &destroy};
+			return &table;
+		}
+	};
+
+	mutable Storage storage;
+	const Operations* operations; ///< or null if empty
+
+public:
+	Callable (): operations(nullptr) {}
+	Callable (std::nullptr_t): operations(nullptr) {}
+
+	template <typename F, typename = typename std::enable_if<
+			!std::is_same<typename std::decay<F>::type, Callable>::value>::type>
+	Callable (F&& f): operations(Held<typename std::decay<F>::type>::operations())
+	{
+		Held<typename std::decay<F>::type>::create(&storage, std::forward<F>(f));
+	}
+
+	Callable (const Callable& other): operations(other.operations)
+	{
+		if (operations != nullptr)
+			operations->copy(&storage, &other.storage);
+	}
+
+	Callable (Callable&& other) noexcept: operations(other.operations)
+	{
+		if (operations != nullptr)
+			operations->move(&storage, &other.storage);
+		other.operations = nullptr;
+	}
+
+	~Callable () { clear(); }
+
+	Callable& operator= (Callable other)
+	{
+		clear();
+		if (other.operations != nullptr)
+			other.operations->move(&storage, &other.storage);
+		operations = other.operations;
+		other.operations = nullptr;
+		return *this;
+	}
+
+	explicit operator bool () const { return operations != nullptr; }
+
+	R operator() (Args... args) const
+	{
+		return operations->call(&storage, std::forward<Args>(args)...);
+	}
+
+	friend bool operator== (const Callable& f, std::nullptr_t) { return f.operations == nullptr; }
+	friend bool operator!= (const Callable& f, std::nullptr_t) { return f.operations != nullptr; }
+
+private:
+	void clear ()
+	{
+		if (operations != nullptr)
+			operations->destroy(&storage);
+		operations = nullptr;
+	}
+};
+
+
+/**
+ * The outcome of evaluating a matcher.
+ *
+ * Explanations are deferred: a matcher supplies an "explainer", a callable
+ * taking a bool (true for the pass explanation, false for the fail
+ * explanation) and returning the text.  It is only invoked when an
+ * explanation is actually requested, normally by UnitTest::checkTest
+ * upon a failure, so a passing assertion does no string building.
+ *
+ * Explainers may refer to the matcher and to the value being tested, so a
+ * result should be examined before either of those goes out of scope
+ * (which is automatic within the assertion macros).
+ */
+class AssertionResult {
+public:
+	typedef Callable<std::string(bool)> Explainer;
+
+	bool result; ///> True iff assertion passed
+
+	AssertionResult (bool theResult, std::string passExplain,
+					 std::string failExplain);
+
+	AssertionResult (bool theResult, const char* passExplain,
+					 const char* failExplain);
+
+	AssertionResult (bool theResult, Explainer explainer);
+
+	/**
+	 * @return the explanation for passing, if any.
+	 */
+	std::string passExplanation() const;
+
+	/**
+	 * @return the explanation for failure, if any.
+	 */
+	std::string failExplanation() const;
+
+	/**
+	 * @return the opposite of this result, with the pass/fail
+	 *         explanations exchanged.
+	 */
+	AssertionResult negated() const;
+
+private:
+	Explainer explainer;
+	bool inverted;
+};
+
+
+/* ********************************************************
+ * Heap allocation accounting
+ * ********************************************************/
+
+/**
+ * The replacements for the global operator new and delete, installed
+ * by defining UNITTEST_COUNT_ALLOCATIONS. The allocations made by each
+ * test's own thread are counted, and reported with its result.
+ */
+void* countedAllocate (std::size_t size, bool throwing);
+void countedFree (void* p) noexcept;
+
+/**
+ * Called once, by the replacements, to enable the reports.
+ */
+bool enableAllocationCounting ();
+
+/**
+ * While one exists, the allocations made by this thread are the
+ * framework's own, and are not charged to the test.
+ */
+class UncountedAllocations {
+	void* previous;
+public:
+	UncountedAllocations ();
+	~UncountedAllocations ();
+	UncountedAllocations (const UncountedAllocations&) = delete;
+	UncountedAllocations& operator= (const UncountedAllocations&) = delete;
+};
+
+
+/**
+ * An argument of a logged call, kept in its own type so that it need
+ * only be rendered as a string if an assertion about it fails.
+ */
+class LoggedValue {
+public:
+	virtual const std::type_info& type() const = 0;
+	virtual const void* address() const = 0;
+	virtual void write (std::ostream& out) const = 0;
+
+	std::string str() const;
+
+protected:
+	~LoggedValue() {}
+};
+
+template <typename T>
+class LoggedValueOf;
+
+// The type in which a logged argument is kept. Character strings are
+// copied into the log, as they may not outlive the call.
+template <typename T>
+struct logged_type {
+	typedef typename std::decay<T>::type decayed;
+	typedef typename std::conditional<std::is_same<decayed, char*>::value,
+		const char*, decayed>::type type;
+};
+
+/**
+ * A call recorded in the call log.
+ */
+struct LoggedCall {
+	const char* function;
+	unsigned numArguments;
+	const LoggedValue** arguments;
+
+	/**
+	 * @return the function name and the arguments, separated by tabs
+	 */
+	std::string str() const;
+};
+
+/**
+ * The calls logged by a test, normally via UnitTest::logCall.
+ *
+ * Calls and their arguments are kept in an arena that is reset, not
+ * freed, when the log is cleared, so that clearing takes constant time
+ * unless some argument needs its destructor run. If a limit is set, calls
+ * beyond it are only counted.
+ *
+ * Recording is thread-safe. Read the log once the threads writing to
+ * it have been joined.
+ */
+class CallLog {
+public:
+	typedef std::vector<const LoggedCall*>::const_iterator const_iterator;
+	typedef const_iterator iterator;
+
+	CallLog ();
+	~CallLog ();
+	CallLog (const CallLog&) = delete;
+	CallLog& operator= (const CallLog&) = delete;
+
+	const_iterator begin() const { return calls.begin(); }
+	const_iterator end() const { return calls.end(); }
+	std::size_t size() const { return calls.size(); }
+
+	/**
+	 * Discard all of the logged calls.
+	 */
+	void clear ();
+
+	/**
+	 * Record at most maxCalls calls (0 for no limit).
+	 */
+	void setLimit (std::size_t maxCalls);
+	std::size_t limit() const { return maxCalls; }
+
+	/**
+	 * @return the number of calls not recorded because of the limit.
+	 */
+	std::size_t droppedCalls() const { return dropped; }
+
+	/**
+	 * @return the logged calls in string form, as by LoggedCall::str()
+	 */
+	const std::vector<std::string>& text() const;
+
+	/**
+	 * Record a call.
+	 *
+	 * @param function name of the function, which must outlive the log
+	 *                 unless copyName is true
+	 */
+	template <typename... Args>
+	void record (const char* function, bool copyName, const Args&... args)
+	{
+		const Locked locked(*this);
+		const UncountedAllocations uncounted;
+		LoggedCall* call = startCall(function, copyName, sizeof...(Args));
+		if (call != nullptr)
+		{
+			setArguments(call, 0, args...);
+			calls.push_back(call);
+		}
+	}
+
+private:
+	struct Mutex; // a std::mutex, kept out of the header
+	std::unique_ptr<Mutex> mutex;
+	void lock ();
+	void unlock ();
+
+	class Locked {
+		CallLog& log;
+	public:
+		explicit Locked (CallLog& l): log(l) { log.lock(); }
+		~Locked () { log.unlock(); }
+		Locked (const Locked&) = delete;
+		Locked& operator= (const Locked&) = delete;
+	};
+
+	std::vector<const LoggedCall*> calls;
+	std::vector<std::unique_ptr<char[]>> blocks;
+	std::vector<std::size_t> blockSizes;
+	std::size_t currentBlock;
+	std::size_t used;        // of the current block
+	std::vector<std::pair<void (*)(const void*), const void*>> destructors;
+	std::size_t maxCalls;
+	std::size_t dropped;
+	std::size_t clears;
+	mutable std::vector<std::string> cachedText;
+	mutable std::size_t textClears; // clears when cachedText was begun
+
+	void* allocate (std::size_t size);
+	const char* copy (const char* s);
+	LoggedCall* startCall (const char* function, bool copyName, unsigned numArguments);
+
+	template <typename T>
+	static void destroy (const void* p)
+	{
+		static_cast<const T*>(p)->~T();
+	}
+
+	const char* stored (const char* s, std::true_type) { return copy(s); }
+
+	template <typename T>
+	const T& stored (const T& t, std::false_type) { return t; }
+
+	void setArguments (LoggedCall*, unsigned) {}
+
+	template <typename T, typename... Rest>
+	void setArguments (LoggedCall* call, unsigned i, const T& t, const Rest&... rest)
+	{
+		typedef typename logged_type<T>::type Stored;
+		typedef LoggedValueOf<Stored> Value;
+		Value* value = new (allocate(sizeof(Value)))
+			Value(stored(t, std::is_same<Stored, const char*>()));
+		if (!std::is_trivially_destructible<Stored>::value)
+			destructors.push_back(std::make_pair(&destroy<Value>, (const void*)value));
+		call->arguments[i] = value;
+		setArguments(call, i+1, rest...);
+	}
+};
+
+class Benchmark;
+struct BenchmarkStatistics;
+
+/**
+ * Base of the fixtures declared by UnitTestFixture(...), which are
+ * shared by reference and so cannot be copied.
+ */
+class SharedFixture {
+public:
+	SharedFixture () {}
+	SharedFixture (const SharedFixture&) = delete;
+	SharedFixture& operator= (const SharedFixture&) = delete;
+};
+
+class Reporter;
+
+/**
+ * Main support class for unit test execution.
+ */
+class UnitTest {
+public:
+	/**
+	 * Change to false to print diagnostics after the ok/not ok result.
+	 */
+	static bool diagnosticMessagesBeforeResults;
+
+	typedef void (*TestFunction)();
+
+	/**
+	 * Exception thrown to indicate a failed assertion.
+	 */
+	class UnitTestFailure: public std::exception {
+		std::string explanation;
+	public:
+		UnitTestFailure (const char* conditionStr,
+				const char* fileName, int lineNumber);
+
+		UnitTestFailure (const std::string& conditionStr,
+				const char* fileName, int lineNumber);
+
+		virtual const char* what() const noexcept;
+	};
+
+	/**
+	 * The main test function - normally called via one of the macros
+	 * declared following this class.  Does nothing if the assertion
+	 * was passed, but throws an exception if the assertion was failed.
+	 *
+	 * @param result the assertion condition, "" if passed, otherwise
+	 *                contains an explanation for the failure.
+	 * @param conditionStr a string rendering of the assertion condition.
+	 * @param fileName Source code file in which the assertion occurs,
+	 * @param lineNumber Source code line number at which the assertion occurs,
+	 * @throws UnitTestFailure  if condition is false.
+	 */
+	static void checkTest (const AssertionResult& result, const std::string& conditionStr,
+			const char* fileName, int lineNumber)
+	{
+		if (!result.result)
+			assertionFailed(result, conditionStr, fileName, lineNumber);
+	}
+
+	/**
+	 * As above, but with the condition string passed as a literal so that
+	 * nothing is allocated unless the assertion fails.
+	 */
+	static void checkTest (const AssertionResult& result, const char* conditionStr,
+			const char* fileName, int lineNumber)
+	{
+		if (!result.result)
+			assertionFailed(result, conditionStr, fileName, lineNumber);
+	}
+
+	/**
+	 * Check the result of an assertThat, whose condition string is
+	 * the value expression and the matcher expression, combined only
+	 * if the assertion fails.
+	 *
+	 * @param result the assertion condition
+	 * @param objStr a string rendering of the value being tested.
+	 * @param matcherStr a string rendering of the matcher.
+	 * @param fileName Source code file in which the assertion occurs,
+	 * @param lineNumber Source code line number at which the assertion occurs,
+	 * @throws UnitTestFailure  if condition is false.
+	 */
+	static void checkTest (const AssertionResult& result,
+			const char* objStr, const char* matcherStr,
+			const char* fileName, int lineNumber)
+	{
+		if (!result.result)
+			assertionFailed(result, std::string(objStr) + " " + matcherStr,
+					fileName, lineNumber);
+	}
+
+	/**
+	 * The main test function - normally called via one of the macros
+	 * declared following this class.  Does nothing if the assertion
+	 * was passed, but throws an exception if the assertion was failed.
+	 *
+	 * @param condition the assertion condition, true iff passed.
+	 * @param conditionStr a string rendering of the assertion condition.
+	 * @param fileName Source code file in which the assertion occurs,
+	 * @param lineNumber Source code line number at which the assertion occurs,
+	 * @throws UnitTestFailure  if condition is false.
+	 */
+	static void checkTest (bool condition, const char* conditionStr,
+			const char* fileName, int lineNumber)
+	{
+		if (!condition)
+			assertionFailed(AssertionResult(false, "", ""), conditionStr,
+					fileName, lineNumber);
+	}
+
+	/**
+	 * The soft version of checkTest, normally called via the expect...
+	 * macros. A failed expectation is recorded for the current test,
+	 * which is then allowed to continue.
+	 *
+	 * @param result the expectation
+	 * @param objStr a string rendering of the value being tested.
+	 * @param matcherStr a string rendering of the matcher.
+	 * @param fileName Source code file in which the expectation occurs,
+	 * @param lineNumber Source code line number at which the expectation occurs,
+	 * @throws UnitTestFailure  if the test has failed too many expectations.
+	 */
+	static void checkExpectation (const AssertionResult& result,
+			const char* objStr, const char* matcherStr,
+			const char* fileName, int lineNumber)
+	{
+		if (!result.result)
+			expectationFailed(result, std::string(objStr) + " " + matcherStr,
+					fileName, lineNumber);
+	}
+
+	/**
+	 * As above, for a condition that is true iff the expectation is met.
+	 */
+	static void checkExpectation (bool condition, const char* conditionStr,
+			const char* fileName, int lineNumber)
+	{
+		if (!condition)
+			expectationFailed(AssertionResult(false, "", ""), conditionStr,
+					fileName, lineNumber);
+	}
+
+
+	// Summary info about tests conducted so far
+
+	/**
+	 * How many tests have been run?
+	 *
+	 * @return number of tests.
+	 */
+	static long getNumTests();
+
+	/**
+	 * How many tests were terminated by a failed assertion?
+	 *
+	 * @return number of failed tests.
+	 */
+	static long getNumFailures();
+
+	/**
+	 * How many tests were terminated by an unexpected exception,
+	 * run-time error, or time-out?
+	 *
+	 * @return number of uncompleted tests.
+	 */
+	static long getNumErrors();
+
+	/**
+	 * How many tests terminated successfully?
+	 *
+	 * @return number of passed tests.
+	 */
+	static long getNumSuccesses();
+
+
+
+	/**
+	 * Run all units tests whose name contains testNames[i],
+	 * for all i in 0..nTests-1.
+	 *
+	 * Special case: If nTests == 0, runs all unit Tests.
+	 *
+	 * testNames may also contain options:
+	 *   -j N, --jobs=N  run the tests in N worker processes (0 means one
+	 *                   per core). Results are still reported in order.
+	 *   --threads=N     run the tests declared by UnitTestConcurrent on
+	 *                   N threads (default 0, one per core) before the
+	 *                   others, when not running in worker processes.
+	 *   --isolate       run the tests in a separate worker process even
+	 *                   without -j, so that a crash or a time-out
+	 *                   cannot disturb the tests that follow.
+	 *   --shard-count=N, --shard-index=i
+	 *                   run only the i'th (0-based) of N disjoint subsets
+	 *                   of the selected tests.
+	 *   --shard-timings=path
+	 *                   balance the shards by the test times ("name ms"
+	 *                   per line) recorded in a file. With -j, these
+	 *                   times also start the longest tests first.
+	 *   --verify-shards check, without running any tests, that the
+	 *                   shards cover every selected test exactly once,
+	 *                   by listing each shard (--list) in a separate run
+	 *                   of the program.
+	 *   --save-timings=path
+	 *                   write each test's time to a file, in the form
+	 *                   read by --shard-timings.
+	 *   --slowest=N     list the N slowest tests in the report
+	 *                   (default 5, 0 for none).
+	 *   --filter=pattern
+	 *                   also run the tests whose full names match a glob
+	 *                   pattern ('*', '?', [...]) or a /regex/. A leading
+	 *                   '-' instead excludes the matching tests.
+	 *   --list          list the names of the selected tests without
+	 *                   running them.
+	 *   --output=path, --output-fd=N
+	 *                   write the TAP results to a file or an already
+	 *                   open file descriptor instead of standard output.
+	 *   --benchmarks    select all of the UnitBenchmark(...)s, which
+	 *                   are otherwise run only when selected by name.
+	 *                   Other tests then run only if they, too, are
+	 *                   selected by name or by --filter.
+	 *   --benchmark-repetitions=N
+	 *                   time each benchmark N times (default 20).
+	 *   --benchmark-min-ms=T
+	 *                   run each timing of a benchmark for at least T
+	 *                   milliseconds (default 10).
+	 *   --benchmark-output=path
+	 *                   write the benchmark statistics to a file, one
+	 *                   line of numbers per benchmark.
+	 *   --baselines=path
+	 *                   the file of timings against which
+	 *                   assertNoSlowerThanBaseline compares (default
+	 *                   unittest-baselines.txt).
+	 *   --machine-tag=tag
+	 *                   the machine whose baselines are used (default,
+	 *                   the host name).
+	 *   --update-baselines
+	 *                   record the times measured by
+	 *                   assertNoSlowerThanBaseline in the baselines file
+	 *                   instead of checking them. The tests are run one
+	 *                   at a time.
+	 *   --fail-on-leaks fail the tests that end with memory still
+	 *                   allocated, when UNITTEST_COUNT_ALLOCATIONS is
+	 *                   defined.
+	 *   --results-cache=path
+	 *                   where the result and time of each test are
+	 *                   kept from one run to the next (default, the
+	 *                   program's path plus ".unittest-results"; ""
+	 *                   for none).
+	 *   --failed-first  run the tests that failed in the last run
+	 *                   before the others.
+	 *   --only-failed   run only the tests that failed in the last
+	 *                   run, and those that were not run.
+	 *   --fail-fast[=N] skip the remaining tests once N (default 1)
+	 *                   have failed.
+	 *   --property-cases=N
+	 *                   try each property (UnitProperty) on N sets of
+	 *                   values (default 100).
+	 *   --seed=S        draw the values of properties from seed S,
+	 *                   instead of from one chosen at random.
+	 *   --rows=first-last
+	 *                   run only rows first through last (counting
+	 *                   from 1; either may be left out) of each
+	 *                   data-driven test.
+	 *   --data-parts=N  split each data-driven test into N tests,
+	 *                   name[1ofN] ... name[NofN], each running every Nth
+	 *                   row, so that workers and shards can share them.
+	 *   --max-failed-expectations=N
+	 *                   stop a test once N of its expectations
+	 *                   (expectThat, expectTrue, ...) have failed
+	 *                   (default 100).
+	 *   --counters      count the cycles, instructions, cache misses and
+	 *                   branch misses of each test, where the hardware
+	 *                   and the kernel (Linux perf events) allow it.
+	 *   --profile-slow[=fraction]
+	 *                   sample the stack of each test (on Linux), and
+	 *                   report where the time went in the tests that
+	 *                   take more than a fraction (default 0.5) of their
+	 *                   time limits, or time out.
+	 *   --profile-dir=path
+	 *                   where to write the collapsed stacks of the slow
+	 *                   tests (default, the current directory).
+	 *   --reporter=tap[:path]
+	 *   --reporter=junit:path
+	 *   --reporter=binary:path
+	 *                   report the results as TAP (the default, on the
+	 *                   standard output unless a path is given), as
+	 *                   JUnit XML, or as binary records. May be given
+	 *                   more than once.
+	 *
+	 * @param nTests number of test name substrings
+	 * @param testNames  array of possible substrings of test names
+	 * @param programName path to program executable
+	 */
+	static void runTests (int nTests, char** testNames, char* programName);
+
+	/**
+	 * Print a simple summary report. Includes number of tests passed,
+	 * failed, and erroneously termnated, and the slowest tests.
+	 *
+	 */
+	static void report ();
+
+	/**
+	 * Add a reporter of the results of the coming test run. If none
+	 * is added, here or with --reporter, the results are reported as
+	 * TAP on the standard output.
+	 *
+	 * @param reporter receives the events of the run
+	 */
+	static void addReporter (std::shared_ptr<Reporter> reporter);
+
+	/**
+	 * Register a new UnitTest, making it eligible for running.
+	 *
+	 * @param functName name of the test function.
+	 * @param timeLimit time limit in milliseconds
+	 * @param funct the unit test function
+	 * @param concurrent true if the test may run at the same time as
+	 *        other concurrent tests
+	 * @param benchmark true if the test is a UnitBenchmark(...)
+	 */
+	static int registerUT (std::string functName, int timeLimit, TestFunction funct,
+			bool concurrent = false, bool benchmark = false);
+
+	/**
+	 * A registered test, as declared by UnitTest(...) or UnitTestTimed(...).
+	 *
+	 * Registrations are statically allocated and linked into a list as
+	 * they are constructed, so registering a test costs no heap
+	 * allocation. The list is only sorted and indexed when runTests
+	 * needs it.
+	 */
+	struct Registration {
+		const char* name;
+		int timeLimit;
+		TestFunction function;
+		bool concurrent; ///< declared by UnitTestConcurrent(...)
+		bool benchmark;  ///< declared by UnitBenchmark(...)
+		TestFunction fixture; ///< builds the fixture of a UnitTestWith(...)
+		bool data;       ///< declared by UnitTestData(...)
+		const Registration* next;
+
+		Registration (const char* functName, int limit, TestFunction funct,
+				bool concurrentSafe = false, bool isBenchmark = false,
+				TestFunction prepare = nullptr, bool dataDriven = false)
+			: name(functName), timeLimit(limit), function(funct),
+			  concurrent(concurrentSafe), benchmark(isBenchmark), fixture(prepare),
+			  data(dataDriven), next(registrations)
+		{
+			registrations = this;
+		}
+	};
+
+	/**
+	 * Reverses the expectation for the current test.  A test that fails or halts
+	 * with an error will be reported and counted as OK.  If that test succeeds,
+	 * it will be reported and counted as an error.
+	 *
+	 * Must be called before any assertions.
+	 */
+	static void expectedToFail();
+
+	/* ********************************************************
+	 * Assertions on other threads
+	 * ********************************************************/
+
+	/**
+	 * The state of a running test: its name, whether it is expected to
+	 * fail, its call log, and the first failure raised on any thread
+	 * other than its own.  A test that returns normally after one of its
+	 * threads failed an assertion is reported as having failed.
+	 */
+	class TestContext;
+
+	/**
+	 * The context of the test on whose behalf this thread is working:
+	 * the one it has adopted via ContextScope or propagate(...), or else
+	 * the test being run. A thread that has adopted none while several
+	 * tests run at once (UnitTestConcurrent) cannot be assigned to any
+	 * of them, and a failure on it fails all of them.
+	 */
+	static std::shared_ptr<TestContext> currentContext();
+
+	/**
+	 * Adopts a test's context on the current thread for the lifetime of
+	 * the scope, e.g.
+	 *
+	 *     auto context = UnitTest::currentContext();
+	 *     std::thread t([context] () {
+	 *         UnitTest::ContextScope scope(context);
+	 *         ...
+	 *     });
+	 *
+	 * An assertion failing on an adopting thread is recorded in the context
+	 * before the UnitTestFailure is thrown, so the thread need only stop.
+	 */
+	class ContextScope {
+		std::shared_ptr<TestContext> previous;
+	public:
+		explicit ContextScope (const std::shared_ptr<TestContext>& context);
+		~ContextScope ();
+		ContextScope (const ContextScope&) = delete;
+		ContextScope& operator= (const ContextScope&) = delete;
+	};
+
+	/**
+	 * Record a failure in a test's context, as if raised on another thread.
+	 */
+	static void failInContext (const std::shared_ptr<TestContext>& context,
+			const std::string& explanation);
+
+	/**
+	 * A function wrapped so that it runs in a given test context, with
+	 * any assertion failure or exception marshalled back to that test.
+	 */
+	template <typename Function>
+	class InContext {
+		std::shared_ptr<TestContext> context;
+		Function function;
+	public:
+		InContext (const std::shared_ptr<TestContext>& c, Function f)
+		: context(c), function(f) {}
+
+		template <typename... Args>
+		void operator() (Args&&... args)
+		{
+			ContextScope scope(context);
+			try {
+				function(std::forward<Args>(args)...);
+			} catch (UnitTestFailure&) {
+				// Already recorded in the context
+			} catch (std::exception& e) {
+				failInContext(context, std::string("Unexpected error on another thread: ")
+						+ e.what());
+			} catch (...) {
+				failInContext(context, "Unexpected error on another thread");
+			}
+		}
+	};
+
+	/**
+	 * Wrap a function to be run on another thread on behalf of the
+	 * current test, e.g.
+	 *
+	 *     std::thread t(UnitTest::propagate([&] () { assertThat(f(), is(2)); }));
+	 *
+	 * Threads must be joined before the test returns.
+	 */
+	template <typename Function>
+	static InContext<Function> propagate (Function f)
+	{
+		return InContext<Function>(currentContext(), f);
+	}
+
+	/* ********************************************************
+	 * The call log is intended as an aid in writing stubs.
+	 * Each test has its own.
+	 * ********************************************************/
+
+	typedef std::vector<std::string>::const_iterator const_iterator;
+	typedef std::vector<std::string>::const_iterator iterator;
+
+	/**
+	 * The calls logged so far by the current test, for use with the
+	 * calledTimes, calledWith and callSequence matchers.
+	 */
+	static CallLog& callLog();
+
+	/**
+	 * Clear the call log.
+	 */
+	static void clearCallLog();
+
+	/**
+	 * Position of oldest logged call, in string form.
+	 */
+	static iterator begin();
+
+	/**
+	 * Position just after the most recently logged call, in string form.
+	 */
+	static iterator end();
+
+	/**
+	 * Log a call to a function.
+	 *
+	 * The arguments are copied into the log in their own types, and
+	 * are only rendered as strings (via operator<<, if they support it)
+	 * when a log entry is displayed.
+	 *
+	 * @param functionName name of the function, copied into the log
+	 * @param args the parameters of the function call
+	 */
+	template <typename... Args>
+	static void logCall (const std::string& functionName, const Args&... args)
+	{
+		callLog().record(functionName.c_str(), true, args...);
+	}
+
+	/**
+	 * As above, for a name given as a string literal, which lasts as
+	 * long as the program and so is not copied.
+	 */
+	template <std::size_t N, typename... Args>
+	static void logCall (const char (&functionName)[N], const Args&... args)
+	{
+		callLog().record(functionName, false, args...);
+	}
+
+	/**
+	 * As above, for a name held in a character buffer, which is copied.
+	 */
+	template <std::size_t N, typename... Args>
+	static void logCall (char (&functionName)[N], const Args&... args)
+	{
+		callLog().record(functionName, true, args...);
+	}
+
+
+	/**
+	 * Counts of hardware events, measured with --counters on Linux.
+	 */
+	struct HardwareCounters {
+		long long cycles; ///< or < 0 if not counted
+		long long instructions;
+		long long cacheMisses;
+		long long branchMisses;
+
+		HardwareCounters (): cycles(-1), instructions(-1), cacheMisses(-1), branchMisses(-1) {}
+
+		bool measured() const
+		{
+			return cycles >= 0 || instructions >= 0 || cacheMisses >= 0 || branchMisses >= 0;
+		}
+	};
+
+	/**
+	 * How long a test took to run.
+	 */
+	struct TestTiming {
+		double wallMS; ///< elapsed (steady clock) time, or < 0 if not measured
+		double cpuMS;  ///< CPU time, or < 0 if not measured
+		HardwareCounters counters;
+		std::string details; ///< further "key: value" lines for the YAML block
+
+		TestTiming (double wall = -1.0, double cpu = -1.0): wallMS(wall), cpuMS(cpu) {}
+	};
+
+	/**
+	 * Time a region of a test, and count its hardware events when run
+	 * with --counters. The regions measured under each label are
+	 * totalled and reported with the test's result.
+	 *
+	 * @param label names the region
+	 * @param region the code to be measured
+	 * @return the time and counts of this run of the region
+	 */
+	static TestTiming measure (const std::string& label, const Callable<void()>& region);
+
+	// These should be private, but I wanted to unit test them.
+	static std::string msgComment (const std::string& commentary);
+	static std::string msgFailed (unsigned testNumber, std::string testName, std::string diagnostics, const TestTiming& timing);
+	static bool debuggerIsRunning();
+
+	/**
+	 * Calibrate, time and report a benchmark as the current test.
+	 * Normally called via UnitBenchmark(...).
+	 *
+	 * @param body the benchmark function
+	 */
+	static void runBenchmark (void (*body)(Benchmark&));
+
+	/**
+	 * The shared instance of a fixture, constructed on the first call.
+	 * Normally used via UnitTestWith(...).
+	 *
+	 * @tparam F a fixture declared by UnitTestFixture(...)
+	 */
+	template <typename F>
+	static const F& fixture ()
+	{
+		const FixtureLock locked;
+		if (FixtureInstance<F>::instance == nullptr) {
+			// Kept for the whole run, not counted against the test.
+			const UncountedAllocations uncounted;
+			FixtureInstance<F>::instance = new F();
+			addFixtureTeardown(&destroyFixture<F>);
+		}
+		return *FixtureInstance<F>::instance;
+	}
+
+	template <typename F>
+	static void prepareFixture ()
+	{
+		fixture<F>();
+	}
+
+	/**
+	 * Check the median time of a call of body against the baseline
+	 * recorded for this test and machine. Normally called via
+	 * assertNoSlowerThanBaseline(...).
+	 *
+	 * @param key names the baseline, among those of the current test
+	 * @param body the code to be timed
+	 * @param tolerance fraction by which the median may exceed the
+	 *        baseline's
+	 */
+	static AssertionResult noSlowerThanBaseline (const std::string& key,
+			const Callable<void()>& body, double tolerance = 0.1);
+
+	/**
+	 * Check that body makes no more than a number of heap allocations.
+	 * Normally called via assertMaxAllocations(...) or
+	 * assertNoAllocations(...).
+	 *
+	 * @param maxAllocations the most allocations allowed
+	 * @param body the code to be checked
+	 */
+	static AssertionResult allocatesAtMost (long maxAllocations,
+			const Callable<void()>& body);
+
+	/**
+	 * Check that body takes no longer than a time limit. Normally called
+	 * via assertCompletesWithin(...).
+	 *
+	 * @param limitNS the limit, in nanoseconds
+	 * @param body the code to be timed
+	 */
+	static AssertionResult completesWithin (double limitNS, const Callable<void()>& body);
+
+	// Should be private, but I wanted to unit test it.
+	static AssertionResult compareToBaseline (const std::string& key,
+			const BenchmarkStatistics& measured, const BenchmarkStatistics& baseline,
+			double tolerance);
+
+	private:
+	/**
+	 * Report a failed assertion (the slow path of checkTest).
+	 *
+	 * @throws UnitTestFailure always
+	 */
+	static void assertionFailed (const AssertionResult& result,
+			const std::string& conditionStr,
+			const char* fileName, int lineNumber);
+
+	/**
+	 * Record a failed expectation (the slow path of checkExpectation).
+	 *
+	 * @throws UnitTestFailure if the test has now failed
+	 *         maxFailedExpectations of them
+	 */
+	static void expectationFailed (const AssertionResult& result,
+			const std::string& conditionStr,
+			const char* fileName, int lineNumber);
+
+	static UnitTestFailure failureOf (const AssertionResult& result,
+			const std::string& conditionStr,
+			const char* fileName, int lineNumber);
+
+	/**
+	 * The state of the test run, and the functions that drive it, which
+	 * are defined in unittest.cpp.
+	 */
+	struct Runner;
+
+	static const Registration* registrations;
+
+	template <typename F>
+	struct FixtureInstance {
+		static F* instance;
+	};
+
+	template <typename F>
+	static void destroyFixture ()
+	{
+		delete FixtureInstance<F>::instance;
+		FixtureInstance<F>::instance = nullptr;
+	}
+
+	// Holds the lock on the fixtures while one is constructed.
+	struct FixtureLock {
+		FixtureLock ();
+		~FixtureLock ();
+		FixtureLock (const FixtureLock&) = delete;
+		FixtureLock& operator= (const FixtureLock&) = delete;
+	};
+
+	static void addFixtureTeardown (void (*teardown)());
+
+	static void msgRunning (unsigned testNumber, std::string testName);
+	static std::string msgPassed (unsigned testNumber, std::string testName, const TestTiming& timing);
+	static std::string msgXPassed (unsigned testNumber, std::string testName, const TestTiming& timing);
+	//static std::string msgFailed (unsigned testNumber, std::string testName, unsigned timeMS);
+	//static std::string msgComment (const std::string& commentary);
+	static std::string msgXFailed (unsigned testNumber, std::string testName, std::string diagnostics, const TestTiming& timing);
+	static std::string msgError (unsigned testNumber, std::string testName, std::string diagnostics, const TestTiming& timing);
+	static std::string msgSkipped (unsigned testNumber, std::string testName);
+	static std::string msgTiming (const TestTiming& timing);
+	static std::string msgSummary ();
+	static std::string msgSlowest ();
+	static void msg (const std::string& detailMessage);
+
+	friend class TapReporter;
+
+};
+
+template <typename F>
+F* UnitTest::FixtureInstance<F>::instance = nullptr;
+
+inline void expectedToFail()
+{
+	UnitTest::expectedToFail();
+}
+
+
+}
+
+
+
+/**
+ * Defined in exactly one source file of a test program (or when
+ * compiling unittest.cpp), before including unittest.h, this replaces
+ * the global operator new and delete with versions that count the
+ * allocations made by each test.
+ */
+#ifdef UNITTEST_COUNT_ALLOCATIONS
+
+void* operator new (std::size_t size)
+{
+	return CppUnitLite::countedAllocate(size, true);
+}
+
+void* operator new[] (std::size_t size)
+{
+	return CppUnitLite::countedAllocate(size, true);
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+	return CppUnitLite::countedAllocate(size, false);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+	return CppUnitLite::countedAllocate(size, false);
+}
+
+void operator delete (void* p) noexcept
+{
+	CppUnitLite::countedFree(p);
+}
+
+void operator delete[] (void* p) noexcept
+{
+	CppUnitLite::countedFree(p);
+}
+
+void operator delete (void* p, const std::nothrow_t&) noexcept
+{
+	CppUnitLite::countedFree(p);
+}
+
+void operator delete[] (void* p, const std::nothrow_t&) noexcept
+{
+	CppUnitLite::countedFree(p);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete (void* p, std::size_t) noexcept
+{
+	CppUnitLite::countedFree(p);
+}
+
+void operator delete[] (void* p, std::size_t) noexcept
+{
+	CppUnitLite::countedFree(p);
+}
+#endif
+
+static const bool unittestCountAllocations = CppUnitLite::enableAllocationCounting();
+
+#endif
+
+#endif
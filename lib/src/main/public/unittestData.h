@@ -0,0 +1,227 @@
+#ifndef UNITTEST_DATA_H
+#define UNITTEST_DATA_H
+
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "unittestCore.h"
+
+
+/**
+ * Registration of a data-driven test, whose body is run on each row,
+ * given as `row`, of a data file. RowType is TextLine (one row per
+ * line), CsvRow, or a trivially copyable struct (one row per record of
+ * sizeof(RowType) bytes). Each row is reported as a TAP subtest.
+ */
+#define UnitTestData(functName, path, RowType) \
+		UnitTestDataTimed(functName, path, RowType, DEFAULT_UNIT_TEST_TIME_LIMIT)
+
+#define UnitTestDataTimed(functName, path, RowType, limit) \
+		void functName(const RowType&); \
+		void functName ## Rows() { CppUnitLite::runDataTest<RowType> \
+			(path, &functName, __FILE__, __LINE__); } \
+		CppUnitLite::UnitTest::Registration functName ## Registration \
+		(#functName, limit, &functName ## Rows, false, false, nullptr, true); \
+		void functName(const RowType& row)
+
+
+
+namespace CppUnitLite {
+
+/* ********************************************************
+ * Rows of data-driven tests
+ * ********************************************************/
+
+/**
+ * A line of text (without its line ending) in the file of a
+ * data-driven test, or a field of such a line. It refers to the
+ * file's contents, which are only kept while the test runs.
+ */
+struct TextLine {
+	const char* text;
+	std::size_t length;
+
+	TextLine (): text(""), length(0) {}
+	TextLine (const char* start, std::size_t len): text(start), length(len) {}
+
+	std::string str() const { return std::string(text, length); }
+	bool operator== (const std::string& s) const
+	{
+		return s.size() == length && s.compare(0, length, text, length) == 0;
+	}
+	bool operator!= (const std::string& s) const { return !(*this == s); }
+};
+
+inline std::ostream& operator<< (std::ostream& out, const TextLine& line)
+{
+	return out.write(line.text, line.length);
+}
+
+/**
+ * A line of comma-separated fields. A field may be enclosed in double
+ * quotes, to hold commas or line breaks; the quotes are not part of the
+ * field, but a doubled quote within it is left doubled.
+ */
+struct CsvRow {
+	std::vector<TextLine> fields;
+
+	std::size_t size() const { return fields.size(); }
+	const TextLine& operator[] (std::size_t i) const { return fields[i]; }
+};
+
+/**
+ * How the rows of each type are read from a data file, in place. By
+ * default, a row is a fixed-size binary record, used where it lies in
+ * the file; a final, partial record is ignored.
+ *
+ * read() returns the row starting at pos, or nullptr if there is none,
+ * and moves pos past it. skip() moves past a row without reading it.
+ */
+template <typename Row>
+struct DataRows {
+	static_assert(std::is_trivially_copyable<Row>::value,
+			"binary records must be trivially copyable");
+
+	static const Row* read (const char*& pos, const char* end, Row&)
+	{
+		if ((std::size_t)(end - pos) < sizeof(Row))
+			return nullptr;
+		const Row* row = reinterpret_cast<const Row*>(pos);
+		pos += sizeof(Row);
+		return row;
+	}
+
+	static bool skip (const char*& pos, const char* end)
+	{
+		Row unused;
+		return read(pos, end, unused) != nullptr;
+	}
+};
+
+template <>
+struct DataRows<TextLine> {
+	static const TextLine* read (const char*& pos, const char* end, TextLine& line)
+	{
+		if (pos >= end)
+			return nullptr;
+		const char* start = pos;
+		const char* newline = (const char*)std::memchr(pos, '\n', end - pos);
+		const char* stop = (newline != nullptr) ? newline : end;
+		pos = (newline != nullptr) ? newline + 1 : end;
+		if (stop > start && stop[-1] == '\r')
+			--stop;
+		line = TextLine(start, stop - start);
+		return &line;
+	}
+
+	static bool skip (const char*& pos, const char* end)
+	{
+		TextLine unused;
+		return read(pos, end, unused) != nullptr;
+	}
+};
+
+template <>
+struct DataRows<CsvRow> {
+	static const CsvRow* read (const char*& pos, const char* end, CsvRow& row);
+	static bool skip (const char*& pos, const char* end);
+};
+
+/**
+ * The file and the results of the rows of a data-driven test, as it
+ * runs. Normally used only via UnitTestData(...).
+ */
+class DataTestRun {
+public:
+	DataTestRun (const char* path, const char* fileName, int lineNumber);
+	~DataTestRun ();
+
+	const char* begin () const { return data; }
+	const char* end () const { return data + size; }
+
+	/// Is this row selected by --rows and by the part being run?
+	bool selects (unsigned long rowNumber) const
+	{
+		return rowNumber >= firstRow && (rowNumber - 1) % parts == part;
+	}
+	bool pastLast (unsigned long rowNumber) const { return rowNumber > lastRow; }
+
+	void start (unsigned long rowNumber);
+	void passed ();
+	void failed (const std::string& explanation);
+
+	/**
+	 * Report the rows, as a TAP subtest of the test.
+	 *
+	 * @throws UnitTestFailure if any of the rows failed
+	 */
+	void finish ();
+
+private:
+	DataTestRun (const DataTestRun&) = delete;
+	DataTestRun& operator= (const DataTestRun&) = delete;
+
+	const char* data;
+	std::size_t size;
+	bool mapped;
+	std::string contents; // read in, where the file cannot be mapped
+	const char* fileName;
+	int lineNumber;
+	unsigned long firstRow;
+	unsigned long lastRow;
+	unsigned long part;
+	unsigned long parts;
+	unsigned long row;
+	unsigned numRun;
+	unsigned numFailed;
+	unsigned expectationsBefore;
+	std::string results;
+};
+
+/**
+ * Run the body of a data-driven test on each of the rows, read
+ * lazily from a memory-mapped file, that --rows and --data-parts
+ * select for this test. Normally called via UnitTestData(...).
+ *
+ * @param path the data file
+ * @param body the test of one row
+ * @param fileName Source code file in which the test is declared,
+ * @param lineNumber Source code line number at which the test is declared,
+ * @throws UnitTestFailure if the file cannot be read or a row fails
+ */
+template <typename Row>
+inline void runDataTest (const char* path, void (*body)(const Row&),
+		const char* fileName, int lineNumber)
+{
+	DataTestRun run (path, fileName, lineNumber);
+	Row scratch;
+	const char* pos = run.begin();
+	for (unsigned long rowNumber = 1;
+			pos < run.end() && !run.pastLast(rowNumber); ++rowNumber)
+	{
+		if (!run.selects(rowNumber)) {
+			if (!DataRows<Row>::skip(pos, run.end()))
+				break;
+			continue;
+		}
+		const Row* row = DataRows<Row>::read(pos, run.end(), scratch);
+		if (row == nullptr)
+			break;
+		run.start(rowNumber);
+		try {
+			body(*row);
+			run.passed();
+		} catch (UnitTest::UnitTestFailure& ex) {
+			run.failed(ex.what());
+		} catch (std::exception& e) {
+			run.failed(std::string("Unexpected error: ") + e.what());
+		}
+	}
+	run.finish();
+}
+
+}
+
+#endif
@@ -0,0 +1,1630 @@
+#ifndef UNITTEST_MATCHERS_H
+#define UNITTEST_MATCHERS_H
+
+/**
+ * The matchers of assertThat and expectThat, and the displayed
+ * representations of the values that they compare.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <tuple>
+#include <unordered_set>
+
+#include "unittestCore.h"
+
+
+namespace CppUnitLite {
+
+
+template <typename T>
+struct has_begin {
+private:
+	template <typename U, class = decltype( std::declval<U&>().begin() ) >
+	static std::true_type try_begin(U&&);
+
+	static std::false_type try_begin(...);
+public:
+	using type = decltype( try_begin( std::declval<T>()));
+    static constexpr bool value = type();
+};
+
+template <typename T>
+struct can_be_written {
+private:
+	template <typename U, class = decltype( std::declval<std::ostringstream&>() << std::declval<U&>()) >
+	static std::true_type try_output(U&&);
+
+	static std::false_type try_output(...);
+public:
+	using type = decltype( try_output( std::declval<T>()));
+    static constexpr bool value = type();
+};
+
+template <typename T>
+struct has_size {
+private:
+	template <typename U, class = decltype( std::declval<U&>().size() ) >
+	static std::true_type try_size(U&&);
+
+	static std::false_type try_size(...);
+public:
+	using type = decltype( try_size( std::declval<T>()));
+    static constexpr bool value = type();
+};
+
+/**
+ * A string stream for building a representation, reused (per thread)
+ * from one getStringRepr call to the next rather than constructed anew.
+ */
+class ReprBuffer {
+public:
+	ReprBuffer();
+	~ReprBuffer();
+	std::ostream& stream() { return *out; }
+	std::string str() const { return out->str(); }
+private:
+	std::ostringstream* out;
+	bool shared;
+	ReprBuffer (const ReprBuffer&) = delete;
+	ReprBuffer& operator= (const ReprBuffer&) = delete;
+};
+
+// Write the displayed representation of a value. Each overload is
+// declared here so that every other can find it, however deeply nested.
+void writeRepr(std::ostream& out, const std::string& t);
+void writeRepr(std::ostream& out, const char* t);
+void writeRepr(std::ostream& out, char t);
+void writeRepr(std::ostream& out, bool t);
+template <typename T, typename U>
+void writeRepr(std::ostream& out, const std::pair<T,U>& t);
+template <typename... T>
+void writeRepr(std::ostream& out, const std::tuple<T...>& t);
+template <typename T>
+void writeRepr(std::ostream& out, const T& t);
+
+template<typename T, typename std::enable_if<can_be_written<T>::value, int>::type = 0>
+void writeRepr2(std::ostream& out, const T& t)
+{
+	out << t;
+}
+
+template<typename T, typename std::enable_if<has_size<const T>::value, int>::type = 0>
+long containerSize(const T& t)
+{
+	return t.size();
+}
+
+template<typename T, typename std::enable_if<!has_size<const T>::value, int>::type = 0>
+long containerSize(const T& t)
+{
+	return std::distance(t.begin(), t.end());
+}
+
+// Only the first ContainerDisplayLimit elements are visited, so the
+// cost does not grow with the size of the container.
+template<typename T, typename std::enable_if<!can_be_written<T>::value && has_begin<const T>::value, int>::type = 0>
+void writeRepr2(std::ostream& out, const T& t)
+{
+	static const unsigned ContainerDisplayLimit = 10;
+	long n = containerSize(t);
+	auto pos = t.begin();
+	unsigned count = 0;
+	out << '[';
+	while (pos != t.end() && n > 0)
+	{
+		writeRepr(out, *pos);
+		if (n > 1)
+			out << ", ";
+		--n;
+		++pos;
+		++count;
+		if (count >= ContainerDisplayLimit && n > 0)
+		{
+			out << "...";
+			break;
+		}
+	}
+	if (n > 0)
+	{
+		out << "... (" << n << " additional elements) ...";
+	}
+	out << ']';
+}
+
+template<typename T, typename std::enable_if<!can_be_written<T>::value && !has_begin<const T>::value, int>::type = 0>
+void writeRepr2(std::ostream& out, const T&)
+{
+	out << "???";
+}
+
+template <typename T, typename U>
+void writeRepr(std::ostream& out, const std::pair<T,U>& t)
+{
+	out << '<';
+	writeRepr(out, t.first);
+	out << ", ";
+	writeRepr(out, t.second);
+	out << '>';
+}
+
+template <typename Tuple, std::size_t size, std::size_t remaining>
+struct getTupleRepr
+{
+	static void write(std::ostream& out, const Tuple& t)  {
+		writeRepr(out, std::get<size-remaining>(t));
+		if (remaining > 1)
+			out << ", ";
+		getTupleRepr<Tuple,size, remaining-1>::write(out, t);
+	}
+};
+
+
+template <typename Tuple, std::size_t size>
+struct getTupleRepr<Tuple, size, 0>
+{
+	static void write(std::ostream&, const Tuple&)  {
+	}
+};
+
+template <typename... T>
+void writeRepr(std::ostream& out, const std::tuple<T...>& t)
+{
+	typedef std::tuple<T...> Tuple;
+	out << '<';
+	getTupleRepr<Tuple,
+		std::tuple_size<Tuple>::value,
+		std::tuple_size<Tuple>::value>::write(out, t);
+	out << '>';
+}
+
+template <typename T>
+void writeRepr(std::ostream& out, const T& t)
+{
+	writeRepr2(out, t);
+}
+
+/**
+ * The representation of a value, as displayed in test explanations.
+ */
+template <typename T>
+std::string getStringRepr(const T& t)
+{
+	ReprBuffer buffer;
+	writeRepr(buffer.stream(), t);
+	return buffer.str();
+}
+
+// Instantiated in unittest.cpp.
+extern template std::string getStringRepr (const int&);
+extern template std::string getStringRepr (const long&);
+extern template std::string getStringRepr (const double&);
+extern template std::string getStringRepr (const std::string&);
+
+
+template <typename T>
+class LoggedValueOf: public LoggedValue {
+	T value;
+public:
+	LoggedValueOf (const T& v): value(v) {}
+
+	const std::type_info& type() const override { return typeid(T); }
+	const void* address() const override { return &value; }
+	void write (std::ostream& out) const override { writeRepr(out, value); }
+};
+
+
+// Compile-time test for associative containers
+inline constexpr auto container_has_keytype_impl(...)
+    -> std::false_type
+{ return std::false_type{}; }
+
+template <typename C, typename = typename C::key_type>
+constexpr auto container_has_keytype_impl(C const*) -> std::true_type {
+    return std::true_type{};
+}
+
+template <typename C>
+constexpr auto container_has_keytype(C const& c)
+    -> decltype(container_has_keytype_impl(&c))
+{
+    return container_has_keytype_impl(&c);
+}
+
+
+template <typename Container, typename Element>
+long find_in_container_impl (const Container& c, const Element& e, std::false_type)
+{
+	long ctr = 0L;
+	for (auto it = c.begin(); it != c.end(); ++it)
+	{
+		if (e == *it)
+			return ctr;
+		++ctr;
+	}
+	return -1L;
+}
+
+template <typename Container, typename Element>
+long find_in_container_impl (const Container& c, const Element& e, std::true_type)
+{
+	auto pos = c.find(e);
+	if (c.find(e) != c.end())
+		return (long)distance(c.begin(), pos);
+	else
+		return -1L;
+}
+
+template <typename Container, typename Element>
+long find_in_container (const Container& c, const Element& e)
+{
+	return find_in_container_impl (c, e, container_has_keytype(c));
+}
+
+
+
+//// Relational Matchers
+
+template <typename T>
+class EqualToMatcher {
+	const T right;
+public:
+	EqualToMatcher (const T& t)
+	: right(t) {}
+
+	/**
+	 * Evaluate the condition denoted by this matcher.
+	 */
+	AssertionResult eval(const T& left) const;
+};
+
+template <typename T>
+AssertionResult EqualToMatcher<T>::eval(const T& left) const
+{
+	return AssertionResult(left == right,
+			[this, &left] (bool passed) {
+				if (passed)
+					return "Both values were: " + getStringRepr(left);
+				else
+					return "Expected: " + getStringRepr(right)
+							+ "\n\tObserved: " + getStringRepr(left);
+			});
+}
+
+template <typename T, typename U>
+class ApproximatelyEqualToMatcher {
+	const T right;
+	const U delta;
+public:
+	ApproximatelyEqualToMatcher (const T& t, const U& d): right(t), delta(d) {}
+	AssertionResult eval(const T& left) const {
+		return AssertionResult(!(left < right - delta || left > right + delta),
+				[this, &left] (bool passed) {
+					std::string leftStr = CppUnitLite::getStringRepr(left);
+					if (passed)
+						return leftStr + " is between " + getStringRepr(right-delta)
+								+ " and " + getStringRepr(right+delta);
+					else
+						return leftStr + " is outside the range "
+								+ getStringRepr(right-delta)
+								+ " .. "
+								+ getStringRepr(right+delta);
+				});
+	}
+};
+
+template <typename T>
+class NotEqualToMatcher {
+	const T right;
+public:
+	NotEqualToMatcher (const T& t): right(t) {}
+	AssertionResult eval(const T& left) const;
+};
+
+template <typename T>
+AssertionResult NotEqualToMatcher<T>::eval(const T& left) const
+{
+	return AssertionResult(!(left == right),
+			[this, &left] (bool passed) {
+				if (passed)
+					return "Expected: " + getStringRepr(right)
+							+ "\n\tObserved: " + getStringRepr(left);
+				else
+					return "Both values were: " + getStringRepr(left);
+			});
+}
+
+// The commonest comparisons are instantiated once, in unittest.cpp,
+// rather than in every test source that makes them.
+extern template class EqualToMatcher<int>;
+extern template class EqualToMatcher<long>;
+extern template class EqualToMatcher<double>;
+extern template class EqualToMatcher<std::string>;
+extern template class NotEqualToMatcher<int>;
+extern template class NotEqualToMatcher<long>;
+extern template class NotEqualToMatcher<double>;
+extern template class NotEqualToMatcher<std::string>;
+
+template <typename T>
+class LessThanMatcher {
+	const T right;
+public:
+	LessThanMatcher (const T& t): right(t) {}
+	AssertionResult eval(const T& left) const {
+		return AssertionResult(left < right,
+				[this, &left] (bool passed) {
+					return getStringRepr(left)
+							+ (passed ? " is less than " : " is not less than ")
+							+ getStringRepr(right);
+				});
+	}
+};
+
+template <typename T>
+class GreaterThanMatcher {
+	const T right;
+public:
+	GreaterThanMatcher (const T& t): right(t) {}
+	AssertionResult eval(const T& left) const {
+		return AssertionResult(right < left,
+				[this, &left] (bool passed) {
+					return getStringRepr(left)
+							+ (passed ? " is greater than " : " is not greater than ")
+							+ getStringRepr(right);
+				});
+	}
+};
+
+template <typename T>
+class LessThanOrEqualToMatcher {
+	const T right;
+public:
+	LessThanOrEqualToMatcher (const T& t): right(t) {}
+	AssertionResult eval(const T& left) const {
+		return AssertionResult(!(right < left),
+				[this, &left] (bool passed) {
+					return getStringRepr(left)
+							+ (passed ? " is less than or equal to " : " is greater than ")
+							+ getStringRepr(right);
+				});
+	}
+};
+
+
+template <typename T>
+class GreaterThanOrEqualToMatcher {
+	const T right;
+public:
+	GreaterThanOrEqualToMatcher (const T& t): right(t) {}
+	AssertionResult eval(const T& left) const {
+		return AssertionResult(!(left < right),
+				[this, &left] (bool passed) {
+					return getStringRepr(left)
+							+ (passed ? " is greater than or equal to " : " is less than ")
+							+ getStringRepr(right);
+				});
+	}
+};
+
+//// String Matchers
+
+class StringContainsMatcher {
+	const std::string right;
+public:
+	StringContainsMatcher (const std::string& t);
+	AssertionResult eval(const std::string& e) const;
+};
+
+class StringEndsWithMatcher {
+	const std::string right;
+public:
+	StringEndsWithMatcher (const std::string& t);
+	AssertionResult eval(const std::string& e) const;
+};
+
+class StringBeginsWithMatcher {
+	const std::string right;
+public:
+	StringBeginsWithMatcher (const std::string& t);
+	AssertionResult eval(const std::string& e) const;
+};
+
+
+// Pointer Matchers
+
+class NullMatcher {
+public:
+	AssertionResult eval(const void* p) const;
+};
+
+class NotNullMatcher {
+public:
+	AssertionResult eval(const void* p) const;
+};
+
+
+//// Container Matchers
+
+
+
+
+template <typename Element>
+class ContainsMatcher {
+	Element right;
+public:
+	ContainsMatcher (Element e) : right(e) {}
+
+	template <typename Container>
+	AssertionResult eval(const Container& c) const {
+		return AssertionResult(find_in_container(c, right) >= 0,
+				[this, &c] (bool passed) {
+					std::string containerStr = CppUnitLite::getStringRepr(c);
+					std::string rightStr = CppUnitLite::getStringRepr(right);
+					if (passed)
+						return "Found " + rightStr + " in position "
+								+ getStringRepr(find_in_container(c, right))
+								+ " of " + containerStr;
+					else
+						return "Could not find " + rightStr + " in " + containerStr;
+				});
+	}
+
+};
+
+
+
+
+template <typename Key, typename Data>
+class HasEntryMatcher {
+	Key key;
+	Data data;
+public:
+	HasEntryMatcher (const Key& k, const Data& d) : key(k), data(d) {}
+
+	template <typename Container>
+	AssertionResult eval(const Container& c) const {
+		auto pos = c.find(key);
+		return AssertionResult(pos != c.end() && data == pos->second,
+				[this, &c] (bool passed) {
+					std::string containerStr = CppUnitLite::getStringRepr(c);
+					std::string keyStr = CppUnitLite::getStringRepr(key);
+					auto pos = c.find(key);
+					if (pos == c.end())
+						return "Could not find " + keyStr + " in " + containerStr;
+					else if (passed)
+						return "Found " + getStringRepr(*pos)
+								+ " in " + containerStr;
+					else
+						return "Could not find <" + keyStr + ", " + getStringRepr(data)
+								+ "> in " + containerStr;
+				});
+	}
+
+};
+
+
+
+
+template <typename Iterator>
+class IteratorRange {
+	Iterator start;
+	Iterator stop;
+public:
+	typedef Iterator iterator;
+	typedef Iterator const_iterator;
+
+	IteratorRange (Iterator b, Iterator e): start(b), stop(e) {}
+
+	Iterator begin() const { return start; }
+	Iterator end() const { return stop; }
+};
+
+/**
+ * A range that the test writer promises is sorted (by operator<), so
+ * that it can be searched by bisection instead of element by element.
+ */
+template <typename Iterator>
+class SortedRange: public IteratorRange<Iterator> {
+public:
+	SortedRange (Iterator b, Iterator e): IteratorRange<Iterator>(b, e) {}
+};
+
+template <typename Iterator, typename Element>
+long find_in_container (const SortedRange<Iterator>& c, const Element& e)
+{
+	Iterator pos = std::lower_bound(c.begin(), c.end(), e);
+	if (pos != c.end() && e == *pos)
+		return (long)std::distance(c.begin(), pos);
+	else
+		return -1L;
+}
+
+template <typename T, typename = void>
+struct is_hashable: std::false_type {};
+
+template <typename T>
+struct is_hashable<T, decltype((void)std::hash<T>()(std::declval<const T&>()))>
+	: std::true_type {};
+
+template <typename C>
+struct is_sorted_range: std::false_type {};
+
+template <typename Iterator>
+struct is_sorted_range<SortedRange<Iterator>>: std::true_type {};
+
+// Below this many items, searching for each one separately is cheaper
+// than building a hash table.
+static const std::size_t HashingThreshold = 8;
+
+// Can the items be found by hashing both sides, rather than by searching
+// the container once per item?
+template <typename Container, typename Element>
+struct can_hash_items {
+	using ContainerElement = typename std::decay<
+			decltype(*std::declval<const Container&>().begin())>::type;
+	static constexpr bool value = std::is_same<ContainerElement, Element>::value
+			&& is_hashable<Element>::value
+			&& !is_sorted_range<Container>::value
+			&& !decltype(container_has_keytype(std::declval<const Container&>()))::value;
+};
+
+// Position within items of the first one that is not in c, or -1 if
+// all are present. A hash set is built over whichever side is smaller.
+template <typename Container, typename Items,
+	typename std::enable_if<can_hash_items<Container, typename Items::value_type>::value, int>::type = 0>
+long find_first_missing (const Container& c, const Items& items)
+{
+	using Element = typename Items::value_type;
+	const std::size_t m = items.size();
+	long i = 0L;
+	if (m < HashingThreshold)
+	{
+		for (auto it = items.begin(); it != items.end(); ++it, ++i)
+			if (find_in_container(c, *it) < 0L)
+				return i;
+		return -1L;
+	}
+	if ((std::size_t)std::distance(c.begin(), c.end()) < m)
+	{
+		std::unordered_set<Element> present (c.begin(), c.end());
+		for (auto it = items.begin(); it != items.end(); ++it, ++i)
+			if (present.count(*it) == 0)
+				return i;
+		return -1L;
+	}
+	std::unordered_set<Element> wanted (items.begin(), items.end());
+	for (auto it = c.begin(); it != c.end() && wanted.size() > 0; ++it)
+		wanted.erase(*it);
+	for (auto it = items.begin(); it != items.end(); ++it, ++i)
+		if (wanted.count(*it) > 0)
+			return i;
+	return -1L;
+}
+
+template <typename Container, typename Items,
+	typename std::enable_if<!can_hash_items<Container, typename Items::value_type>::value, int>::type = 0>
+long find_first_missing (const Container& c, const Items& items)
+{
+	long i = 0L;
+	for (auto it = items.begin(); it != items.end(); ++it, ++i)
+		if (find_in_container(c, *it) < 0L)
+			return i;
+	return -1L;
+}
+
+template <typename Items>
+class HasItemsMatcherBase {
+protected:
+	template <typename Container>
+	AssertionResult evalItems (const Container& c, const Items& items) const
+	{
+		long missing = find_first_missing(c, items);
+		return AssertionResult(missing < 0L,
+				[&items, &c, missing] (bool passed) {
+					std::string cStr = getStringRepr(c);
+					if (!passed)
+						return "Did not find " + getStringRepr(*std::next(items.begin(), missing))
+								+ " in " + cStr;
+					return "Found all of " + getStringRepr(items) + " in " + cStr;
+				});
+	}
+};
+
+template <typename... Ts>
+class HasItemsMatcher: HasItemsMatcherBase<std::vector<typename std::common_type<Ts...>::type>> {
+	using Element = typename std::common_type<Ts...>::type;
+    typename std::vector<Element> right;
+public:
+    HasItemsMatcher (Ts... ts): right({ts...})
+	{ }
+
+    template <typename Container>
+    AssertionResult eval (const Container& c) const
+    {
+    	return this->evalItems(c, right);
+    }
+};
+
+template <typename Items>
+class HasItemsFromMatcher: HasItemsMatcherBase<Items> {
+	const Items& right;
+public:
+	HasItemsFromMatcher (const Items& items): right(items)
+	{ }
+
+	template <typename Container>
+	AssertionResult eval (const Container& c) const
+	{
+		return this->evalItems(c, right);
+	}
+};
+
+
+template <typename Iterator1>
+class MatchesMatcher {
+	const IteratorRange<Iterator1> range1;
+
+	/**
+	 * @return the position of the first pair of unequal elements,
+	 *         or -1 if there are none.
+	 */
+	template <typename Iterator2>
+	long firstMismatch(const IteratorRange<Iterator2>& range2) const {
+		long ctr = 0L;
+		Iterator1 pos1 = range1.begin();
+		Iterator2 pos2 = range2.begin();
+		while (pos1 != range1.end())
+		{
+			if (!(*pos1 == *pos2))
+				return ctr;
+			++pos1;
+			++pos2;
+			++ctr;
+		}
+		return -1L;
+	}
+
+public:
+	MatchesMatcher (IteratorRange<Iterator1> r1) : range1(r1) {}
+
+	template <typename Iterator2>
+	AssertionResult eval(const IteratorRange<Iterator2>& range2) const {
+		auto d1 = std::distance(range1.begin(), range1.end());
+		auto d2 = std::distance(range2.begin(), range2.end());
+		return AssertionResult(d1 == d2 && firstMismatch(range2) < 0L,
+				[this, &range2] (bool passed) {
+					auto d1 = std::distance(range1.begin(), range1.end());
+					auto d2 = std::distance(range2.begin(), range2.end());
+					long pos = (d1 == d2) ? firstMismatch(range2) : -1L;
+					if (passed)
+						return std::string("All corresponding elements were equal.");
+					else if (d1 != d2)
+						return "Ranges are of different length (" + getStringRepr(d1)
+								+ " and " + getStringRepr(d2) + ")";
+					else if (pos >= 0L)
+					{
+						Iterator1 pos1 = range1.begin();
+						Iterator2 pos2 = range2.begin();
+						std::advance(pos1, pos);
+						std::advance(pos2, pos);
+						return "In position " + getStringRepr(pos)
+								+ ", " + getStringRepr(*pos1)
+								+ " != " + getStringRepr(*pos2);
+					}
+					else
+						return std::string();
+				});
+	}
+};
+
+
+/**
+ * Tolerances for comparing numeric sequences element by element.
+ *
+ * Two elements match if they are equal, or if their difference is no more
+ * than the absolute tolerance or than the relative tolerance times the
+ * larger of their magnitudes.  If ulps is non-negative, elements match
+ * instead if they are no more than that many representable values apart.
+ * NaN never matches anything.
+ */
+struct ElementTolerance {
+	double absolute;
+	double relative;
+	long long ulps;
+
+	ElementTolerance (double abs = 0.0, double rel = 0.0, long long u = -1LL)
+	: absolute(abs), relative(rel), ulps(u) {}
+
+	bool exact() const { return absolute == 0.0 && relative == 0.0 && ulps < 0LL; }
+
+	std::string description() const;
+};
+
+/**
+ * Summary of an element-by-element comparison of two numeric sequences.
+ * The error of a mismatch is the absolute difference of the elements
+ * or, when comparing by ULPs, their distance in ULPs.
+ */
+struct ElementComparison {
+	std::size_t compared;
+	std::size_t mismatches;
+	std::size_t firstMismatch;
+	std::size_t worstMismatch;
+	double maxError;
+
+	ElementComparison (std::size_t n = 0)
+	: compared(n), mismatches(0), firstMismatch(0), worstMismatch(0),
+	  maxError(0.0) {}
+
+	void recordMismatch (std::size_t pos, double error);
+};
+
+/**
+ * Check a single pair of elements against a tolerance.
+ *
+ * @param error set to the error of a non-equal pair
+ * @return true iff the elements match
+ */
+bool elementMatches (double actual, double expected,
+		const ElementTolerance& tolerance, double& error);
+bool elementMatches (float actual, float expected,
+		const ElementTolerance& tolerance, double& error);
+
+/**
+ * Compare two contiguous arrays of n elements.  Uses SSE2/AVX or NEON,
+ * where available, to count the mismatches, and only examines the
+ * mismatching elements one at a time if there are any.
+ */
+ElementComparison compareElements (const double* actual, const double* expected,
+		std::size_t n, const ElementTolerance& tolerance);
+ElementComparison compareElements (const float* actual, const float* expected,
+		std::size_t n, const ElementTolerance& tolerance);
+
+/**
+ * Compare two sequences of n elements of any arithmetic types
+ * one element at a time.
+ */
+template <typename Iterator1, typename Iterator2>
+ElementComparison compareElementsOneByOne (Iterator1 actual, Iterator2 expected,
+		std::size_t n, const ElementTolerance& tolerance)
+{
+	typedef typename std::iterator_traits<Iterator1>::value_type T1;
+	typedef typename std::iterator_traits<Iterator2>::value_type T2;
+	typedef typename std::conditional<std::is_same<T1, float>::value
+		&& std::is_same<T2, float>::value, float, double>::type Scalar;
+	ElementComparison summary(n);
+	for (std::size_t i = 0; i < n; ++i, ++actual, ++expected)
+	{
+		if (*actual == *expected)
+			continue;
+		double error = 0.0;
+		if (!elementMatches(static_cast<Scalar>(*actual),
+				static_cast<Scalar>(*expected), tolerance, error)
+				|| tolerance.exact())
+			summary.recordMismatch(i, error);
+	}
+	return summary;
+}
+
+// The start of the elements of an array range or a contiguous container.
+template <typename T>
+const T* contiguousData (const IteratorRange<T*>& r)
+{
+	return r.begin();
+}
+
+template <typename T>
+const T* contiguousData (const IteratorRange<const T*>& r)
+{
+	return r.begin();
+}
+
+template <typename C>
+auto contiguousData (const C& c) -> decltype(c.data())
+{
+	return c.data();
+}
+
+template <typename C, typename = void>
+struct contiguous_element {
+	typedef void type;
+};
+
+template <typename C>
+struct contiguous_element<C, decltype((void)contiguousData(std::declval<const C&>()))> {
+	typedef typename std::remove_cv<typename std::remove_pointer<
+		decltype(contiguousData(std::declval<const C&>()))>::type>::type type;
+};
+
+/**
+ * True if two sequence types can be compared by the vectorized kernels:
+ * both contiguous, with the same floating point element type.
+ */
+template <typename C1, typename C2>
+struct can_compare_in_bulk {
+	typedef typename contiguous_element<C1>::type E1;
+	typedef typename contiguous_element<C2>::type E2;
+	static const bool value = std::is_same<E1, E2>::value
+		&& (std::is_same<E1, float>::value || std::is_same<E1, double>::value);
+};
+
+template <typename C1, typename C2,
+	typename std::enable_if<can_compare_in_bulk<C1, C2>::value, int>::type = 0>
+ElementComparison compareSequences (const C1& actual, const C2& expected,
+		std::size_t n, const ElementTolerance& tolerance)
+{
+	return compareElements(contiguousData(actual), contiguousData(expected),
+		n, tolerance);
+}
+
+template <typename C1, typename C2,
+	typename std::enable_if<!can_compare_in_bulk<C1, C2>::value, int>::type = 0>
+ElementComparison compareSequences (const C1& actual, const C2& expected,
+		std::size_t n, const ElementTolerance& tolerance)
+{
+	return compareElementsOneByOne(actual.begin(), expected.begin(), n, tolerance);
+}
+
+template <typename C>
+struct is_iterator_range: std::false_type {};
+
+template <typename Iterator>
+struct is_iterator_range<IteratorRange<Iterator>>: std::true_type {};
+
+template <typename Iterator>
+struct is_iterator_range<SortedRange<Iterator>>: std::true_type {};
+
+/**
+ * Compares numeric sequences element by element, reporting only a
+ * summary of the mismatches rather than one message per element.
+ */
+template <typename Expected>
+class ElementwiseMatcher {
+	// A range is only a pair of iterators, and is often a temporary.
+	typename std::conditional<is_iterator_range<Expected>::value,
+		const Expected, const Expected&>::type expected;
+	const ElementTolerance tolerance;
+
+	template <typename Sequence>
+	static std::string elementAt (const Sequence& s, std::size_t pos)
+	{
+		auto it = s.begin();
+		std::advance(it, pos);
+		std::ostringstream out;
+		out.precision(17);
+		out << *it;
+		return out.str();
+	}
+
+	// Nothing is compared unless the sequences are of the same length.
+	template <typename Actual>
+	ElementComparison compare (const Actual& actual, bool& sameLength) const
+	{
+		long n = containerSize(actual);
+		sameLength = n == containerSize(expected);
+		if (!sameLength)
+			return ElementComparison(0);
+		return compareSequences(actual, expected, (std::size_t)n, tolerance);
+	}
+
+	// Compares the sequences again, since explanations are rarely wanted.
+	template <typename Actual>
+	std::string explain (const Actual& actual, bool passed) const
+	{
+		long n1 = containerSize(actual);
+		long n2 = containerSize(expected);
+		if (n1 != n2)
+			return "Sequences are of different length (" + getStringRepr(n1)
+					+ " and " + getStringRepr(n2) + ")";
+		bool sameLength;
+		ElementComparison summary = compare(actual, sameLength);
+		if (passed)
+			return "All " + getStringRepr(summary.compared)
+					+ " elements matched " + tolerance.description();
+		std::string units = (tolerance.ulps >= 0LL) ? " ULPs" : "";
+		return getStringRepr(summary.mismatches) + " of "
+			+ getStringRepr(summary.compared)
+			+ " elements did not match " + tolerance.description()
+			+ ": first in position " + getStringRepr(summary.firstMismatch)
+			+ " (" + elementAt(actual, summary.firstMismatch)
+			+ " vs " + elementAt(expected, summary.firstMismatch)
+			+ "), worst in position " + getStringRepr(summary.worstMismatch)
+			+ " (" + elementAt(actual, summary.worstMismatch)
+			+ " vs " + elementAt(expected, summary.worstMismatch)
+			+ "), max error " + getStringRepr(summary.maxError) + units;
+	}
+
+public:
+	ElementwiseMatcher (const Expected& e, const ElementTolerance& t)
+	: expected(e), tolerance(t) {}
+
+	template <typename Actual>
+	AssertionResult eval(const Actual& actual) const {
+		bool sameLength;
+		ElementComparison summary = compare(actual, sameLength);
+		return AssertionResult(sameLength && summary.mismatches == 0,
+				[this, &actual] (bool passed) { return explain(actual, passed); });
+	}
+};
+
+
+template <typename Container>
+class IsInMatcher {
+	// A sorted range is only a pair of iterators, and is often a temporary.
+	typename std::conditional<is_sorted_range<Container>::value,
+		const Container, const Container&>::type container;
+public:
+	IsInMatcher (const Container& c) : container(c) {}
+
+	template <typename Element>
+	AssertionResult eval(const Element& e) const {
+		return AssertionResult(find_in_container(container, e) >= 0L,
+				[this, &e] (bool passed) {
+					std::string cStr = getStringRepr(container);
+					std::string eStr = getStringRepr(e);
+					if (passed)
+						return "Found " + eStr + " in postion "
+								+ getStringRepr(find_in_container(container, e))
+								+ " of " + cStr;
+					else
+						return "Could not find " + eStr + " in " + cStr;
+				});
+	}
+
+};
+
+
+
+
+
+template <typename Iterator>
+class IsInRangeMatcher {
+	Iterator start;
+	Iterator stop;
+public:
+	IsInRangeMatcher (Iterator b, Iterator e) : start(b), stop(e) {}
+
+	template <typename Element>
+	AssertionResult eval(const Element& e) const {
+		return AssertionResult (std::find(start, stop, e) != stop,
+				[this, &e] (bool passed) {
+					std::string eStr = getStringRepr(e);
+					if (passed)
+						return "Found " + eStr + " in range, "
+								+ getStringRepr(std::distance(start, std::find(start, stop, e)))
+								+ " steps from the start";
+					else
+						return "Could not find " + eStr + " in the range";
+				});
+	}
+
+};
+
+
+
+
+
+//// Call Log Matchers
+
+inline bool sameLoggedValue (const char* logged, const char* expected)
+{
+	return std::strcmp(logged, expected) == 0;
+}
+
+template <typename T>
+bool sameLoggedValue (const T& logged, const T& expected)
+{
+	return logged == expected;
+}
+
+// Compare a logged argument with an expected value: by == if it was
+// logged in the same type, otherwise by their string forms.
+template <typename T>
+bool loggedValueEquals (const LoggedValue& logged, const T& expected)
+{
+	typedef typename logged_type<T>::type Stored;
+	const Stored& e = expected;
+	if (logged.type() == typeid(Stored))
+		return sameLoggedValue(*static_cast<const Stored*>(logged.address()), e);
+	return logged.str() == getStringRepr(e);
+}
+
+template <typename Tuple, std::size_t index, std::size_t remaining>
+struct loggedArgumentsEqual
+{
+	static bool check (const LoggedCall& call, const Tuple& expected)  {
+		return loggedValueEquals(*call.arguments[index], std::get<index>(expected))
+			&& loggedArgumentsEqual<Tuple, index+1, remaining-1>::check(call, expected);
+	}
+};
+
+template <typename Tuple, std::size_t index>
+struct loggedArgumentsEqual<Tuple, index, 0>
+{
+	static bool check (const LoggedCall&, const Tuple&)  {
+		return true;
+	}
+};
+
+/**
+ * A call expected in the call log: a function name and, unless only the
+ * name was given, its arguments.
+ */
+class ExpectedCall {
+	std::string function;
+	Callable<bool(const LoggedCall&)> argumentsMatch; // empty: any will do
+	Callable<std::string()> describeArguments;
+public:
+	ExpectedCall (const char* f): function(f) {}
+	ExpectedCall (const std::string& f): function(f) {}
+
+	template <typename... Args>
+	ExpectedCall (const std::string& f, const std::tuple<Args...>& args)
+	: function(f)
+	{
+		typedef std::tuple<Args...> Tuple;
+		argumentsMatch = [args] (const LoggedCall& call) {
+			return call.numArguments == sizeof...(Args)
+				&& loggedArgumentsEqual<Tuple, 0, sizeof...(Args)>::check(call, args);
+		};
+		describeArguments = [args] () {
+			std::ostringstream out;
+			out << '(';
+			getTupleRepr<Tuple, sizeof...(Args), sizeof...(Args)>::write(out, args);
+			out << ')';
+			return out.str();
+		};
+	}
+
+	bool matches (const LoggedCall& call) const
+	{
+		return function == call.function
+			&& (argumentsMatch == nullptr || argumentsMatch(call));
+	}
+
+	const std::string& functionName() const { return function; }
+
+	/**
+	 * @return the call in the form f(a, b), or just f if any arguments
+	 *         will do
+	 */
+	std::string str() const
+	{
+		return (describeArguments == nullptr) ? function : function + describeArguments();
+	}
+};
+
+/**
+ * Up to 10 of the logged calls to a function (to any function, if
+ * function is empty), for explanations.
+ */
+std::string describeCalls (const CallLog& log, const std::string& function);
+
+class CalledTimesMatcher {
+	const ExpectedCall expected;
+	const std::size_t times;
+public:
+	CalledTimesMatcher (const ExpectedCall& call, std::size_t n)
+	: expected(call), times(n) {}
+
+	AssertionResult eval (const CallLog& log) const;
+};
+
+class CalledWithMatcher {
+	const ExpectedCall expected;
+public:
+	CalledWithMatcher (const ExpectedCall& call): expected(call) {}
+
+	AssertionResult eval (const CallLog& log) const;
+};
+
+class CallSequenceMatcher {
+	const std::vector<ExpectedCall> sequence;
+public:
+	CallSequenceMatcher (const std::vector<ExpectedCall>& calls): sequence(calls) {}
+
+	AssertionResult eval (const CallLog& log) const;
+};
+
+
+
+
+//// Boolean Matchers
+
+template <typename T>
+class NotMatcher {
+	T right;
+public:
+	NotMatcher (const T& t): right(t) {}
+	template <typename U>
+	AssertionResult eval(const U& u) const {
+		return right.eval(u).negated();
+	}
+};
+
+
+template <typename... Rest>
+class AllOfMatcher {
+public:
+    AllOfMatcher (Rest... matchers)
+	{ }
+
+    template <typename T>
+    AssertionResult eval (const T& t) const
+    {
+    	return AssertionResult(true, "", "");
+    }
+};
+template <typename Matcher, typename... Rest>
+class AllOfMatcher<Matcher, Rest...> {
+	Matcher matcher;
+    AllOfMatcher<Rest...> rest;
+public:
+    AllOfMatcher (Matcher m, Rest... matchers): matcher(m), rest(matchers...)
+	{ }
+
+    template <typename T>
+    AssertionResult eval (const T& t) const
+    {
+    	AssertionResult result1 = matcher.eval(t);
+    	if (result1.result)
+    	    return rest.eval(t);
+    	else
+    		return result1;
+    }
+};
+
+
+
+template <typename... Rest>
+class AnyOfMatcher {
+public:
+    AnyOfMatcher (Rest... matchers)
+	{ }
+
+    template <typename T>
+    AssertionResult eval (const T& t) const
+    {
+    	return AssertionResult(false, "", "");
+    }
+};
+template <typename Matcher, typename... Rest>
+class AnyOfMatcher<Matcher, Rest...> {
+	Matcher matcher;
+    AnyOfMatcher<Rest...> rest;
+public:
+    AnyOfMatcher (Matcher m, Rest... matchers): matcher(m), rest(matchers...)
+	{ }
+
+    template <typename T>
+    AssertionResult eval (const T& t) const
+    {
+    	AssertionResult result1 = matcher.eval(t);
+    	if (!result1.result)
+    			return rest.eval(t);
+    	else
+    		return result1;
+    }
+};
+
+
+
+// Membership test over a fixed list of items. A single lookup is a
+// plain search; only a matcher that is evaluated again, e.g. one kept
+// and reused over many values, builds a hash set of a long list of
+// hashable items.
+template <typename Element, bool = is_hashable<Element>::value>
+class ItemLookup {
+	mutable std::atomic<unsigned> lookups;
+	mutable std::shared_ptr<const std::unordered_set<Element>> hashed;
+public:
+	ItemLookup (): lookups(0) {}
+	ItemLookup (const ItemLookup& other)
+		: lookups(other.lookups.load()), hashed(std::atomic_load(&other.hashed))
+	{}
+
+	bool contains (const std::vector<Element>& items, const Element& left) const
+	{
+		std::shared_ptr<const std::unordered_set<Element>> set = std::atomic_load(&hashed);
+		if (set == nullptr && items.size() >= HashingThreshold && lookups.fetch_add(1) > 0)
+		{
+			set = std::make_shared<const std::unordered_set<Element>>(items.begin(), items.end());
+			std::atomic_store(&hashed, set);
+		}
+		if (set != nullptr)
+			return set->count(left) > 0;
+		for (const Element& e: items)
+			if (left == e) return true;
+		return false;
+	}
+};
+
+template <typename Element>
+class ItemLookup<Element, false> {
+public:
+	bool contains (const std::vector<Element>& items, const Element& left) const
+	{
+		for (const Element& e: items)
+			if (left == e) return true;
+		return false;
+	}
+};
+
+template <typename... T>
+class OneOfMatcher {
+	using Element = typename std::common_type<T...>::type;
+    typename std::vector<Element> right;
+    ItemLookup<Element> lookup;
+public:
+    OneOfMatcher (T... t): right({std::forward<T>(t)...})
+	{ }
+
+    AssertionResult eval (const Element& left) const
+    {
+    	auto explainer = [this, &left] (bool passed) {
+    		std::string leftStr = CppUnitLite::getStringRepr(left);
+    		std::string rightStr = CppUnitLite::getStringRepr(right);
+    		if (passed)
+    			return "Found " + leftStr + " in " + rightStr;
+    		else
+    			return "Could not find " + leftStr + " in " + rightStr;
+    	};
+    	return AssertionResult(lookup.contains(right, left), explainer);
+    }
+};
+
+
+}
+
+
+
+////  Matchers
+
+
+/// Relational Matchers
+
+inline CppUnitLite::EqualToMatcher<std::string>
+isEqualTo(const char* t)
+{
+	return CppUnitLite::EqualToMatcher<std::string>(std::string(t));
+}
+
+template <typename T>
+CppUnitLite::EqualToMatcher<T>
+isEqualTo(const T& t)
+{
+	return CppUnitLite::EqualToMatcher<T>(t);
+}
+
+inline CppUnitLite::EqualToMatcher<std::string>
+is(const char* t)
+{
+	return CppUnitLite::EqualToMatcher<std::string>(std::string(t));
+}
+
+template <typename T>
+CppUnitLite::EqualToMatcher<T>
+is(const T& t)
+{
+	return CppUnitLite::EqualToMatcher<T>(t);
+}
+
+template <typename T, typename U>
+CppUnitLite::ApproximatelyEqualToMatcher<T,U>
+isApproximately(const T& t, const U& delta)
+{
+	return CppUnitLite::ApproximatelyEqualToMatcher<T,U>(t, delta);
+}
+
+inline CppUnitLite::NotEqualToMatcher<std::string>
+isNotEqualTo(const char* t)
+{
+	return CppUnitLite::NotEqualToMatcher<std::string>(std::string(t));
+}
+
+template <typename T>
+CppUnitLite::NotEqualToMatcher<T>
+isNotEqualTo(const T& t)
+{
+	return CppUnitLite::NotEqualToMatcher<T>(t);
+}
+
+inline CppUnitLite::NotEqualToMatcher<std::string>
+isNot(const char* t)
+{
+	return CppUnitLite::NotEqualToMatcher<std::string>(std::string(t));
+}
+
+template <typename T>
+CppUnitLite::NotEqualToMatcher<T>
+isNot(const T& t)
+{
+	return CppUnitLite::NotEqualToMatcher<T>(t);
+}
+
+inline CppUnitLite::LessThanMatcher<std::string> \
+isLessThan(const char* t)
+{
+	return CppUnitLite::LessThanMatcher<std::string>(std::string(t));
+}
+
+template <typename T>
+CppUnitLite::LessThanMatcher<T> isLessThan(const T& t)
+{
+	return CppUnitLite::LessThanMatcher<T>(t);
+}
+
+inline CppUnitLite::GreaterThanMatcher<std::string>
+isGreaterThan(const char* t)
+{
+	return CppUnitLite::GreaterThanMatcher<std::string>(std::string(t));
+}
+
+template <typename T>
+CppUnitLite::GreaterThanMatcher<T>
+isGreaterThan(const T& t)
+{
+	return CppUnitLite::GreaterThanMatcher<T>(t);
+}
+
+inline CppUnitLite::LessThanOrEqualToMatcher<std::string>
+isLessThanOrEqualTo(const char* t)
+{
+	return CppUnitLite::LessThanOrEqualToMatcher<std::string>(std::string(t));
+}
+template <typename T>
+CppUnitLite::LessThanOrEqualToMatcher<T>
+isLessThanOrEqualTo(const T& t)
+{
+	return CppUnitLite::LessThanOrEqualToMatcher<T>(t);
+}
+
+inline CppUnitLite::GreaterThanOrEqualToMatcher<std::string>
+isGreaterThanOrEqualTo(const char* t)
+{
+	return CppUnitLite::GreaterThanOrEqualToMatcher<std::string>(std::string(t));
+}
+
+template <typename T>
+CppUnitLite::GreaterThanOrEqualToMatcher<T>
+isGreaterThanOrEqualTo(const T& t)
+{
+	return CppUnitLite::GreaterThanOrEqualToMatcher<T>(t);
+}
+
+
+/// String matchers
+
+CppUnitLite::StringContainsMatcher contains(const char* t);
+CppUnitLite::StringContainsMatcher contains(const std::string& t);
+
+CppUnitLite::StringEndsWithMatcher endsWith(const char* t);
+CppUnitLite::StringEndsWithMatcher endsWith(const std::string& t);
+
+CppUnitLite::StringBeginsWithMatcher beginsWith(const char* t);
+CppUnitLite::StringBeginsWithMatcher beginsWith(const std::string& t);
+CppUnitLite::StringBeginsWithMatcher startsWith(const char* t);
+CppUnitLite::StringBeginsWithMatcher startsWith(const std::string& t);
+
+
+/// Pointer matchers
+
+CppUnitLite::NullMatcher isNull();
+CppUnitLite::NotNullMatcher isNotNull();
+
+
+/// Container matchers
+
+
+template <typename T>
+CppUnitLite::ContainsMatcher<T> hasItem(const T& e)
+{
+	return CppUnitLite::ContainsMatcher<T>(e);
+}
+
+template <typename T>
+CppUnitLite::ContainsMatcher<T> contains(const T& e)
+{
+	return CppUnitLite::ContainsMatcher<T>(e);
+}
+
+template <typename T>
+CppUnitLite::ContainsMatcher<T> hasKey(const T& e)
+{
+	return CppUnitLite::ContainsMatcher<T>(e);
+}
+
+template <typename Key, typename Data>
+CppUnitLite::HasEntryMatcher<Key, Data> hasEntry(const Key& k, const Data& d)
+{
+	return CppUnitLite::HasEntryMatcher<Key, Data>(k, d);
+}
+
+template <typename Element>
+CppUnitLite::IteratorRange<const Element*>
+arrayOfLength (const Element* start, int n)
+{
+	return CppUnitLite::IteratorRange<const Element*>(start, start+n);
+}
+template <typename Iterator>
+CppUnitLite::IteratorRange<Iterator> range (Iterator start, Iterator stop)
+{
+	return CppUnitLite::IteratorRange<Iterator>(start, stop);
+}
+
+/**
+ * Declare that a range is sorted, so that hasItem(s) and isIn can
+ * search it by bisection.
+ */
+template <typename Iterator>
+CppUnitLite::SortedRange<Iterator> sortedRange (Iterator start, Iterator stop)
+{
+	return CppUnitLite::SortedRange<Iterator>(start, stop);
+}
+
+template <typename Container>
+CppUnitLite::SortedRange<typename Container::const_iterator> sortedRange (const Container& c)
+{
+	return CppUnitLite::SortedRange<typename Container::const_iterator>(c.begin(), c.end());
+}
+
+template <typename... Ts>
+CppUnitLite::HasItemsMatcher<Ts...> hasItems (Ts... t)
+{
+	return CppUnitLite::HasItemsMatcher<Ts...>(t...);
+}
+
+template <typename Items>
+CppUnitLite::HasItemsFromMatcher<Items> hasItemsFrom (const Items& items)
+{
+	return CppUnitLite::HasItemsFromMatcher<Items>(items);
+}
+
+template <typename T>
+CppUnitLite::MatchesMatcher<T> matches (CppUnitLite::IteratorRange<T> range)
+{
+	return CppUnitLite::MatchesMatcher<T>(range);
+}
+
+/**
+ * Element-by-element comparison of numeric sequences: a container or a
+ * range(...)/arrayOfLength(...) against another.  Elements match if they
+ * are within absTolerance of one another, or within relTolerance times
+ * the larger of their magnitudes.
+ */
+template <typename Expected>
+CppUnitLite::ElementwiseMatcher<Expected>
+allApproximately (const Expected& expected, double absTolerance,
+		double relTolerance = 0.0)
+{
+	return CppUnitLite::ElementwiseMatcher<Expected>(expected,
+		CppUnitLite::ElementTolerance(absTolerance, relTolerance));
+}
+
+/**
+ * Element-by-element comparison of floating point sequences, allowing
+ * elements to be up to maxULPs representable values apart.
+ */
+template <typename Expected>
+CppUnitLite::ElementwiseMatcher<Expected>
+allWithinULPs (const Expected& expected, long long maxULPs)
+{
+	return CppUnitLite::ElementwiseMatcher<Expected>(expected,
+		CppUnitLite::ElementTolerance(0.0, 0.0, maxULPs));
+}
+
+/**
+ * Element-by-element equality of numeric sequences.
+ */
+template <typename Expected>
+CppUnitLite::ElementwiseMatcher<Expected>
+elementsEqual (const Expected& expected)
+{
+	return CppUnitLite::ElementwiseMatcher<Expected>(expected,
+		CppUnitLite::ElementTolerance());
+}
+
+
+/// Call log matchers
+
+/**
+ * An expected call to a function, with these arguments. They are
+ * compared by == with arguments logged in the same type, otherwise as
+ * strings.
+ */
+template <typename... Args>
+CppUnitLite::ExpectedCall callTo (const std::string& function, const Args&... args)
+{
+	return CppUnitLite::ExpectedCall(function,
+		std::tuple<typename CppUnitLite::logged_type<Args>::type...>(args...));
+}
+
+/**
+ * The call log holds exactly n calls to a function (given by name, for
+ * any arguments, or via callTo(...)).
+ */
+inline CppUnitLite::CalledTimesMatcher calledTimes (const CppUnitLite::ExpectedCall& call,
+		std::size_t n)
+{
+	return CppUnitLite::CalledTimesMatcher(call, n);
+}
+
+/**
+ * The call log holds at least one call to a function with these arguments.
+ */
+template <typename... Args>
+CppUnitLite::CalledWithMatcher calledWith (const std::string& function, const Args&... args)
+{
+	return CppUnitLite::CalledWithMatcher(callTo(function, args...));
+}
+
+/**
+ * The call log holds these calls (names, for any arguments, or callTo(...)),
+ * in this order, though other calls may come between them.
+ */
+template <typename... Calls>
+CppUnitLite::CallSequenceMatcher callSequence (const Calls&... calls)
+{
+	return CppUnitLite::CallSequenceMatcher(
+		std::vector<CppUnitLite::ExpectedCall>{CppUnitLite::ExpectedCall(calls)...});
+}
+
+
+/// Associative container (set & map) matchers
+
+template <typename... Ts>
+CppUnitLite::HasItemsMatcher<Ts...> hasKeys (Ts... t)
+{
+	return CppUnitLite::HasItemsMatcher<Ts...>(t...);
+}
+
+template <typename Container>
+CppUnitLite::IsInMatcher<Container> isIn(const Container& c)
+{
+	return CppUnitLite::IsInMatcher<Container>(c);
+}
+
+template <typename Iterator>
+CppUnitLite::IsInRangeMatcher<Iterator> isInRange(Iterator b, Iterator e)
+{
+	return CppUnitLite::IsInRangeMatcher<Iterator>(b, e);
+}
+
+
+/// Combining matchers
+
+// Matchers are always classes. Leave ! on pointers, enums, etc. alone.
+template <typename T, typename std::enable_if<std::is_class<T>::value, int>::type = 0>
+CppUnitLite::NotMatcher<T>
+operator!(const T& t)
+{
+	return CppUnitLite::NotMatcher<T>(t);
+}
+
+template <typename... Ts>
+CppUnitLite::AllOfMatcher<Ts...>
+allOf(Ts... ts)
+{
+	return CppUnitLite::AllOfMatcher<Ts...>(ts...);
+}
+
+template <typename... Ts>
+CppUnitLite::AnyOfMatcher<Ts...>
+anyOf(Ts... ts)
+{
+	return CppUnitLite::AnyOfMatcher<Ts...>(ts...);
+}
+
+template <typename... T>
+CppUnitLite::OneOfMatcher<T...>
+isOneOf (T... t)
+{
+	return CppUnitLite::OneOfMatcher<T...>(t...);
+}
+
+#endif
@@ -0,0 +1,432 @@
+#ifndef UNITTEST_PROPERTIES_H
+#define UNITTEST_PROPERTIES_H
+
+#include <cmath>
+#include <limits>
+#include <tuple>
+
+#include "unittestMatchers.h"
+
+
+/**
+ * Registration of a property: a test run on many sets of values drawn
+ * from generators (from namespace CppUnitLite), whose parameters, of
+ * type const T& for a generator of T, follow the macro:
+ *
+ *    UnitProperty (reverseTwice, vectorsOf(integers<int>()))
+ *        (const std::vector<int>& v)
+ *    {
+ *        assertThat (reversed(reversed(v)), isEqualTo(v));
+ *    }
+ *
+ * A set of values that fails is shrunk to a simpler one that still
+ * fails, and reported. --property-cases sets how many sets are tried,
+ * and --seed makes them reproducible. Like data-driven tests,
+ * properties are split by --data-parts.
+ */
+#define UnitProperty(functName, ...) \
+		UnitPropertyTimed(functName, DEFAULT_UNIT_TEST_TIME_LIMIT, __VA_ARGS__)
+
+#define UnitPropertyTimed(functName, limit, ...) \
+		namespace functName ## Generators { \
+			using namespace CppUnitLite; \
+			typedef PropertyOf<decltype(generators(__VA_ARGS__))>::Function Property; \
+		} \
+		functName ## Generators::Property functName; \
+		void functName ## Cases() { using namespace CppUnitLite; \
+			checkProperty(__FILE__, __LINE__, &functName, __VA_ARGS__); } \
+		CppUnitLite::UnitTest::Registration functName ## Registration \
+		(#functName, limit, &functName ## Cases, false, false, nullptr, true); \
+		void functName
+
+
+
+/* ********************************************************
+ * Properties
+ * ********************************************************/
+
+namespace CppUnitLite {
+
+/**
+ * The source of randomness of a generator (splitmix64). Each set of
+ * values of a property is drawn from its own Random, seeded from the
+ * run's seed and the number of the set, so that any one set can be
+ * drawn alone, in whichever part of the tests it falls.
+ */
+class Random {
+public:
+	explicit Random (std::uint64_t seed): state(seed) {}
+
+	std::uint64_t next ()
+	{
+		std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	/// @return a number in [0, n), for n > 0
+	std::uint64_t below (std::uint64_t n) { return next() % n; }
+
+	/// @return a number in [0, 1)
+	double unit () { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+	std::uint64_t state;
+};
+
+/**
+ * A generator of values of type T for properties. It draws a value of
+ * at most a given size (growing from 1 to 100 over a run), and gives
+ * the simpler values, simplest first, that a failing value can be
+ * shrunk to.
+ */
+template <typename T>
+class Gen {
+public:
+	typedef T value_type;
+	typedef Callable<T(Random&, unsigned)> Generator;
+	typedef Callable<std::vector<T>(const T&)> Shrinker;
+
+	explicit Gen (Generator g, Shrinker s = Shrinker()): generator(g), shrinker(s) {}
+
+	T operator() (Random& random, unsigned size) const { return generator(random, size); }
+
+	std::vector<T> shrink (const T& value) const
+	{
+		return shrinker ? shrinker(value) : std::vector<T>();
+	}
+
+	/**
+	 * A generator of values made from these, e.g. of a user type.
+	 * The values made are not shrunk.
+	 */
+	template <typename F>
+	Gen<typename std::decay<decltype(std::declval<F>()(std::declval<const T&>()))>::type>
+	map (F f) const
+	{
+		typedef typename std::decay<decltype(f(std::declval<const T&>()))>::type U;
+		Generator g = generator;
+		return Gen<U>([g, f] (Random& random, unsigned size) { return f(g(random, size)); });
+	}
+
+private:
+	Generator generator;
+	Shrinker shrinker;
+};
+
+/**
+ * Integers from lo to hi, shrinking towards 0 (or the end of the range
+ * nearest to it). One in ten is an end of the range, or 0.
+ */
+template <typename T>
+Gen<T> integers (T lo = std::numeric_limits<T>::min(), T hi = std::numeric_limits<T>::max())
+{
+	static_assert(std::is_integral<T>::value, "integers<T> needs an integral type");
+	typedef typename std::make_unsigned<T>::type U;
+	T target = (lo > 0) ? lo : ((hi < 0) ? hi : 0);
+	return Gen<T>(
+		[lo, hi, target] (Random& random, unsigned) {
+			U span = U(hi) - U(lo);
+			if (random.below(10) == 0) {
+				std::uint64_t edge = random.below(3);
+				return (edge == 0) ? lo : (edge == 1) ? hi : target;
+			}
+			std::uint64_t offset = (span == U(-1)) ? random.next()
+					: random.below(std::uint64_t(span) + 1);
+			return T(U(lo) + U(offset));
+		},
+		[target] (const T& x) {
+			std::vector<T> simpler;
+			if (x == target)
+				return simpler;
+			simpler.push_back(target);
+			bool above = x > target;
+			U distance = above ? U(U(x) - U(target)) : U(U(target) - U(x));
+			for (U d = distance / 2; d > 0; d /= 2)
+				simpler.push_back(T(above ? U(U(x) - d) : U(U(x) + d)));
+			return simpler;
+		});
+}
+
+/**
+ * Floating-point numbers from lo to hi, shrinking towards 0 (or the
+ * end of the range nearest to it) and towards whole numbers.
+ */
+template <typename T>
+Gen<T> floats (T lo = -1.0e6, T hi = 1.0e6)
+{
+	static_assert(std::is_floating_point<T>::value, "floats<T> needs a floating-point type");
+	T target = (lo > 0) ? lo : ((hi < 0) ? hi : 0);
+	return Gen<T>(
+		[lo, hi, target] (Random& random, unsigned) {
+			if (random.below(10) == 0) {
+				std::uint64_t edge = random.below(3);
+				return (edge == 0) ? lo : (edge == 1) ? hi : target;
+			}
+			return T(lo + (hi - lo) * random.unit());
+		},
+		[lo, hi, target] (const T& x) {
+			std::vector<T> simpler;
+			if (x == target || x != x)
+				return simpler;
+			simpler.push_back(target);
+			T whole = std::trunc(x);
+			if (whole != x && whole >= lo && whole <= hi)
+				simpler.push_back(whole);
+			T half = target + (x - target) / 2;
+			if (half != x && half != target)
+				simpler.push_back(half);
+			return simpler;
+		});
+}
+
+/// Printable ASCII characters, shrinking towards 'a'.
+inline Gen<char> characters ()
+{
+	return Gen<char>(
+		[] (Random& random, unsigned) { return char(' ' + random.below(95)); },
+		[] (const char& c) {
+			std::vector<char> simpler;
+			if (c != 'a')
+				simpler.push_back('a');
+			return simpler;
+		});
+}
+
+/// One of the given values, shrinking towards the first.
+template <typename T>
+Gen<T> elementsOf (std::vector<T> values)
+{
+	return Gen<T>(
+		[values] (Random& random, unsigned) { return values[random.below(values.size())]; },
+		[values] (const T& x) {
+			std::vector<T> simpler;
+			if (!(x == values[0]))
+				simpler.push_back(values[0]);
+			return simpler;
+		});
+}
+
+/// Always the same value.
+template <typename T>
+Gen<T> just (T value)
+{
+	return Gen<T>([value] (Random&, unsigned) { return value; });
+}
+
+/**
+ * Containers (vector, string, list, set, ...) of up to size elements,
+ * drawn from another generator. They shrink by losing elements, and
+ * then by shrinking the elements.
+ */
+template <typename Container, typename T>
+Gen<Container> containersOf (Gen<T> elements)
+{
+	return Gen<Container>(
+		[elements] (Random& random, unsigned size) {
+			Container c;
+			std::uint64_t length = random.below(std::uint64_t(size) + 1);
+			for (std::uint64_t i = 0; i < length; ++i)
+				c.insert(c.end(), elements(random, size));
+			return c;
+		},
+		[elements] (const Container& c) {
+			std::vector<Container> simpler;
+			std::vector<T> items (c.begin(), c.end());
+			std::size_t n = items.size();
+			for (std::size_t chunk = n; chunk > 0; chunk /= 2)
+				for (std::size_t start = 0; start + chunk <= n; start += chunk) {
+					Container smaller;
+					for (std::size_t i = 0; i < n; ++i)
+						if (i < start || i >= start + chunk)
+							smaller.insert(smaller.end(), items[i]);
+					simpler.push_back(smaller);
+				}
+			for (std::size_t i = 0; i < n; ++i)
+				for (const T& item: elements.shrink(items[i])) {
+					Container changed;
+					for (std::size_t j = 0; j < n; ++j)
+						changed.insert(changed.end(), (j == i) ? item : items[j]);
+					simpler.push_back(changed);
+				}
+			return simpler;
+		});
+}
+
+template <typename T>
+Gen<std::vector<T>> vectorsOf (Gen<T> elements)
+{
+	return containersOf<std::vector<T>>(elements);
+}
+
+inline Gen<std::string> strings (Gen<char> chars = characters())
+{
+	return containersOf<std::string>(chars);
+}
+
+
+/**
+ * The numbering of the sets of values of a property, as it runs.
+ * Normally used only via UnitProperty(...).
+ */
+class PropertyRun {
+public:
+	PropertyRun (const char* fileName, int lineNumber);
+
+	/**
+	 * Move to the next set of values to be tried here.
+	 *
+	 * @param random set to draw the values of that set
+	 * @param size set to the size of the values to draw
+	 * @return false if all have been tried
+	 */
+	bool next (Random& random, unsigned& size);
+
+	/**
+	 * Report a property's failure.
+	 *
+	 * @param values the simplest failing values
+	 * @param explanation why they failed
+	 * @param numShrinks how many times the values were shrunk
+	 * @throws UnitTestFailure always
+	 */
+	void falsified (const std::string& values, const std::string& explanation,
+			unsigned numShrinks);
+
+	static const unsigned maxShrinks = 1000;
+
+private:
+	const char* fileName;
+	int lineNumber;
+	std::uint64_t seed;
+	unsigned long numCases;
+	unsigned long part;
+	unsigned long parts;
+	unsigned long caseNumber;
+};
+
+template <typename... Ts>
+std::tuple<Gen<Ts>...> generators (const Gen<Ts>&... gens);
+
+template <typename Generators>
+struct PropertyOf;
+
+/// The type of the function checked by UnitProperty(...) with these generators.
+template <typename... Ts>
+struct PropertyOf<std::tuple<Gen<Ts>...>> {
+	typedef void Function(const Ts&...);
+};
+
+template <std::size_t... I>
+struct PropertyIndices {};
+
+template <std::size_t N, std::size_t... I>
+struct MakePropertyIndices: MakePropertyIndices<N-1, N-1, I...> {};
+
+template <std::size_t... I>
+struct MakePropertyIndices<0, I...> {
+	typedef PropertyIndices<I...> type;
+};
+
+/**
+ * Does a property hold for a set of values?
+ *
+ * @param explanation set, if not, to why not
+ */
+template <typename... Ts, std::size_t... I>
+bool propertyHolds (void (*property)(const Ts&...), const std::tuple<Ts...>& values,
+		std::string& explanation, PropertyIndices<I...>)
+{
+	try {
+		property(std::get<I>(values)...);
+		return true;
+	} catch (UnitTest::UnitTestFailure& ex) {
+		explanation = ex.what();
+	} catch (std::exception& e) {
+		explanation = std::string("Unexpected error: ") + e.what();
+	}
+	return false;
+}
+
+template <typename... Ts, std::size_t... I>
+std::string describeValues (const std::tuple<Ts...>& values, PropertyIndices<I...>)
+{
+	std::string reprs[] = { getStringRepr(std::get<I>(values))... };
+	std::string description;
+	for (std::size_t i = 0; i < sizeof...(Ts); ++i)
+		description += "\n\t" + std::to_string(i + 1) + ": " + reprs[i];
+	return description;
+}
+
+/**
+ * Replace one of the failing values (the Ith or later) with a simpler
+ * one, if any, for which the property still fails.
+ */
+template <std::size_t I, bool Past, typename... Ts>
+struct PropertyShrinker {
+	static bool shrink (void (*property)(const Ts&...), const std::tuple<Gen<Ts>...>& gens,
+			std::tuple<Ts...>& values, std::string& explanation, unsigned& budget)
+	{
+		typedef typename std::tuple_element<I, std::tuple<Ts...>>::type T;
+		for (const T& candidate: std::get<I>(gens).shrink(std::get<I>(values))) {
+			if (budget == 0)
+				return false;
+			--budget;
+			std::tuple<Ts...> trial (values);
+			std::get<I>(trial) = candidate;
+			if (!propertyHolds(property, trial, explanation,
+					typename MakePropertyIndices<sizeof...(Ts)>::type()))
+			{
+				values = trial;
+				return true;
+			}
+		}
+		return PropertyShrinker<I+1, I+1 == sizeof...(Ts), Ts...>::shrink(
+				property, gens, values, explanation, budget);
+	}
+};
+
+template <std::size_t I, typename... Ts>
+struct PropertyShrinker<I, true, Ts...> {
+	static bool shrink (void (*)(const Ts&...), const std::tuple<Gen<Ts>...>&,
+			std::tuple<Ts...>&, std::string&, unsigned&)
+	{
+		return false;
+	}
+};
+
+/**
+ * Check a property on sets of values drawn from its generators,
+ * shrinking the first set that fails. Normally called via
+ * UnitProperty(...).
+ *
+ * @throws UnitTestFailure if the property fails
+ */
+template <typename... Ts>
+void checkProperty (const char* fileName, int lineNumber,
+		void (*property)(const Ts&...), const Gen<Ts>&... gens)
+{
+	static_assert(sizeof...(Ts) > 0, "a property needs at least one generator");
+	typedef typename MakePropertyIndices<sizeof...(Ts)>::type Indices;
+	PropertyRun run (fileName, lineNumber);
+	Random random (0);
+	unsigned size;
+	std::string explanation;
+	while (run.next(random, size)) {
+		std::tuple<Ts...> values {gens(random, size)...}; // drawn in order
+		if (propertyHolds(property, values, explanation, Indices()))
+			continue;
+		std::tuple<Gen<Ts>...> generators (gens...);
+		unsigned budget = PropertyRun::maxShrinks;
+		unsigned numShrinks = 0;
+		while (PropertyShrinker<0, false, Ts...>::shrink(property, generators, values,
+				explanation, budget))
+			++numShrinks;
+		run.falsified(describeValues(values, Indices()), explanation, numShrinks);
+	}
+}
+
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef UNITTEST_REPORTERS_H
+#define UNITTEST_REPORTERS_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include "unittestCore.h"
+
+
+namespace CppUnitLite {
+
+/* ********************************************************
+ * Reporters
+ * ********************************************************/
+
+/**
+ * The outcome of one test, as given to each Reporter.
+ */
+struct TestReport {
+	enum Outcome {Error = -1, Failed = 0, Passed = 1, Skipped = 2};
+
+	unsigned testNumber;
+	const std::string& name;
+	Outcome outcome;
+	/// The test's TAP lines: its diagnostics, output and result.
+	const std::string& transcript;
+	const UnitTest::TestTiming& timing;
+
+	TestReport (unsigned number, const std::string& testName, Outcome result,
+			const std::string& text, const UnitTest::TestTiming& testTiming)
+		: testNumber(number), name(testName), outcome(result), transcript(text),
+		  timing(testTiming)
+	{}
+};
+
+/**
+ * The totals of a test run, as given to each Reporter.
+ */
+struct RunSummary {
+	long passed;
+	long failed;
+	long errors;
+	long skipped;
+	double wallMS; ///< elapsed time of the whole run
+};
+
+/**
+ * Receives the events of a test run, in order: start, then the results
+ * (in test-number order) and diagnostics, then the summary. Add one with
+ * UnitTest::addReporter.
+ */
+class Reporter {
+public:
+	virtual ~Reporter() {}
+
+	/**
+	 * @param numTests the number of tests to be run
+	 */
+	virtual void start (unsigned /*numTests*/) {}
+
+	virtual void result (const TestReport& report) = 0;
+
+	/**
+	 * A message about the run rather than about any one test.
+	 */
+	virtual void diagnostic (const std::string& /*text*/) {}
+
+	virtual void summary (const RunSummary& /*totals*/) {}
+};
+
+/**
+ * Reports in TAP version 13, as the results arrive.
+ */
+class TapReporter: public Reporter {
+public:
+	/**
+	 * Report on the standard output.
+	 */
+	TapReporter ();
+
+	/**
+	 * Report to a file.
+	 */
+	explicit TapReporter (const std::string& path);
+
+	void start (unsigned numTests) override;
+	void result (const TestReport& report) override;
+	void diagnostic (const std::string& text) override;
+	void summary (const RunSummary& totals) override;
+
+private:
+	std::shared_ptr<std::ostream> file; ///< or null for the standard output
+
+	void write (const std::string& text);
+};
+
+/**
+ * Reports as a JUnit XML file, written with the summary, for CI dashboards.
+ * A failure's message is the first line of its diagnostics, and its body
+ * the rest of the test's TAP transcript.
+ */
+class JUnitReporter: public Reporter {
+public:
+	/**
+	 * @param path the file to be written
+	 * @param suiteName the name of the test suite (and test classes)
+	 */
+	JUnitReporter (const std::string& path, const std::string& suiteName);
+
+	void result (const TestReport& report) override;
+	void diagnostic (const std::string& text) override;
+	void summary (const RunSummary& totals) override;
+
+private:
+	std::string path;
+	std::string suiteName;
+	std::string testCases;
+	std::string systemOut;
+};
+
+/**
+ * Reports as a stream of length-prefixed binary records: each a Record
+ * header, in the byte order of the machine, followed by `length` bytes
+ * of text. This is also how worker processes (-j N) report to the parent.
+ */
+class BinaryReporter: public Reporter {
+public:
+	enum Kind {
+		RunStarted = 1,         ///< testNumber is the number of tests
+		TestStarted = 2,
+		TestExpectedToFail = 3,
+		TestFinished = 4,       ///< text is the TAP transcript
+		Diagnostic = 5,
+		RunFinished = 6         ///< text is "passed failed errors skipped"
+	};
+
+	struct Record {
+		std::uint32_t kind;
+		std::uint32_t testNumber;
+		std::int32_t testResult; ///< a TestReport::Outcome
+		std::uint32_t length;    ///< of the text that follows
+		double wallMS;
+		double cpuMS;
+		std::int64_t counters[4]; ///< cycles, instructions, cache and branch misses
+	};
+
+	/**
+	 * Write to a file descriptor that the caller has opened.
+	 */
+	explicit BinaryReporter (int fd);
+
+	/**
+	 * Write to a file.
+	 */
+	explicit BinaryReporter (const std::string& path);
+
+	~BinaryReporter();
+
+	void start (unsigned numTests) override;
+	void result (const TestReport& report) override;
+	void diagnostic (const std::string& text) override;
+	void summary (const RunSummary& totals) override;
+
+	/**
+	 * Write one record.
+	 *
+	 * @return false if it could not be written
+	 */
+	bool record (Kind kind, unsigned testNumber, int testResult, const std::string& text,
+			const UnitTest::TestTiming& timing = UnitTest::TestTiming());
+
+private:
+	int fd;
+	bool owned;
+};
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ *  Micro-benchmarks of the cost of passing assertions.
+ *
+ *  Each test compares the current assertion macros against the
+ *  string-building form that the macros used to expand into,
+ *  reporting both as TAP comments. The times are only reported, not
+ *  checked: they vary too much on a loaded machine, and the benchmarks
+ *  project is where the framework's speed is tracked.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "unittest.h"
+
+using namespace std;
+
+const int Repetitions = 200000;
+
+// Nanoseconds per iteration of f, averaged over Repetitions calls.
+template <typename F>
+double nsPerCall (F f)
+{
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < Repetitions; ++i)
+		f(i);
+	auto stop = chrono::steady_clock::now();
+	return chrono::duration<double, nano>(stop - start).count() / Repetitions;
+}
+
+void reportCost (const string& label, double before, double after)
+{
+	cout << "# " << label << ": " << before << " ns before, "
+			<< after << " ns after" << endl;
+}
+
+UnitTestTimed(testAssertTrueOverhead, 10000L) {
+	double before = nsPerCall([] (int i) {
+		CppUnitLite::UnitTest::checkTest(
+				CppUnitLite::AssertionResult(i >= 0, std::string(""), std::string("")),
+				std::string("i >= 0"), __FILE__, __LINE__);
+	});
+	double after = nsPerCall([] (int i) {
+		assertTrue (i >= 0);
+	});
+	reportCost("assertTrue", before, after);
+}
+
+UnitTestTimed(testAssertFalseOverhead, 10000L) {
+	double before = nsPerCall([] (int i) {
+		CppUnitLite::UnitTest::checkTest(
+				CppUnitLite::AssertionResult(!(i < 0), std::string(""), std::string("")),
+				std::string("!(") + "i < 0" + ")", __FILE__, __LINE__);
+	});
+	double after = nsPerCall([] (int i) {
+		assertFalse (i < 0);
+	});
+	reportCost("assertFalse", before, after);
+}
+
+UnitTestTimed(testAssertThatOverhead, 10000L) {
+	double before = nsPerCall([] (int i) {
+		CppUnitLite::UnitTest::checkTest(
+				isEqualTo(i).eval(i),
+				std::string("i") + " " + std::string("isEqualTo(i)"), __FILE__, __LINE__);
+	});
+	double after = nsPerCall([] (int i) {
+		assertThat (i, isEqualTo(i));
+	});
+	reportCost("assertThat", before, after);
+}
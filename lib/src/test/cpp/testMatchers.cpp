@@ -3,9 +3,11 @@
  */
 
 #include <algorithm>
+#include <cmath>
 #include <exception>
 #include <iostream>
 #include <string>
+#include <limits>
 #include <list>
 #include <vector>
 #include <set>
@@ -110,6 +112,53 @@ UnitTest(testAssocContainers) {
 }
 
 
+UnitTest(testSortedContainers) {
+	int numbers[] = {1, 3, 5, 9};
+    vector<int> v  (numbers, numbers+4);
+
+    assertThat(sortedRange(v), hasItem(5));
+    assertThat(sortedRange(v), !hasItem(4));
+    assertThat(sortedRange(v), hasItems(1, 9));
+    assertThat(sortedRange(v), !hasItems(1, 2));
+    assertThat(9, isIn(sortedRange(v)));
+    assertThat(10, !isIn(sortedRange(v.begin(), v.end())));
+    assertThat(0, !isIn(sortedRange(v.begin(), v.end())));
+}
+
+UnitTest(testManyItems) {
+    vector<int> v;
+    for (int i = 0; i < 1000; ++i)
+    	v.push_back(3*i);
+    vector<int> expected;
+    for (int i = 0; i < 100; ++i)
+    	expected.push_back(30*i);
+
+    assertThat(v, hasItemsFrom(expected));
+    assertThat(list<int>(v.begin(), v.end()), hasItemsFrom(set<int>(expected.begin(), expected.end())));
+    assertThat(v, hasItems(0, 3, 6, 9, 12, 15, 18, 21, 24));
+    assertThat(sortedRange(v), hasItemsFrom(expected));
+
+    expected.push_back(31);
+    expected.push_back(32);
+    // A result refers to its matcher, so each matcher is kept while its
+    // result is examined.
+    auto hasExpected = hasItemsFrom(expected);
+    CppUnitLite::AssertionResult r = hasExpected.eval(v);
+    assertFalse(r.result);
+    assertThat(r.failExplanation(), startsWith("Did not find 31 in "));
+    auto hasV = hasItemsFrom(v);
+    r = hasV.eval(expected); // the container is the smaller side
+    assertThat(r.failExplanation(), startsWith("Did not find 3 in "));
+
+    assertThat(27, isOneOf(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27));
+    assertThat(28, !isOneOf(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27));
+
+    auto oddNumber = isOneOf(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27);
+    for (int i = 0; i < 30; ++i)   // later lookups are hashed
+        assertThat(oddNumber.eval(i).result, is(i % 2 == 1 && i < 28));
+}
+
+
 UnitTest(testCombinations) {
 	assertThat(23, allOf(isLessThan(42)));
 	assertThat(23, allOf(isLessThan(42), isGreaterThan(10), is(23)));
@@ -125,3 +174,58 @@ UnitTest(testCombinations) {
 
 
 
+
+
+UnitTest(testElementwise) {
+	vector<double> v;
+	for (int i = 0; i < 1003; ++i)
+		v.push_back(0.5 * i);
+	vector<double> w = v;
+	assertThat(v, elementsEqual(w));
+	assertThat(range(v.begin(), v.end()), elementsEqual(w));
+	assertThat(arrayOfLength(v.data(), 10), elementsEqual(arrayOfLength(w.data(), 10)));
+	assertThat(v, !elementsEqual(arrayOfLength(w.data(), 10)));
+
+	w[7] += 1.0e-10;
+	w[500] -= 1.0e-8;
+	w[1002] += 5.0e-10;
+	assertThat(v, !elementsEqual(w));
+	assertThat(v, allApproximately(w, 1.0e-7));
+	assertThat(v, !allApproximately(w, 1.0e-9));
+	assertThat(v, allApproximately(w, 0.0, 1.0e-10));
+	assertThat(list<double>(v.begin(), v.end()), allApproximately(w, 1.0e-7));
+
+	auto nearW = allApproximately(w, 1.0e-9);
+	CppUnitLite::AssertionResult r = nearW.eval(v);
+	assertFalse(r.result);
+	assertThat(r.failExplanation(), startsWith("1 of 1003 elements did not match"));
+	assertThat(r.failExplanation(), contains("first in position 500"));
+	auto equalsW = elementsEqual(w);
+	r = equalsW.eval(v);
+	assertThat(r.failExplanation(), startsWith("3 of 1003 elements did not match exactly"));
+	assertThat(r.failExplanation(), contains("first in position 7"));
+	assertThat(r.failExplanation(), contains("worst in position 500"));
+	assertThat(allApproximately(w, 1.0e-7).eval(v).passExplanation(),
+			is("All 1003 elements matched to within 1e-07"));
+
+	vector<float> f(v.begin(), v.end());
+	vector<float> g(f);
+	g[3] = std::nextafter(g[3], 1000.0f);
+	g[4] = std::nextafter(std::nextafter(g[4], 1000.0f), 1000.0f);
+	assertThat(f, !elementsEqual(g));
+	assertThat(f, allWithinULPs(g, 2));
+	assertThat(f, !allWithinULPs(g, 1));
+	auto withinOneULP = allWithinULPs(g, 1);
+	r = withinOneULP.eval(f);
+	assertThat(r.failExplanation(), endsWith("max error 2 ULPs"));
+
+	g[9] = std::numeric_limits<float>::quiet_NaN();
+	auto nearG = allApproximately(g, 1.0);
+	r = nearG.eval(f);
+	assertFalse(r.result);
+	assertThat(r.failExplanation(), contains("worst in position 9"));
+
+	vector<int> ints(10, 3);
+	assertThat(ints, elementsEqual(vector<long>(10, 3L)));
+	assertThat(ints, allApproximately(vector<double>(10, 3.25), 0.5));
+}
@@ -3,11 +3,15 @@
  */
 
 #include <algorithm>
+#include <cstdio>
 #include <exception>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 #include "unittest.h"
+#include "unittestReporters.h"
 
 using namespace std;
 
@@ -63,3 +67,43 @@ UnitTest(testFailureMsg) {
 	assertThat (result1, contains(expected2));
 }
 
+UnitTest(testTimingMsg) {
+    CppUnitLite::UnitTest::TestTiming timing (12.5, 10.25);
+    string result1 = CppUnitLite::UnitTest::msgFailed(42, "smallTest", "diag", timing);
+	assertThat (result1, contains("not ok 42 - smallTest\n  ---\n"));
+	assertThat (result1, contains("  duration_ms: 12.500\n"));
+	assertThat (result1, contains("  cpu_ms: 10.250\n  ..."));
+}
+
+UnitTest(testCommentaryLong) {
+    string msg1;
+    for (int i = 0; i < 100000; ++i)
+        msg1 += "line\n";
+    string result1 = CppUnitLite::UnitTest::msgComment(msg1);
+	assertThat (result1.size(), isEqualTo(msg1.size() + 2 * 100001));
+	assertThat (result1.substr(result1.size() - 9), isEqualTo("# line\n# "));
+}
+
+UnitTest(testJUnitReporter) {
+    using namespace CppUnitLite;
+    const string path = "unittest-junit-test.xml";
+    {
+        JUnitReporter reporter (path, "suite");
+        UnitTest::TestTiming timing (1500.0);
+        string passed = "ok 1 - testA";
+        string failed = "# x.cpp:12: \ta < b & \"c\"\n#  more\n# : \nnot ok 2 - testB\n  ---\n  duration_ms: 1500.000\n  ...";
+        reporter.result(TestReport(1, "testA", TestReport::Passed, passed, timing));
+        reporter.result(TestReport(2, "testB", TestReport::Failed, failed, timing));
+        reporter.summary(RunSummary{1, 1, 0, 0, 3000.0});
+    }
+    ifstream in (path);
+    ostringstream xml;
+    xml << in.rdbuf();
+    in.close();
+    std::remove(path.c_str());
+	assertThat (xml.str(), contains("tests=\"2\" failures=\"1\" errors=\"0\" skipped=\"0\" time=\"3.000\""));
+	assertThat (xml.str(), contains("<testcase name=\"testA\" classname=\"suite\" time=\"1.500\"/>"));
+	assertThat (xml.str(), contains("<failure message=\"x.cpp:12: \ta &lt; b &amp; &quot;c&quot;\">"));
+	assertThat (xml.str(), contains("&quot;\n more\n</failure>"));
+	assertThat (xml.str(), !contains("duration_ms"));
+}
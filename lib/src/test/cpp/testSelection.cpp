@@ -0,0 +1,138 @@
+/**
+ *  Unit test of the selection of tests to run
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "unittest.h"
+
+using namespace std;
+
+#if defined(__linux__)
+
+// The tests that this program would run with args, as given by --list.
+vector<string> listedTests (const vector<string>& args)
+{
+	char program[4096];
+	ssize_t length = ::readlink("/proc/self/exe", program, sizeof(program));
+	vector<string> names;
+	if (length <= 0 || length == sizeof(program))
+		return names;
+	string command = "'" + string(program, length) + "' --list";
+	for (const string& arg: args)
+		command += " '" + arg + "'";
+	command += " 2>/dev/null";
+	FILE* listing = ::popen(command.c_str(), "r");
+	if (listing == nullptr)
+		return names;
+	char line[1024];
+	while (std::fgets(line, sizeof(line), listing) != nullptr) {
+		string name = line;
+		if (!name.empty() && name.back() == '\n')
+			name.pop_back();
+		names.push_back(name);
+	}
+	::pclose(listing);
+	return names;
+}
+
+UnitTest(testSelectByGlob) {
+	vector<string> expected {"testSelectByAbbreviation", "testSelectByGlob",
+		"testSelectByRegex"};
+	assertThat(listedTests({"--filter=testSelectBy*"}), isEqualTo(expected));
+	expected = {"testSelectByGlob", "testSelectByRegex"};
+	assertThat(listedTests({"--filter=testSelectBy[GR]?*"}), isEqualTo(expected));
+	// No literal run of three characters, so every name is matched.
+	assertThat(listedTests({"--filter=t?s?Se*B?[!A]*"}), isEqualTo(expected));
+	// Matching nothing, as a whole name must, it is as if not given.
+	assertThat(listedTests({"--filter=testSelectBy"}), isEqualTo(listedTests({})));
+}
+
+UnitTest(testSelectByRegex) {
+	vector<string> expected {"testSelectByGlob", "testSelectByRegex"};
+	assertThat(listedTests({"--filter=/^testSelectBy(Glob|Regex)$/"}), isEqualTo(expected));
+	expected = {"testSelectByAbbreviation", "testSelectByGlob", "testSelectByRegex"};
+	assertThat(listedTests({"--filter=/SelectBy/"}), isEqualTo(expected));
+	// A malformed regular expression is ignored.
+	assertThat(listedTests({"--filter=/SelectBy(/"}), isEqualTo(listedTests({})));
+}
+
+UnitTest(testSelectExcluding) {
+	vector<string> expected {"testSelectByAbbreviation", "testSelectByGlob"};
+	assertThat(listedTests({"--filter=testSelectBy*", "--filter=-*Regex"}),
+			isEqualTo(expected));
+	expected = {"testSelectByAbbreviation"};
+	assertThat(listedTests({"--filter=testSelectBy*", "--filter=-/G|R/"}),
+			isEqualTo(expected));
+
+	// Excluding alone leaves all of the others.
+	vector<string> all = listedTests({});
+	vector<string> rest = listedTests({"--filter=-testSelectBy*"});
+	assertThat(rest.size(), is(all.size() - 3));
+	assertThat(string("testSelectExcluding"), isIn(rest));
+	assertThat(string("testSelectByGlob"), !isIn(rest));
+}
+
+UnitTest(testSelectByAbbreviation) {
+	vector<string> expected {"testSelectByAbbreviation"};
+	assertThat(listedTests({"tSBA"}), isEqualTo(expected));
+	expected = {"testSelectByGlob", "testSelectExcluding"};
+	assertThat(listedTests({"tSBG", "tSE"}), isEqualTo(expected));
+	// A name's own text is preferred to an abbreviation.
+	expected = {"testSelectByGlob"};
+	assertThat(listedTests({"SelectByG"}), isEqualTo(expected));
+}
+
+UnitTest(testShardsByHash) {
+	vector<string> all = listedTests({});
+	vector<string> covered;
+	for (int shard = 0; shard < 3; ++shard) {
+		vector<string> args {"--shard-count=3", "--shard-index=" + to_string(shard)};
+		vector<string> selected = listedTests(args);
+		assertThat(listedTests(args), isEqualTo(selected)); // the same in every run
+		covered.insert(covered.end(), selected.begin(), selected.end());
+	}
+	// Each test is in exactly one shard.
+	sort(covered.begin(), covered.end());
+	assertThat(covered, isEqualTo(all));
+}
+
+UnitTest(testShardsByTiming) {
+	const string path = "unittest-shard-timings.txt";
+	{
+		ofstream out (path);
+		out << "# test milliseconds\n"
+			<< "testSelectByGlob 100\n" << "testSelectByRegex 60\n"
+			<< "testSelectExcluding 50\n" << "testSelectByAbbreviation 30\n";
+	}
+	// Longest first, each into the shard with the least work so far.
+	vector<string> args {"--filter=testSelect*", "--shard-count=2",
+		"--shard-timings=" + path, "--shard-index=0"};
+	vector<string> shard0 = listedTests(args);
+	args.back() = "--shard-index=1";
+	vector<string> shard1 = listedTests(args);
+
+	// A test without a timing is taken to need the average, 70 ms.
+	{
+		ofstream out (path);
+		out << "testSelectByGlob 100\n" << "testSelectByRegex 60\n"
+			<< "testSelectExcluding 50\n";
+	}
+	vector<string> untimed1 = listedTests(args);
+	std::remove(path.c_str());
+
+	vector<string> expected {"testSelectByAbbreviation", "testSelectByGlob"};
+	assertThat(shard0, isEqualTo(expected));
+	expected = {"testSelectByRegex", "testSelectExcluding"};
+	assertThat(shard1, isEqualTo(expected));
+	expected = {"testSelectByAbbreviation", "testSelectByRegex"};
+	assertThat(untimed1, isEqualTo(expected));
+}
+
+#endif
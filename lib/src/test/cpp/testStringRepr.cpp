@@ -5,6 +5,8 @@
 #include <exception>
 #include <iostream>
 #include <string>
+#include <array>
+#include <map>
 #include <vector>
 #include <set>
 #include <tuple>
@@ -70,3 +72,40 @@ UnitTest(testStringRepr) {
 	assertThat(CppUnitLite::getStringRepr(s), is("\"xyz\""));
 	assertThat(CppUnitLite::getStringRepr("def"), is("\"def\""));
 }
+
+UnitTest(testLongContainerRepr) {
+	vector<int> v;
+	for (int i = 0; i < 25; ++i)
+		v.push_back(i);
+	assertThat(CppUnitLite::getStringRepr(v),
+			is("[0, 1, 2, 3, 4, 5, 6, 7, 8, 9, ...... (15 additional elements) ...]"));
+}
+
+// A huge, uncopyable sequence that counts how many of its elements are visited
+class Counting {
+public:
+	mutable long visited = 0;
+
+	class const_iterator {
+		const Counting* range;
+		long i;
+	public:
+		const_iterator (const Counting* r, long at): range(r), i(at) {}
+		long operator* () const { ++range->visited; return i; }
+		const_iterator& operator++ () { ++i; return *this; }
+		bool operator!= (const const_iterator& other) const { return i != other.i; }
+	};
+
+	Counting () {}
+	Counting (const Counting&) = delete;
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, 100000000L); }
+	long size() const { return 100000000L; }
+};
+
+UnitTest(testHugeContainerRepr) {
+	Counting huge;
+	string repr = CppUnitLite::getStringRepr(huge);
+	assertThat(repr, endsWith("(99999990 additional elements) ...]"));
+	assertThat(huge.visited, is(10L));
+}
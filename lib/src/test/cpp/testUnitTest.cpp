@@ -5,9 +5,16 @@
 #include <algorithm>
 #include <exception>
 #include <iostream>
+#include <array>
 #include <string>
+#include <thread>
+#include <vector>
 
+// Count the heap allocations of every test in this program.
+#define UNITTEST_COUNT_ALLOCATIONS
 #include "unittest.h"
+#include "unittestBenchmarks.h"
+#include "unittestData.h"
 
 using namespace std;
 
@@ -36,6 +43,49 @@ UnitTest(testCheckTestStrFail) {
 }
 
 
+UnitTest(testLazyExplanationPass) {
+	int explanationsRendered = 0;
+	CppUnitLite::UnitTest::checkTest (
+			CppUnitLite::AssertionResult(true,
+				[&explanationsRendered] (bool) {
+					++explanationsRendered;
+					return std::string("rendered");
+				}),
+			"t1", "fileName", 42);
+	assertThat (explanationsRendered, is(0));
+}
+
+UnitTest(testLazyExplanationFail) {
+	int explanationsRendered = 0;
+	std::string explanation;
+	try {
+		CppUnitLite::UnitTest::checkTest (
+				CppUnitLite::AssertionResult(false,
+					[&explanationsRendered] (bool passed) {
+						++explanationsRendered;
+						return std::string((passed) ? "passed" : "failed");
+					}),
+				"t1", "fileName", 42);
+	} catch (CppUnitLite::UnitTest::UnitTestFailure& ex) {
+		explanation = ex.what();
+	}
+	assertThat (explanationsRendered, is(1));
+	assertThat (explanation, contains("failed"));
+}
+
+UnitTest(testNegatedExplanation) {
+	auto matcher = isEqualTo(2);
+	int observed = 3;
+	CppUnitLite::AssertionResult r = matcher.eval(observed);
+	assertFalse (r.result);
+	assertThat (r.failExplanation(), contains("Observed: 3"));
+	CppUnitLite::AssertionResult notR = r.negated();
+	assertTrue (notR.result);
+	assertThat (notR.passExplanation(), isEqualTo(r.failExplanation()));
+	assertThat (notR.failExplanation(), isEqualTo(r.passExplanation()));
+}
+
+
 
 void throwException() {
 	throw "Catch me if you can";
@@ -144,6 +194,74 @@ UnitTest(testLogging) {
 
 }
 
+UnitTest(testCallLogMatchers) {
+	CppUnitLite::UnitTest::clearCallLog();
+	foo();
+	bar(21);
+	baz(22, true);
+	foo(23, false, "hello");
+	bar(24, false, "hello", 1.0);
+	bar(21);
+
+	const CppUnitLite::CallLog& log = CppUnitLite::UnitTest::callLog();
+	assertThat(log.size(), is(6u));
+	assertThat(log, calledTimes("bar", 3));
+	assertThat(log, calledTimes(callTo("bar", 21), 2));
+	assertThat(log, !calledTimes("baz", 2));
+	assertThat(log, calledWith("baz", 22, true));
+	assertThat(log, calledWith("foo", 23, false, "hello"));
+	assertThat(log, calledWith("bar", 24L, false, string("hello"), 1.0)); // long, by string form
+	assertThat(log, !calledWith("baz", 22, false));
+	assertThat(log, !calledWith("foo", 23));
+	assertThat(log, calledWith("foo"));
+	assertThat(log, callSequence("foo", callTo("baz", 22, true), "bar"));
+	assertThat(log, !callSequence("baz", "baz"));
+
+	// Explanations refer to their matchers, so these must outlive them.
+	auto withMatcher = calledWith("baz", 22, false);
+	CppUnitLite::AssertionResult r = withMatcher.eval(log);
+	assertThat(r.failExplanation(), is("Could not find baz(22, false) in the call log: "
+			"the calls to baz were baz(22, true)"));
+	auto sequenceMatcher = callSequence("bar", "baz", "qux");
+	r = sequenceMatcher.eval(log);
+	assertThat(r.failExplanation(), startsWith("Found the first 2 of 3 calls in sequence,"
+			" but not qux after position 2: the calls were foo(), bar(21)"));
+
+	CppUnitLite::UnitTest::clearCallLog();
+	assertThat(log.size(), is(0u));
+	assertThat(log, calledTimes("bar", 0));
+	char buffer[] = "transient";
+	CppUnitLite::UnitTest::logCall("copy", buffer);
+	buffer[0] = 'T';
+	assertThat(log, calledWith("copy", "transient"));
+
+	char name[] = "named";
+	std::string otherName = "other";
+	CppUnitLite::UnitTest::logCall(name);
+	CppUnitLite::UnitTest::logCall(otherName.c_str());
+	name[0] = 'N';
+	otherName[0] = 'O';
+	assertThat(log, callSequence("copy", "named", "other"));
+}
+
+UnitTest(testCallLogLimit) {
+	CppUnitLite::CallLog& log = CppUnitLite::UnitTest::callLog();
+	log.setLimit(100);
+	for (int i = 0; i < 1000; ++i)
+		bar(i);
+	assertThat(log.size(), is(100u));
+	assertThat(log.droppedCalls(), is(900u));
+	auto matcher = calledWith("bar", 500);
+	CppUnitLite::AssertionResult r = matcher.eval(log);
+	assertThat(r.failExplanation(), endsWith("(900 calls were not logged, beyond the limit of 100)"));
+	CppUnitLite::UnitTest::clearCallLog();
+	log.setLimit(0);
+	for (int i = 0; i < 100000; ++i)
+		foo(i, true, "hello");
+	assertThat(log, calledTimes("foo", 100000));
+	assertThat(log, calledWith("foo", 99999, true, "hello"));
+}
+
 class FooBar { int i;};
 
 void foobar(const FooBar fb) {
@@ -162,3 +280,294 @@ UnitTest(testLoggingUnprintable) {
 }
 
 
+
+
+UnitTest(testAssertOnThreadPass) {
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; ++i)
+		threads.push_back(std::thread(CppUnitLite::UnitTest::propagate([i] () {
+			assertThat(i, isLessThan(4));
+			CppUnitLite::UnitTest::logCall("worker");
+		})));
+	for (auto& t: threads)
+		t.join();
+	assertThat(std::distance(CppUnitLite::UnitTest::begin(),
+			CppUnitLite::UnitTest::end()), is(4));
+}
+
+UnitTest(testAssertOnThreadFail) {
+	CppUnitLite::UnitTest::expectedToFail();
+	std::thread t(CppUnitLite::UnitTest::propagate([] () {
+		assertThat(1, is(2));
+	}));
+	t.join();
+	// The test itself returns normally, but must still fail.
+}
+
+UnitTest(testAdoptedContext) {
+	auto context = CppUnitLite::UnitTest::currentContext();
+	bool sameContext = false;
+	bool caught = false;
+	std::thread t([context, &sameContext, &caught] () {
+		CppUnitLite::UnitTest::ContextScope scope(context);
+		sameContext = (CppUnitLite::UnitTest::currentContext() == context);
+		try {
+			CppUnitLite::UnitTest::checkTest(
+				CppUnitLite::AssertionResult(false, "", ""), "t1", "fileName", 42);
+		} catch (CppUnitLite::UnitTest::UnitTestFailure&) {
+			caught = true;
+		}
+	});
+	t.join();
+	assertTrue(sameContext);
+	assertTrue(caught);
+	CppUnitLite::UnitTest::expectedToFail(); // the failure above was recorded
+}
+
+
+UnitTestConcurrent(testConcurrentPass) {
+	std::cout << "# output of testConcurrentPass" << std::endl;
+	assertThat(std::string("abc"), contains("b"));
+}
+
+UnitTestConcurrent(testConcurrentFail) {
+	CppUnitLite::UnitTest::expectedToFail();
+	assertThat(1, is(2));
+}
+
+UnitTestConcurrentTimed(testConcurrentTimeout, 100) {
+	CppUnitLite::UnitTest::expectedToFail();
+	long k = 0;
+	for (int i = 0; i < 100000; ++i) {
+		++k;
+		for (int j = 0; j < 100000; ++j) {
+			++k;
+		}
+	}
+}
+
+
+UnitTest(testBenchmarkStatistics) {
+	CppUnitLite::BenchmarkStatistics stats ({5.0, 1.0, 3.0, 2.0, 4.0}, 100, 64.0);
+	assertThat(stats.iterations, is(100ull));
+	assertThat(stats.repetitions, is(5u));
+	assertThat(stats.minNS, is(1.0));
+	assertThat(stats.medianNS, is(3.0));
+	assertThat(stats.p99NS, is(5.0));
+	assertThat(stats.meanNS, is(3.0));
+	assertThat(stats.stddevNS, isApproximately(1.5811, 0.0001));
+	assertThat(stats.bytesPerSecond, isApproximately(64.0e9 / 3.0, 1.0));
+	assertThat(stats.itemsPerSecond, isLessThan(0.0));
+	assertThat(stats.yaml(), startsWith("benchmark:\n  iterations: 100\n"));
+	assertThat(stats.yaml(), contains("\n  median_ns: 3.000\n"));
+}
+
+// Run only when selected, e.g. by --benchmarks
+UnitBenchmark(benchStringCopy) {
+	std::string text (1024, 'x');
+	benchmark.setBytesPerIteration(text.size());
+	while (benchmark.keepRunning()) {
+		std::string copy = text;
+		CppUnitLite::doNotOptimize(copy);
+	}
+}
+
+UnitBenchmark(benchWholeBody) {
+	std::vector<int> v (100, 1);
+	CppUnitLite::doNotOptimize(v);
+	int sum = 0;
+	for (int x: v)
+		sum += x;
+	CppUnitLite::doNotOptimize(sum);
+	CppUnitLite::clobberMemory();
+}
+
+UnitTestTimed(testCompletesWithin, 5000) {
+	std::vector<int> v (1000, 1);
+	assertCompletesWithin(std::chrono::milliseconds(100), [&v] {
+		int sum = 0;
+		for (int x: v)
+			sum += x;
+		CppUnitLite::doNotOptimize(sum);
+	});
+}
+
+UnitTest(testCompareToBaseline) {
+	CppUnitLite::BenchmarkStatistics baseline ({100.0, 101.0, 99.0}, 1000);
+	CppUnitLite::BenchmarkStatistics faster ({90.0, 95.0, 92.0}, 1000);
+	CppUnitLite::BenchmarkStatistics slower ({130.0, 125.0, 150.0}, 1000);
+	assertTrue(CppUnitLite::UnitTest::compareToBaseline("copy", faster, baseline, 0.1).result);
+	assertTrue(CppUnitLite::UnitTest::compareToBaseline("copy", slower, baseline, 0.5).result);
+	CppUnitLite::AssertionResult r =
+			CppUnitLite::UnitTest::compareToBaseline("copy", slower, baseline, 0.1);
+	assertFalse(r.result);
+	assertThat(r.failExplanation(), startsWith(
+			"copy: median is 30.0% slower than the baseline, beyond the tolerance of 10.0%"));
+	assertThat(r.failExplanation(), contains(
+			"\n    measured: min 125.000, median 130.000, p99 150.000"));
+	assertThat(r.failExplanation(), contains(
+			"\n    baseline: min 99.000, median 100.000, p99 101.000"));
+}
+
+UnitTest(testNoAllocations) {
+	std::vector<int> v (100, 1);
+	assertNoAllocations([&v] {
+		int sum = 0;
+		for (int x: v)
+			sum += x;
+		CppUnitLite::doNotOptimize(sum);
+	});
+	assertMaxAllocations(1, [] {
+		std::vector<int> w (100, 2);
+		CppUnitLite::doNotOptimize(w);
+	});
+}
+
+UnitTest(testTooManyAllocations) {
+	std::vector<std::string> names;
+	CppUnitLite::AssertionResult r = CppUnitLite::UnitTest::allocatesAtMost(2, [&names] {
+		for (int i = 0; i < 3; ++i)
+			names.push_back(std::string(100, 'a' + i));
+	});
+	assertFalse(r.result);
+	assertThat(r.failExplanation(), startsWith("made "));
+	assertThat(r.failExplanation(), endsWith(" bytes) where at most 2 were allowed"));
+}
+
+UnitTest(testFrameworkBuffersUncounted) {
+	// The first representation built on a thread sets up its buffer.
+	bool firstReprAllocated = true;
+	std::thread helper([&firstReprAllocated] {
+		firstReprAllocated = !CppUnitLite::UnitTest::allocatesAtMost(0, [] {
+			std::string repr = CppUnitLite::getStringRepr(42);
+			CppUnitLite::doNotOptimize(repr);
+		}).result;
+	});
+	helper.join();
+	assertFalse(firstReprAllocated);
+}
+
+UnitTest(testMeasureRegion) {
+	std::vector<int> v (10000, 1);
+	long sum = 0;
+	for (int i = 0; i < 2; ++i) {
+		CppUnitLite::UnitTest::TestTiming timing = CppUnitLite::UnitTest::measure("sum", [&] {
+			for (int x: v)
+				sum += x;
+			CppUnitLite::doNotOptimize(sum);
+		});
+		assertThat(timing.wallMS, isGreaterThanOrEqualTo(0.0));
+		assertThat(timing.cpuMS, isGreaterThanOrEqualTo(0.0));
+		// Only counted with --counters, where the machine allows it.
+		if (timing.counters.instructions >= 0)
+			assertThat(timing.counters.instructions, isGreaterThan(10000LL));
+	}
+	assertThat(sum, is(20000L));
+}
+
+UnitTest(testExpectationsPass) {
+	std::vector<int> v {1, 2, 3};
+	assertNoAllocations([&v] {
+		expectTrue(v.size() == 3);
+		expectFalse(v.empty());
+		expectThat(v[0], is(1));
+		expectEqual(v[2], 3);
+	});
+}
+
+UnitTest(testElementwisePassDoesNotAllocate) {
+	std::vector<double> v {1.0, 2.0, 3.0};
+	std::vector<double> w {1.0, 2.0, 3.0 + 1.0e-12};
+	assertNoAllocations([&v, &w] {
+		assertThat(v, elementsEqual(v));
+		assertThat(w, allApproximately(v, 1.0e-9));
+	});
+}
+
+UnitTest(testExpectationsFail) {
+	CppUnitLite::UnitTest::expectedToFail();
+	for (int i = 0; i < 3; ++i)
+		expectThat(i, isGreaterThan(0)); // fails only at 0
+	expectTrue(false);
+}
+
+int numSharedSamplesBuilt = 0;
+
+UnitTestFixture(SharedSamples) {
+	std::vector<int> values;
+	SharedSamples(): values(1000, 7) { ++numSharedSamplesBuilt; }
+};
+
+UnitTestWith(testFixture, SharedSamples) {
+	assertThat(fixture.values.size(), is(1000u));
+	assertThat(numSharedSamplesBuilt, is(1));
+}
+
+UnitTestWith(testFixtureShared, SharedSamples) {
+	assertTrue(&CppUnitLite::UnitTest::fixture<SharedSamples>() == &fixture);
+	assertThat(numSharedSamplesBuilt, is(1));
+}
+
+UnitTestData(testDataRows, "src/test/data/squares.csv", CppUnitLite::CsvRow) {
+	assertThat(row.size(), is(2u));
+	int n = std::stoi(row[0].str());
+	assertThat(std::stoi(row[1].str()), is(n * n));
+}
+
+UnitTest(testCsvRows) {
+	std::string text = "a,\"b,\"\"c\"\"\",\r\n\"multi\nline\"\nlast";
+	const char* pos = text.data();
+	const char* end = pos + text.size();
+	CppUnitLite::CsvRow row;
+	assertTrue(CppUnitLite::DataRows<CppUnitLite::CsvRow>::read(pos, end, row) == &row);
+	assertThat(row.size(), is(3u));
+	assertThat(row[0].str(), is("a"));
+	assertThat(row[1].str(), is("b,\"\"c\"\""));
+	assertThat(row[2].str(), is(""));
+	assertTrue(CppUnitLite::DataRows<CppUnitLite::CsvRow>::skip(pos, end));
+	CppUnitLite::TextLine line;
+	assertTrue(CppUnitLite::DataRows<CppUnitLite::TextLine>::read(pos, end, line) == &line);
+	assertThat(line.str(), is("last"));
+	assertTrue(CppUnitLite::DataRows<CppUnitLite::TextLine>::read(pos, end, line) == nullptr);
+
+	// A quote inside an unquoted field is just text, when skipped too.
+	text = "1,a\"b\n2,x\n3,y\"z\n4,w\n";
+	pos = text.data();
+	end = pos + text.size();
+	assertTrue(CppUnitLite::DataRows<CppUnitLite::CsvRow>::skip(pos, end));
+	assertTrue(CppUnitLite::DataRows<CppUnitLite::CsvRow>::skip(pos, end));
+	assertTrue(CppUnitLite::DataRows<CppUnitLite::CsvRow>::read(pos, end, row) == &row);
+	assertThat(row.size(), is(2u));
+	assertThat(row[1].str(), is("y\"z"));
+	assertTrue(CppUnitLite::DataRows<CppUnitLite::CsvRow>::skip(pos, end));
+	assertFalse(CppUnitLite::DataRows<CppUnitLite::CsvRow>::skip(pos, end));
+}
+
+UnitProperty(testPropertyReverse, vectorsOf(integers<int>()))
+		(const std::vector<int>& v)
+{
+	std::vector<int> w (v.rbegin(), v.rend());
+	std::reverse(w.begin(), w.end());
+	assertThat(w, isEqualTo(v));
+}
+
+void allBelow500 (const std::vector<int>& v, const std::string&)
+{
+	for (int x: v)
+		assertThat(x, isLessThan(500));
+}
+
+UnitTest(testPropertyShrinking) {
+	std::string explanation;
+	try {
+		CppUnitLite::checkProperty(__FILE__, __LINE__, &allBelow500,
+				CppUnitLite::vectorsOf(CppUnitLite::integers(-1000, 1000)),
+				CppUnitLite::strings());
+	} catch (CppUnitLite::UnitTest::UnitTestFailure& ex) {
+		explanation = ex.what();
+	}
+	assertThat(explanation, contains("property failed with seed"));
+	assertThat(explanation, contains("1: [500]\n\t2: \"\""));
+	std::vector<int> simpler = CppUnitLite::integers(-10, 10).shrink(-8);
+	assertThat(simpler, isEqualTo(std::vector<int>{0, -4, -6, -7}));
+}